@@ -10,8 +10,33 @@ constexpr float c_DefaultEarlyReflectionsPowerDb = -100.0f;
 constexpr float c_DefaultEarlyReflections60DbDecaySeconds = 0.0f;
 constexpr float c_DefaultLateReverb60DbDecaySeconds = 0.0f;
 constexpr float c_DefaultOutdoorness = 0.0f;
+// Default HRTF quantum and pool size. Both can be overridden when the wrapper is created, see HrtfWrapper::ReadConfig.
 constexpr uint32_t c_HrtfFrameCount = 1024;
 constexpr uint32_t c_HrtfSampleRate = 48000;
 constexpr uint32_t c_HrtfMaxSources = 128;
+constexpr uint32_t c_HrtfMinFrameCount = 64;
+constexpr uint32_t c_HrtfMaxFrameCount = 4096;
+constexpr uint32_t c_HrtfMaxSourcesLimit = 1024;
+// Sources are rendered on this many threads. 1 renders everything on the mixer thread.
+constexpr uint32_t c_HrtfRenderThreads = 1;
+constexpr uint32_t c_HrtfMaxRenderThreads = 16;
+constexpr uint32_t c_HrtfEnginesPerRenderThread = 4; // Finer split so that idle threads can steal work
 constexpr float c_MinAudibleGain = 0.00002f;   // -94dB
-constexpr auto c_MinimumSourceDistance = 0.1f; // In meters
\ No newline at end of file
+constexpr auto c_MinimumSourceDistance = 0.1f; // In meters
+constexpr float c_DefaultVoiceHoldMs = 250.0f;  // Silence before a source gives up its HRTF slot
+constexpr float c_MaxVoiceHoldMs = 5000.0f;
+constexpr float c_VoiceStealMargin = 2.0f; // A source must be 6 dB more audible to take over a slot
+constexpr uint64_t c_MaxWriterWaitNs = 200000; // Longest the mixer waits for a source to finish the bank it renders
+// Parameter updates smaller than these are not sent to the HRTF engine
+constexpr float c_DefaultParameterAngleThreshold = 1.0f; // Degrees
+constexpr float c_MaxParameterAngleThreshold = 10.0f;
+constexpr float c_DefaultParameterGainThresholdDb = 0.25f;
+constexpr float c_MaxParameterGainThresholdDb = 3.0f;
+
+// In low latency mode HRTFs are rendered in quanta of the DSP buffer size rather than c_HrtfFrameCount,
+// so the mixer produces output on every DSP tick instead of buffering a full quantum.
+#ifdef SPATIALIZER_LOW_LATENCY
+constexpr bool c_HrtfLowLatency = true;
+#else
+constexpr bool c_HrtfLowLatency = false;
+#endif
@@ -2,47 +2,170 @@
 // Licensed under the MIT License.
 
 #include "HrtfWrapper.h"
+#include "PluginMetrics.h"
+#include "Tracing.h"
+#include "mathutility.h"
+#include "vectormath.h"
+#include <algorithm>
 #include <exception>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
+#include <thread>
 
 // Statics
 std::unique_ptr<HrtfWrapper> HrtfWrapper::s_HrtfWrapper;
 
-HrtfWrapper::SourceInfo::SourceInfo(uint32_t index, HrtfInputBuffer* const sourceBuffer)
-    : m_SourceIndex(index), m_SourceBuffer(sourceBuffer)
+HrtfWrapper::SourceInfo::SourceInfo(uint32_t index) : m_SourceIndex(index)
 {
 }
 
-HrtfWrapper::SourceInfo::~SourceInfo()
+void HrtfWrapper::SourceReleaser::operator()(SourceInfo* source) const noexcept
 {
-    m_SourceBuffer->Buffer = nullptr;
-    m_SourceBuffer->Length = 0;
+    // The next HRTF pass frees the slot. A stolen slot is already taken care of, and may belong to another source by
+    // now.
     if (HrtfWrapper::s_HrtfWrapper)
     {
-        s_HrtfWrapper->ReleaseSource(m_SourceIndex);
+        s_HrtfWrapper->EndOwnership(source->GetIndex(), Generation);
     }
 }
 
-void HrtfWrapper::InitWrapper()
+HrtfWrapper::SourceWriter::SourceWriter() noexcept : m_Writers(nullptr), m_Buffer(nullptr), m_SourceIndex(0)
 {
+}
+
+HrtfWrapper::SourceWriter::SourceWriter(std::atomic<uint32_t>* writers, float* buffer, uint32_t sourceIndex) noexcept
+    : m_Writers(writers), m_Buffer(buffer), m_SourceIndex(sourceIndex)
+{
+}
+
+HrtfWrapper::SourceWriter::SourceWriter(SourceWriter&& other) noexcept
+    : m_Writers(other.m_Writers), m_Buffer(other.m_Buffer), m_SourceIndex(other.m_SourceIndex)
+{
+    other.m_Writers = nullptr;
+    other.m_Buffer = nullptr;
+}
+
+HrtfWrapper::SourceWriter::~SourceWriter()
+{
+    if (m_Writers != nullptr)
+    {
+        m_Writers->fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void HrtfWrapper::SourceWriter::SetEmitter(const EmitterParameters& emitter) const noexcept
+{
+    if (m_Buffer != nullptr)
+    {
+        HrtfWrapper::s_HrtfWrapper->m_EmitterMailboxes[m_SourceIndex].Write(emitter);
+    }
+}
+
+void HrtfWrapper::InitWrapper(uint32_t dspBufferSize)
+{
+    SPATIALIZER_TRACE_START();
     if (!HrtfWrapper::s_HrtfWrapper)
     {
-        HrtfWrapper::s_HrtfWrapper.reset(new HrtfWrapper());
+        HrtfWrapper::s_HrtfWrapper.reset(new HrtfWrapper(dspBufferSize, ReadConfig()));
     }
 }
 
-bool HrtfWrapper::SourceInfo::SetParameters(HrtfAcousticParameters* params) const noexcept
+// Parses a positive decimal environment variable, returning 0 if it is unset or malformed
+static uint32_t ReadEnvironmentValue(const char* name) noexcept
+{
+#ifdef WINDOWSSTORE
+    // The environment isn't available to UWP apps
+    (void) name;
+    return 0;
+#else
+    auto text = std::getenv(name);
+    if (text == nullptr || *text == '\0')
+    {
+        return 0;
+    }
+    char* end = nullptr;
+    auto value = std::strtoul(text, &end, 10);
+    if (*end != '\0' || value > UINT32_MAX)
+    {
+        return 0;
+    }
+    return static_cast<uint32_t>(value);
+#endif
+}
+
+HrtfWrapper::Config HrtfWrapper::ReadConfig() noexcept
+{
+    Config config = {c_HrtfMaxSources, c_HrtfFrameCount, c_HrtfRenderThreads};
+
+    auto maxSources = ReadEnvironmentValue("SPATIALIZER_HRTF_MAX_SOURCES");
+    if (maxSources > 0 && maxSources <= c_HrtfMaxSourcesLimit)
+    {
+        config.MaxSources = maxSources;
+    }
+
+    auto frameCount = ReadEnvironmentValue("SPATIALIZER_HRTF_FRAME_COUNT");
+    if (frameCount >= c_HrtfMinFrameCount && frameCount <= c_HrtfMaxFrameCount && IsPowerOfTwo(frameCount))
+    {
+        config.FrameCount = frameCount;
+    }
+
+    auto renderThreads = ReadEnvironmentValue("SPATIALIZER_HRTF_RENDER_THREADS");
+    if (renderThreads > 0 && renderThreads <= c_HrtfMaxRenderThreads)
+    {
+        config.RenderThreads = renderThreads;
+    }
+    return config;
+}
+
+uint32_t HrtfWrapper::GetMaxSources() noexcept
 {
     if (!HrtfWrapper::s_HrtfWrapper)
     {
-        return false;
+        return 0;
+    }
+    return HrtfWrapper::s_HrtfWrapper->m_MaxSources;
+}
+
+uint32_t HrtfWrapper::GetFrameCount() noexcept
+{
+    if (!HrtfWrapper::s_HrtfWrapper)
+    {
+        return c_HrtfFrameCount;
     }
-    return HrtfWrapper::s_HrtfWrapper->SetParameters(m_SourceIndex, params);
+    return HrtfWrapper::s_HrtfWrapper->m_FrameCount;
 }
 
-float* HrtfWrapper::SourceInfo::GetBuffer() const noexcept
+void HrtfWrapper::SetListener(const float* listenerMatrix, uint64_t dspTick) noexcept
 {
-    return m_SourceBuffer->Buffer;
+    if (!HrtfWrapper::s_HrtfWrapper)
+    {
+        return;
+    }
+    auto& wrapper = *HrtfWrapper::s_HrtfWrapper;
+
+    // Sources that lose the race skip the post, the winner posts the same matrix for this tick
+    if (wrapper.m_ListenerTick.load(std::memory_order_relaxed) == dspTick ||
+        wrapper.m_PostingListener.exchange(true, std::memory_order_acquire))
+    {
+        return;
+    }
+    if (wrapper.m_ListenerTick.load(std::memory_order_relaxed) != dspTick)
+    {
+        ListenerMatrix listener;
+        std::memcpy(listener.Matrix, listenerMatrix, sizeof(listener.Matrix));
+        wrapper.m_ListenerMailbox.Write(listener);
+        wrapper.m_ListenerTick.store(dspTick, std::memory_order_relaxed);
+    }
+    wrapper.m_PostingListener.store(false, std::memory_order_release);
+}
+
+void HrtfWrapper::SourceInfo::SetAudibility(float audibility) const noexcept
+{
+    if (HrtfWrapper::s_HrtfWrapper)
+    {
+        HrtfWrapper::s_HrtfWrapper->m_SlotStates[m_SourceIndex].Audibility.store(audibility, std::memory_order_relaxed);
+    }
 }
 
 uint32_t HrtfWrapper::SourceInfo::GetIndex() const noexcept
@@ -50,86 +173,665 @@ uint32_t HrtfWrapper::SourceInfo::GetIndex() const noexcept
     return m_SourceIndex;
 }
 
-HrtfWrapper::SourceInfo* HrtfWrapper::GetHrtfSource()
+HrtfWrapper::SourceHandle HrtfWrapper::GetHrtfSource(float audibility) noexcept
 {
     if (!HrtfWrapper::s_HrtfWrapper)
     {
         return nullptr;
     }
-    return HrtfWrapper::s_HrtfWrapper->GetAvailableHrtfSource();
+    return HrtfWrapper::s_HrtfWrapper->GetAvailableHrtfSource(audibility);
+}
+
+bool HrtfWrapper::WasStolen(const SourceHandle& source) noexcept
+{
+    if (!source || !HrtfWrapper::s_HrtfWrapper)
+    {
+        return false;
+    }
+    const auto& slot = HrtfWrapper::s_HrtfWrapper->m_SlotStates[source->GetIndex()];
+    return slot.Ownership.load(std::memory_order_acquire) != (source.get_deleter().Generation << 1 | c_Owned);
+}
+
+HrtfWrapper::SourceWriter HrtfWrapper::BeginWrite(const SourceHandle& source) noexcept
+{
+    if (!source || !HrtfWrapper::s_HrtfWrapper)
+    {
+        return SourceWriter();
+    }
+    auto& wrapper = *HrtfWrapper::s_HrtfWrapper;
+    const auto sourceIndex = source->GetIndex();
+    auto& slot = wrapper.m_SlotStates[sourceIndex];
+
+    // Count in on the write bank. If the mixer moved on to the other bank meanwhile, it may have missed the count, so
+    // start over on the new one.
+    auto bank = wrapper.m_WriteBank.load(std::memory_order_seq_cst);
+    for (;;)
+    {
+        slot.Writers[bank].fetch_add(1, std::memory_order_seq_cst);
+        const auto current = wrapper.m_WriteBank.load(std::memory_order_seq_cst);
+        if (current == bank)
+        {
+            break;
+        }
+        slot.Writers[bank].fetch_sub(1, std::memory_order_release);
+        bank = current;
+    }
+    SourceWriter writer(&slot.Writers[bank], wrapper.GetSampleBuffer(sourceIndex, bank), sourceIndex);
+
+    // A steal after this check frees the slot only once this writer is done
+    const auto ownership = slot.Ownership.load(std::memory_order_seq_cst);
+    if (ownership != (source.get_deleter().Generation << 1 | c_Owned))
+    {
+        return SourceWriter();
+    }
+    return writer;
 }
 
-uint32_t HrtfWrapper::Process(float* outputBuffer, uint32_t numSamples, uint32_t numChannels) noexcept
+uint32_t
+HrtfWrapper::Process(float* outputBuffer, uint32_t numSamples, uint32_t numChannels, uint32_t sampleRate) noexcept
 {
     if (!HrtfWrapper::s_HrtfWrapper)
     {
         return 0;
     }
-    return HrtfWrapper::s_HrtfWrapper->ProcessHrtfs(outputBuffer, numSamples, numChannels);
+    return HrtfWrapper::s_HrtfWrapper->ProcessHrtfs(outputBuffer, numSamples, numChannels, sampleRate);
 }
 
-HrtfWrapper::HrtfWrapper()
-    : m_SampleBuffers(c_HrtfMaxSources, c_HrtfFrameCount)
+void HrtfWrapper::UpdateSlots() noexcept
 {
+    if (!HrtfWrapper::s_HrtfWrapper)
+    {
+        return;
+    }
+    auto& wrapper = *HrtfWrapper::s_HrtfWrapper;
+    wrapper.UpdateOwners(wrapper.m_ProcessingSlots.GetAcquiredSlots(wrapper.m_ActiveSlots.get()));
+}
 
-    for (uint32_t i = 0; i < c_HrtfMaxSources; ++i)
+HrtfWrapper::HrtfWrapper(uint32_t dspBufferSize, const Config& config)
+    : m_MaxSources(config.MaxSources)
+    , m_WriteBank(0)
+    , m_FrameCount(config.FrameCount)
+    , m_NumShards(
+          config.RenderThreads > 1 ? std::min(config.RenderThreads * c_HrtfEnginesPerRenderThread, config.MaxSources)
+                                   : 1)
+    , m_SourcesPerShard((config.MaxSources + m_NumShards - 1) / m_NumShards)
+    , m_HrtfInputBuffers(new HrtfInputBuffer[c_NumBanks * m_NumShards * m_SourcesPerShard])
+    , m_FlexEngines(new HrtfEngineHandle[m_NumShards])
+    , m_ProcessingSlots(config.MaxSources)
+    , m_SlotStates(new SlotState[config.MaxSources])
+    , m_EmitterMailboxes(new LatestValueMailbox<EmitterParameters>[config.MaxSources])
+    , m_PostingListener(false)
+    , m_ListenerTick(UINT64_MAX)
+    , m_HasListener(false)
+    , m_EmitterSlots(new uint32_t[config.MaxSources])
+    , m_ShardEmitters(new uint32_t[m_NumShards + 1])
+    , m_Positions(4, config.MaxSources)
+    , m_Directions(4, config.MaxSources)
+    , m_ActiveSlots(new uint32_t[config.MaxSources])
+    , m_ShardInputs(new uint32_t[m_NumShards])
+    , m_ReadBank(0)
+    , m_LateWriters(false)
+    , m_ShardOutput(nullptr)
+    , m_ShardSamples(0)
+    , m_ShardChannels(0)
+    , m_ShardResult(0)
+    , m_JobTimings(new JobScheduler::JobTiming[m_NumShards])
+{
+    for (auto i = 0u; i < c_NumBanks * m_NumShards * m_SourcesPerShard; ++i)
     {
         m_HrtfInputBuffers[i].Buffer = nullptr;
         m_HrtfInputBuffers[i].Length = 0;
-        // Push onto available slots stack in reverse order, so that index 0 is on top of the stack
-        // This doesn't matter for functionality, but will make debugging easier if the active sources
-        // start at index 0.
-        m_AvailableProcessingSlots.push(static_cast<unsigned char>(c_HrtfMaxSources - i - 1));
     }
 
-    if (!HrtfEngineInitialize(c_HrtfMaxSources, HrtfEngineType_FlexBinaural_High_NoReverb, c_HrtfFrameCount, &m_FlexEngine))
+    m_Sources.reserve(m_MaxSources);
+    for (uint32_t i = 0; i < m_MaxSources; ++i)
+    {
+        m_Sources.emplace_back(i);
+        m_SlotStates[i].Audibility.store(0.0f, std::memory_order_relaxed);
+        m_SlotStates[i].Ownership.store(0, std::memory_order_relaxed);
+        for (auto& writers : m_SlotStates[i].Writers)
+        {
+            writers.store(0, std::memory_order_relaxed);
+        }
+        m_SlotStates[i].Rendering = false;
+        m_SlotStates[i].FadeIn = false;
+        m_SlotStates[i].HasEmitter = false;
+        m_SlotStates[i].HasSentParams = false;
+    }
+    m_StealAudibility.store(0.0f, std::memory_order_relaxed);
+    m_StolenSlot = SlotAllocator::c_InvalidSlot;
+
+    // The mixer needs at least one DSP buffer per quantum
+    if (dspBufferSize > m_FrameCount && dspBufferSize <= c_HrtfMaxFrameCount && IsPowerOfTwo(dspBufferSize))
+    {
+        m_FrameCount = dspBufferSize;
+    }
+
+    auto initializeEngines = [this](uint32_t frameCount) {
+        for (auto shard = 0u; shard < m_NumShards; ++shard)
+        {
+            if (!HrtfEngineInitialize(
+                    m_SourcesPerShard, HrtfEngineType_FlexBinaural_High_NoReverb, frameCount, &m_FlexEngines[shard]))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // In low latency mode, render one quantum per DSP tick if the engine supports quanta of that size.
+    // Otherwise fall back to the default quantum, buffered by the mixer.
+    if (c_HrtfLowLatency && dspBufferSize < m_FrameCount && IsPowerOfTwo(dspBufferSize) &&
+        initializeEngines(dspBufferSize))
+    {
+        m_FrameCount = dspBufferSize;
+    }
+    else if (!initializeEngines(m_FrameCount))
     {
         throw std::bad_alloc();
-    } 
+    }
+    m_SampleBuffers = AlignedStore::AlignedBuffers<float>(c_NumBanks * m_MaxSources, m_FrameCount);
+    for (auto i = 0u; i < c_NumBanks * m_MaxSources; ++i)
+    {
+        m_SampleBuffers[i].Clear();
+    }
+
+    // Linear ramps for slots that change hands
+    m_FadeIn.reset(AlignedStore::AllocateFloatBuffer(m_FrameCount));
+    m_FadeOut.reset(AlignedStore::AllocateFloatBuffer(m_FrameCount));
+    for (auto i = 0u; i < m_FrameCount; ++i)
+    {
+        m_FadeIn[i] = static_cast<float>(i + 1) / m_FrameCount;
+        m_FadeOut[i] = 1.0f - m_FadeIn[i];
+    }
+
+    if (m_NumShards > 1)
+    {
+        m_PartialMixes = AlignedStore::AlignedBuffers<float>(m_NumShards - 1, 2 * m_FrameCount);
+        m_Scheduler = std::make_unique<JobScheduler>(std::min(config.RenderThreads, m_NumShards), m_NumShards);
+    }
+}
+
+HrtfWrapper::SourceHandle HrtfWrapper::GetAvailableHrtfSource(float audibility) noexcept
+{
+    // Slots are claimed lowest index first, so active sources start at index 0 which makes debugging easier
+    auto sourceIndex = m_ProcessingSlots.Acquire();
+    if (sourceIndex == SlotAllocator::c_InvalidSlot)
+    {
+        PluginMetrics::Increment(PluginMetrics::Counter::AcquireFailures);
+
+        // The next pass steals for the loudest source that was turned down
+        auto requested = m_StealAudibility.load(std::memory_order_relaxed);
+        while (audibility > requested &&
+               !m_StealAudibility.compare_exchange_weak(requested, audibility, std::memory_order_relaxed))
+        {
+        }
+        return nullptr;
+    }
+
+    // The slot came back to the pool with both banks clear. The next pass gets the engine ready for the new owner.
+    auto& slot = m_SlotStates[sourceIndex];
+    slot.Audibility.store(audibility, std::memory_order_relaxed);
+
+    // Nobody else writes the ownership of a free slot
+    const auto generation = slot.Ownership.load(std::memory_order_relaxed) >> 1;
+    slot.Ownership.store(generation << 1 | c_Owned, std::memory_order_release);
+    return SourceHandle(&m_Sources[sourceIndex], SourceReleaser{generation});
+}
+
+// Ends the ownership that started with generation. Fails if it already ended, through a steal or the owner's release.
+bool HrtfWrapper::EndOwnership(uint32_t sourceIndex, uint32_t generation) noexcept
+{
+    auto expected = generation << 1 | c_Owned;
+    return m_SlotStates[sourceIndex].Ownership.compare_exchange_strong(expected, (generation + 1) << 1);
 }
 
-HrtfWrapper::SourceInfo* HrtfWrapper::GetAvailableHrtfSource()
+// Waits for the writers of the read bank to finish, for at most c_MaxWriterWaitNs. Returns false if some aren't done.
+//
+// A writer only has a DSP buffer to downmix, which takes microseconds, so there is hardly ever anyone to wait for. One
+// that takes longer was preempted, and waiting for it could hold the audio thread up past its deadline. Its slot sits
+// the pass out instead, see SkipLateInputs: a quantum of one source goes missing rather than the whole mix.
+bool HrtfWrapper::WaitForWriters(uint32_t numAcquired) noexcept
 {
-    // Are there any sources available?
-    if (!m_AvailableProcessingSlots.empty())
+    const auto start = JobScheduler::GetTimeNs();
+    for (auto n = 0u; n < numAcquired; ++n)
     {
-        auto sourceIndex = m_AvailableProcessingSlots.top();
-        if (HrtfEngineAcquireResourcesForSource(m_FlexEngine.Get(), sourceIndex))
+        const auto& writers = m_SlotStates[m_ActiveSlots[n]].Writers[m_ReadBank];
+        while (writers.load(std::memory_order_seq_cst) != 0)
         {
-            m_AvailableProcessingSlots.pop();
-            std::memset(m_SampleBuffers[sourceIndex].Data, 0, c_HrtfFrameCount * sizeof(float));
-            m_HrtfInputBuffers[sourceIndex].Buffer = m_SampleBuffers[sourceIndex].Data;
-            m_HrtfInputBuffers[sourceIndex].Length = c_HrtfFrameCount;
-            return new HrtfWrapper::SourceInfo(sourceIndex, &m_HrtfInputBuffers[sourceIndex]);
+            if (JobScheduler::GetTimeNs() - start >= c_MaxWriterWaitNs)
+            {
+                return false;
+            }
+            std::this_thread::yield();
         }
     }
+    return true;
+}
+
+// Hands slots over at the start of a pass, so that the engines don't change while they render. New owners get engine
+// resources. Slots whose ownership ended, by a release, a steal or a refusal, give theirs back and return to the pool
+// with both banks clear. Owners that let go no longer write to them, but a writer that started before a steal or a
+// refusal may still be at it, in which case a later call frees the slot. The slots to render are moved to the front of
+// m_ActiveSlots, and their number returned.
+uint32_t HrtfWrapper::UpdateOwners(uint32_t numActive) noexcept
+{
+    auto numRendered = 0u;
+    for (auto n = 0u; n < numActive; ++n)
+    {
+        const auto i = m_ActiveSlots[n];
+        auto& slot = m_SlotStates[i];
+        const auto ownership = slot.Ownership.load(std::memory_order_acquire);
+        if ((ownership & c_Owned) != 0)
+        {
+            if (!slot.Rendering)
+            {
+                if (!HrtfEngineAcquireResourcesForSource(m_FlexEngines[GetShard(i)].Get(), GetShardIndex(i)))
+                {
+                    // Turn the source away like a stolen one, the slot is freed next pass
+                    PluginMetrics::Increment(PluginMetrics::Counter::AcquireFailures);
+                    EndOwnership(i, ownership >> 1);
+                    continue;
+                }
+                for (auto bank = 0u; bank < c_NumBanks; ++bank)
+                {
+                    auto& input = GetInputBuffer(i, bank);
+                    input.Buffer = GetSampleBuffer(i, bank);
+                    input.Length = m_FrameCount;
+                }
+                slot.Rendering = true;
+                slot.HasEmitter = false;
+                slot.HasSentParams = false;
+            }
+            m_ActiveSlots[numRendered++] = i;
+            continue;
+        }
 
-    return nullptr;
+        if (slot.Rendering)
+        {
+            for (auto bank = 0u; bank < c_NumBanks; ++bank)
+            {
+                auto& input = GetInputBuffer(i, bank);
+                input.Buffer = nullptr;
+                input.Length = 0;
+            }
+            HrtfEngineReleaseResourcesForSource(m_FlexEngines[GetShard(i)].Get(), GetShardIndex(i));
+            slot.Rendering = false;
+        }
+        // Writers that start from now on see that the ownership ended and don't write, those that started before have
+        // to finish first
+        auto writing = false;
+        for (const auto& writers : slot.Writers)
+        {
+            writing = writing || writers.load(std::memory_order_seq_cst) != 0;
+        }
+        if (writing)
+        {
+            continue;
+        }
+        for (auto bank = 0u; bank < c_NumBanks; ++bank)
+        {
+            std::memset(GetSampleBuffer(i, bank), 0, m_FrameCount * sizeof(float));
+        }
+        // The previous owner's emitter doesn't apply to the next one
+        m_EmitterMailboxes[i].Discard();
+        m_ProcessingSlots.Release(i);
+    }
+    return numRendered;
 }
 
-void HrtfWrapper::ReleaseSource(uint32_t sourceIndex)
+// Connects the read bank of the slots to render to the engines. Slots whose writer wasn't done in time sit this pass
+// out, with their input disconnected so that nothing reads or clears the buffer while it is written. The others are
+// moved to the front of m_ActiveSlots, and their number returned.
+uint32_t HrtfWrapper::SkipLateInputs(uint32_t numActive) noexcept
 {
-    HrtfEngineReleaseResourcesForSource(m_FlexEngine.Get(), sourceIndex);
-    m_AvailableProcessingSlots.push(static_cast<unsigned char>(sourceIndex));   
+    auto numRendered = 0u;
+    for (auto n = 0u; n < numActive; ++n)
+    {
+        const auto i = m_ActiveSlots[n];
+        auto& input = GetInputBuffer(i, m_ReadBank);
+        if (m_LateWriters && m_SlotStates[i].Writers[m_ReadBank].load(std::memory_order_seq_cst) != 0)
+        {
+            input.Buffer = nullptr;
+            input.Length = 0;
+            PluginMetrics::Increment(PluginMetrics::Counter::LateInputs);
+            continue;
+        }
+        input.Buffer = GetSampleBuffer(i, m_ReadBank);
+        input.Length = m_FrameCount;
+        m_ActiveSlots[numRendered++] = i;
+    }
+    return numRendered;
 }
 
-uint32_t HrtfWrapper::ProcessHrtfs(float* outputBuffer, uint32_t numSamples, uint32_t numChannels) noexcept
+// Takes the slot of the least audible active source away from its owner, if it is at least c_VoiceStealMargin quieter
+// than the loudest source turned down since the last pass. The slot fades out over this pass and is freed after it.
+void HrtfWrapper::StealQuietestSource(uint32_t numActive) noexcept
 {
+    m_StolenSlot = SlotAllocator::c_InvalidSlot;
+    const auto audibility = m_StealAudibility.exchange(0.0f, std::memory_order_relaxed);
+
+    auto victim = SlotAllocator::c_InvalidSlot;
+    auto victimAudibility = audibility / c_VoiceStealMargin;
+    for (auto n = 0u; n < numActive; ++n)
+    {
+        const auto i = m_ActiveSlots[n];
+        const auto slotAudibility = m_SlotStates[i].Audibility.load(std::memory_order_relaxed);
+        if (slotAudibility < victimAudibility)
+        {
+            victim = i;
+            victimAudibility = slotAudibility;
+        }
+    }
+    if (victim == SlotAllocator::c_InvalidSlot)
+    {
+        return;
+    }
+
+    // The owner may let go at the same time, in which case the release wins
+    const auto ownership = m_SlotStates[victim].Ownership.load(std::memory_order_acquire);
+    if ((ownership & c_Owned) != 0 && EndOwnership(victim, ownership >> 1))
+    {
+        m_StolenSlot = victim;
+    }
+}
+
+uint32_t HrtfWrapper::ProcessHrtfs(
+    float* outputBuffer, uint32_t numSamples, uint32_t numChannels, uint32_t sampleRate) noexcept
+{
+    SPATIALIZER_TRACE_SCOPE("HrtfWrapper::ProcessHrtfs");
+    const auto passStart = JobScheduler::GetTimeNs();
+
     // Explicitly clear the output buffer
     memset(outputBuffer, 0, sizeof(float) * numSamples * numChannels);
-    auto retVal = HrtfEngineProcess(
-        m_FlexEngine.Get(), m_HrtfInputBuffers, c_HrtfMaxSources, outputBuffer, numSamples * numChannels);
 
-    // We've consumed all the audio data for this pass. Clear out the input buffers
-    for (auto i = 0u; i < c_HrtfMaxSources; ++i)
+    // Sources move on to the other bank for the next quantum, this pass renders the one they just filled. Writers that
+    // are still at it only have a DSP buffer to finish.
+    m_ReadBank = m_WriteBank.load(std::memory_order_relaxed);
+    m_WriteBank.store(m_ReadBank ^ 1, std::memory_order_seq_cst);
+    const auto numAcquired = m_ProcessingSlots.GetAcquiredSlots(m_ActiveSlots.get());
+    m_LateWriters = !WaitForWriters(numAcquired);
+
+    // Only acquired slots are faded, submitted and cleared, so the cost follows the number of live voices rather
+    // than the pool size. Slots are handed out lowest index first, which keeps the submitted range short.
+    const auto numActive = SkipLateInputs(UpdateOwners(numAcquired));
+    PluginMetrics::Record(PluginMetrics::Histogram::ActiveSources, static_cast<float>(numActive));
+    StealQuietestSource(numActive);
+    if (numActive == 0)
+    {
+        return numSamples * numChannels;
+    }
+
+    UpdateParameters(numActive);
+
+    // Crossfade slots that change hands. The fades cover a whole quantum.
+    // Each engine is given the range of its inputs up to its highest rendered slot.
+    std::fill(m_ShardInputs.get(), m_ShardInputs.get() + m_NumShards, 0u);
+    for (auto n = 0u; n < numActive; ++n)
+    {
+        const auto i = m_ActiveSlots[n];
+        m_ShardInputs[GetShard(i)] = GetShardIndex(i) + 1;
+
+        auto buffer = GetSampleBuffer(i, m_ReadBank);
+        if (i == m_StolenSlot)
+        {
+            VectorMath::Arithmetic::Mul_32f(buffer, buffer, m_FadeOut.get(), m_FrameCount);
+        }
+        else if (m_SlotStates[i].FadeIn)
+        {
+            VectorMath::Arithmetic::Mul_32f(buffer, buffer, m_FadeIn.get(), m_FrameCount);
+            m_SlotStates[i].FadeIn = false;
+        }
+    }
+
+    m_ShardOutput = outputBuffer;
+    m_ShardSamples = numSamples;
+    m_ShardChannels = numChannels;
+    m_ShardResult = numSamples * numChannels;
+    if (m_Scheduler)
     {
-        memset(m_SampleBuffers[i].Data, 0, c_HrtfFrameCount * sizeof(float));
+        // One job per engine. Jobs that don't fit the queue are rendered right away.
+        for (auto shard = 0u; shard < m_NumShards; ++shard)
+        {
+            if (m_ShardInputs[shard] != 0 && !m_Scheduler->Submit(&HrtfWrapper::RenderShard, this, shard))
+            {
+                const auto start = JobScheduler::GetTimeNs();
+                RenderShard(this, shard);
+                RecordShardTiming(shard, JobScheduler::GetTimeNs() - start, 0);
+            }
+        }
+        m_Scheduler->Wait();
+
+        const auto numJobs = m_Scheduler->GetJobTimings(m_JobTimings.get(), m_NumShards);
+        for (auto job = 0u; job < numJobs; ++job)
+        {
+            const auto& timing = m_JobTimings[job];
+            RecordShardTiming(timing.Index, timing.EndNs - timing.StartNs, timing.Thread);
+        }
+        for (auto shard = 0u; shard < m_NumShards; ++shard)
+        {
+            if (m_ShardInputs[shard] == 0)
+            {
+                RecordShardTiming(shard, 0, 0);
+            }
+        }
+
+        // The first shard rendered straight into the output, add the others' binaural mix to the first two channels
+        for (auto shard = 1u; shard < m_NumShards; ++shard)
+        {
+            if (m_ShardInputs[shard] == 0)
+            {
+                continue;
+            }
+            const auto partial = m_PartialMixes[shard - 1].Data;
+            if (numChannels == 2)
+            {
+                VectorMath::Arithmetic::Add_32f_I(outputBuffer, partial, 2 * numSamples);
+            }
+            else
+            {
+                for (auto frame = 0u; frame < numSamples; ++frame)
+                {
+                    outputBuffer[frame * numChannels] += partial[2 * frame];
+                    outputBuffer[frame * numChannels + 1] += partial[2 * frame + 1];
+                }
+            }
+        }
     }
+    else
+    {
+        const auto start = JobScheduler::GetTimeNs();
+        RenderShard(this, 0);
+        RecordShardTiming(0, JobScheduler::GetTimeNs() - start, 0);
+    }
+    auto retVal = m_ShardResult;
 
+    // The stolen source has faded out, the next pass frees its slot. Its owner sees the new generation and lets go.
+    if (m_StolenSlot != SlotAllocator::c_InvalidSlot)
+    {
+        m_SlotStates[m_StolenSlot].Audibility.store(0.0f, std::memory_order_relaxed);
+        m_SlotStates[m_StolenSlot].FadeIn = true;
+        m_StolenSlot = SlotAllocator::c_InvalidSlot;
+        PluginMetrics::Increment(PluginMetrics::Counter::VoiceSteals);
+    }
+
+    // We've consumed all the audio data for this pass. Clear out the bank so sources can fill it again next
+    // quantum.
+    for (auto n = 0u; n < numActive; ++n)
+    {
+        memset(GetSampleBuffer(m_ActiveSlots[n], m_ReadBank), 0, m_FrameCount * sizeof(float));
+    }
+
+    const auto passNs = JobScheduler::GetTimeNs() - passStart;
+    PluginMetrics::Record(PluginMetrics::Histogram::HrtfPassUs, passNs * 0.001f);
+    // The pass has to keep up with the output device
+    if (sampleRate > 0 && passNs > static_cast<uint64_t>(numSamples) * 1000000000ull / sampleRate)
+    {
+        PluginMetrics::Increment(PluginMetrics::Counter::DeadlineMisses);
+    }
     return retVal;
 }
 
-bool HrtfWrapper::SetParameters(uint32_t index, HrtfAcousticParameters* params) noexcept
+// Sends one engine its sources' parameters and renders them. Runs as a job on any of the render threads, the mixer
+// thread included.
+void HrtfWrapper::RenderShard(void* context, uint32_t shard) noexcept
+{
+    SPATIALIZER_TRACE_SCOPE("HrtfWrapper::RenderShard");
+    auto wrapper = static_cast<HrtfWrapper*>(context);
+    const auto numInputs = wrapper->m_ShardInputs[shard];
+    if (numInputs == 0)
+    {
+        return;
+    }
+    wrapper->SendParameters(shard);
+
+    auto inputs = &wrapper->m_HrtfInputBuffers
+                       [(wrapper->m_ReadBank * wrapper->m_NumShards + shard) * wrapper->m_SourcesPerShard];
+    if (shard == 0)
+    {
+        wrapper->m_ShardResult = HrtfEngineProcess(
+            wrapper->m_FlexEngines[0].Get(), inputs, numInputs, wrapper->m_ShardOutput,
+            wrapper->m_ShardSamples * wrapper->m_ShardChannels);
+    }
+    else
+    {
+        const auto partialLength = 2 * wrapper->m_ShardSamples;
+        const auto partial = wrapper->m_PartialMixes[shard - 1].Data;
+        if (HrtfEngineProcess(wrapper->m_FlexEngines[shard].Get(), inputs, numInputs, partial, partialLength) !=
+            partialLength)
+        {
+            // Leave this shard out of the mix
+            wrapper->m_ShardInputs[shard] = 0;
+        }
+    }
+}
+
+// Publishes how long the shard took this pass, and which slots it rendered
+void HrtfWrapper::RecordShardTiming(uint32_t shard, uint64_t renderNs, uint32_t thread) noexcept
+{
+    const auto numInputs = m_ShardInputs[shard];
+    const auto lastSlot = numInputs > 0 ? shard + (numInputs - 1) * m_NumShards : shard;
+    PluginMetrics::RecordShard(shard, {renderNs * 0.001f, thread, numInputs, shard, lastSlot, m_NumShards});
+}
+
+// True if the direction moved by at least the angle whose cosine is cosThreshold
+static bool DirectionChanged(const ATKVectorF& from, const ATKVectorF& to, float cosThreshold) noexcept
+{
+    // Compare cosines to avoid the acos, cos(angle) * |from| * |to| = from . to
+    const auto dot = from.x * to.x + from.y * to.y + from.z * to.z;
+    const auto lengths =
+        std::sqrt((from.x * from.x + from.y * from.y + from.z * from.z) * (to.x * to.x + to.y * to.y + to.z * to.z));
+    if (lengths == 0.0f)
+    {
+        return from.x != to.x || from.y != to.y || from.z != to.z;
+    }
+    return dot < cosThreshold * lengths;
+}
+
+// Turns the latest emitters of the active slots into listener space directions and distance powers. The positions of
+// all sources are gathered and transformed to listener space in one batch, grouped by shard so that every shard's job
+// sends its own sources' parameters, see SendParameters.
+void HrtfWrapper::UpdateParameters(uint32_t numActive) noexcept
+{
+    std::fill(m_ShardEmitters.get(), m_ShardEmitters.get() + m_NumShards + 1, 0u);
+
+    ListenerMatrix listener;
+    if (m_ListenerMailbox.Read(listener))
+    {
+        // Rows of Unity's column major matrix. The engine's forward is -z.
+        const auto* const L = listener.Matrix;
+        const float rows[12] = {L[0], L[4], L[8], L[12], L[1], L[5], L[9], L[13], -L[2], -L[6], -L[10], -L[14]};
+        std::memcpy(m_ListenerTransform, rows, sizeof(rows));
+        m_HasListener = true;
+    }
+    if (!m_HasListener)
+    {
+        return;
+    }
+
+    // Count the emitters of every shard, and turn the counts into the start of each shard's group
+    for (auto n = 0u; n < numActive; ++n)
+    {
+        const auto i = m_ActiveSlots[n];
+        auto& slot = m_SlotStates[i];
+        if (m_EmitterMailboxes[i].Read(slot.Emitter))
+        {
+            slot.HasEmitter = true;
+        }
+        if (slot.HasEmitter)
+        {
+            ++m_ShardEmitters[GetShard(i) + 1];
+        }
+    }
+    for (auto shard = 1u; shard <= m_NumShards; ++shard)
+    {
+        m_ShardEmitters[shard] += m_ShardEmitters[shard - 1];
+    }
+    const auto numEmitters = m_ShardEmitters[m_NumShards];
+
+    // Filling in a group moves its start to its end
+    for (auto n = 0u; n < numActive; ++n)
+    {
+        const auto i = m_ActiveSlots[n];
+        const auto& slot = m_SlotStates[i];
+        if (!slot.HasEmitter)
+        {
+            continue;
+        }
+
+        const auto e = m_ShardEmitters[GetShard(i)]++;
+        m_Positions[0].Data[e] = slot.Emitter.Position[0];
+        m_Positions[1].Data[e] = slot.Emitter.Position[1];
+        m_Positions[2].Data[e] = slot.Emitter.Position[2];
+        m_Positions[3].Data[e] = slot.Emitter.DistanceGain;
+        m_EmitterSlots[e] = i;
+    }
+
+    VectorMath::Arithmetic::TransformPoints_32f(
+        m_Directions[0].Data, m_Directions[1].Data, m_Directions[2].Data, m_Positions[0].Data, m_Positions[1].Data,
+        m_Positions[2].Data, m_ListenerTransform, numEmitters);
+    VectorMath::Arithmetic::AmplitudeToDb_32f(m_Directions[3].Data, m_Positions[3].Data, numEmitters);
+}
+
+// Sends the shard's engine the parameters of its emitters. Static sources, and changes too small to hear, don't reach
+// the engine.
+void HrtfWrapper::SendParameters(uint32_t shard) noexcept
 {
-    return HrtfEngineSetParametersForSource(m_FlexEngine.Get(), index, params);
+    const auto end = m_ShardEmitters[shard];
+    for (auto n = shard > 0 ? m_ShardEmitters[shard - 1] : 0u; n < end; ++n)
+    {
+        const auto i = m_EmitterSlots[n];
+        auto& slot = m_SlotStates[i];
+        const auto& emitter = slot.Emitter;
+        const ATKVectorF direction = {m_Directions[0].Data[n], m_Directions[1].Data[n], m_Directions[2].Data[n]};
+        const auto distancePowerDb = m_Directions[3].Data[n];
+        if (slot.HasSentParams && std::fabs(distancePowerDb - slot.SentDistancePowerDb) < emitter.GainThresholdDb &&
+            !DirectionChanged(slot.SentDirection, direction, emitter.CosAngleThreshold))
+        {
+            continue;
+        }
+
+        HrtfAcousticParameters acousticParams = {};
+        acousticParams.PrimaryArrivalDirection = direction;
+        acousticParams.PrimaryArrivalGeometryPowerDb = c_DefaultPrimaryArrivalGeometryPowerDb;
+        acousticParams.PrimaryArrivalDistancePowerDb = distancePowerDb;
+        // Disable DSP for secondary arrival
+        acousticParams.SecondaryArrivalDirection = {0, 0, 0};
+
+        acousticParams.EffectiveSourceDistance = emitter.Distance;
+
+        // Start with default reverb power, then scale by distance and user parameters
+        acousticParams.EarlyReflectionsPowerDb = c_DefaultEarlyReflectionsPowerDb;
+        acousticParams.EarlyReflections60DbDecaySeconds = c_DefaultEarlyReflections60DbDecaySeconds;
+        acousticParams.LateReverb60DbDecaySeconds = c_DefaultLateReverb60DbDecaySeconds;
+        acousticParams.Outdoorness = c_DefaultOutdoorness;
+
+        if (HrtfEngineSetParametersForSource(m_FlexEngines[shard].Get(), GetShardIndex(i), &acousticParams))
+        {
+            PluginMetrics::Increment(PluginMetrics::Counter::ParameterUpdates);
+            slot.HasSentParams = true;
+            slot.SentDirection = direction;
+            slot.SentDistancePowerDb = distancePowerDb;
+        }
+    }
 }
\ No newline at end of file
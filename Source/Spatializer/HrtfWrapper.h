@@ -5,48 +5,274 @@
 #include "AlignedBuffers.h"
 #include "HrtfApi.h"
 #include "HrtfConstants.h"
+#include "JobScheduler.h"
+#include "LatestValueMailbox.h"
+#include "SlotAllocator.h"
+#include <atomic>
 #include <memory>
-#include <stack>
+#include <vector>
 
 class HrtfWrapper final
 {
 public:
+    // What a source knows about itself, posted every block. The mixer transforms the positions of all sources to
+    // listener space at once and derives the HrtfAcousticParameters from them.
+    struct EmitterParameters
+    {
+        float Position[3]; // World space
+        float DistanceGain;
+        float Distance;
+
+        // Direction and gain changes smaller than these don't reach the engine. The angle threshold is passed as its
+        // cosine, worked out by the source when the threshold is set, so that the mixer only compares dot products.
+        float CosAngleThreshold;
+        float GainThresholdDb;
+    };
+
+    // One per processing slot, preallocated by the wrapper and handed out through SourceHandle
     class SourceInfo final
     {
     public:
-        SourceInfo(uint32_t index, HrtfInputBuffer* const sourceBuffer);
-        ~SourceInfo();
+        explicit SourceInfo(uint32_t index);
 
-        bool SetParameters(HrtfAcousticParameters* params) const noexcept;
-        float* GetBuffer() const noexcept;
+        // Relative loudness used to pick a source to steal from when all slots are taken
+        void SetAudibility(float audibility) const noexcept;
         uint32_t GetIndex() const noexcept;
 
     private:
         const uint32_t m_SourceIndex;
-        HrtfInputBuffer* const m_SourceBuffer;
     };
 
-    HrtfWrapper();
+    // Returns the source's slot to the pool instead of freeing memory
+    struct SourceReleaser
+    {
+        void operator()(SourceInfo* source) const noexcept;
+
+        // Slot generation at acquisition. Once the slot is stolen, the handle no longer owns it.
+        uint32_t Generation;
+    };
+    using SourceHandle = std::unique_ptr<SourceInfo, SourceReleaser>;
+
+    // Lease on the bank a source writes the current quantum to, see BeginWrite
+    class SourceWriter final
+    {
+    public:
+        SourceWriter() noexcept;
+        SourceWriter(SourceWriter&& other) noexcept;
+        ~SourceWriter();
+
+        SourceWriter(const SourceWriter&) = delete;
+        SourceWriter& operator=(const SourceWriter&) = delete;
+        SourceWriter& operator=(SourceWriter&&) = delete;
+
+        explicit operator bool() const noexcept
+        {
+            return m_Buffer != nullptr;
+        }
+
+        // Buffer of the current quantum. The mixer renders the other bank meanwhile.
+        float* GetBuffer() const noexcept
+        {
+            return m_Buffer;
+        }
+
+        // Posts the emitter for the next HRTF pass, which applies the latest one. Does not block.
+        void SetEmitter(const EmitterParameters& emitter) const noexcept;
+
+    private:
+        friend class HrtfWrapper;
+        SourceWriter(std::atomic<uint32_t>* writers, float* buffer, uint32_t sourceIndex) noexcept;
+
+        std::atomic<uint32_t>* m_Writers;
+        float* m_Buffer;
+        uint32_t m_SourceIndex;
+    };
+
+    // Pool size, quantum and render threads, fixed for the lifetime of the wrapper
+    struct Config
+    {
+        uint32_t MaxSources;
+        uint32_t FrameCount;
+        uint32_t RenderThreads;
+    };
+
+    HrtfWrapper(uint32_t dspBufferSize, const Config& config);
     ~HrtfWrapper() = default;
 
-    static void InitWrapper();
-    static SourceInfo* GetHrtfSource();
-    static uint32_t Process(float* outputBuffer, uint32_t numSamples, uint32_t numChannels) noexcept;
+    // Creates the wrapper on first use, configured by ReadConfig
+    static void InitWrapper(uint32_t dspBufferSize);
+
+    // Posts the world to listener matrix Unity hands to spatializers, once per DSP tick. Every source may call this
+    // from any thread, the first one to get to a new tick posts it. The next HRTF pass uses the latest one.
+    static void SetListener(const float* listenerMatrix, uint64_t dspTick) noexcept;
+
+    // Defaults from HrtfConstants.h, overridden by the SPATIALIZER_HRTF_MAX_SOURCES, SPATIALIZER_HRTF_FRAME_COUNT and
+    // SPATIALIZER_HRTF_RENDER_THREADS environment variables. Values outside the supported range, or frame counts that
+    // aren't a power of two, are ignored.
+    static Config ReadConfig() noexcept;
+    static uint32_t GetMaxSources() noexcept;
+
+    // Acquires a processing slot, or returns an empty handle if none is available. Does not allocate.
+    // When the pool is exhausted, the next HRTF pass fades out the least audible source, as long as it is at least
+    // c_VoiceStealMargin quieter than audibility, and the pass after that frees its slot for a later call.
+    static SourceHandle GetHrtfSource(float audibility) noexcept;
+
+    // True once the handle lost its slot, to a louder source or because the engine had no room for it. The handle
+    // must then be dropped.
+    static bool WasStolen(const SourceHandle& source) noexcept;
+
+    // Starts writing the source's audio and emitter for the current quantum, or returns an empty writer once the slot
+    // was stolen. The mixer waits up to c_MaxWriterWaitNs for the writers of the quantum it renders and leaves out the
+    // sources that are still at it, so only hold on to one for as long as it takes to fill a DSP buffer.
+    static SourceWriter BeginWrite(const SourceHandle& source) noexcept;
+
+    // Number of frames rendered per HRTF pass. Equals the DSP buffer size in low latency mode.
+    static uint32_t GetFrameCount() noexcept;
+
+    // Renders a pass of numSamples frames to the output. Passes that take longer than numSamples at the output's
+    // sampleRate count as deadline misses.
+    static uint32_t
+    Process(float* outputBuffer, uint32_t numSamples, uint32_t numChannels, uint32_t sampleRate) noexcept;
+
+    // Frees the slots sources let go of, without rendering. For mixer callbacks that skip Process, so that new sources
+    // still get a slot while the mixer is paused.
+    static void UpdateSlots() noexcept;
 
     friend class SourceInfo;
+    friend class SourceWriter;
 
 private:
     // Methods
-    SourceInfo* GetAvailableHrtfSource();
-    void ReleaseSource(uint32_t sourceIndex);
-    uint32_t ProcessHrtfs(float* outputBuffer, uint32_t numSamples, uint32_t numChannels) noexcept;
-    bool SetParameters(uint32_t index, HrtfAcousticParameters* params) noexcept;
+    SourceHandle GetAvailableHrtfSource(float audibility) noexcept;
+    bool EndOwnership(uint32_t sourceIndex, uint32_t generation) noexcept;
+    bool WaitForWriters(uint32_t numAcquired) noexcept;
+    uint32_t UpdateOwners(uint32_t numActive) noexcept;
+    uint32_t SkipLateInputs(uint32_t numActive) noexcept;
+    void StealQuietestSource(uint32_t numActive) noexcept;
+    uint32_t ProcessHrtfs(float* outputBuffer, uint32_t numSamples, uint32_t numChannels, uint32_t sampleRate) noexcept;
+    static void RenderShard(void* context, uint32_t shard) noexcept;
+    void RecordShardTiming(uint32_t shard, uint64_t renderNs, uint32_t thread) noexcept;
+    void UpdateParameters(uint32_t numActive) noexcept;
+    void SendParameters(uint32_t shard) noexcept;
+
+    // Slots are dealt round robin to the engines, so that the lowest-first allocation keeps them evenly loaded.
+    // Each engine sees its slots as a contiguous range of local indices.
+    uint32_t GetShard(uint32_t slot) const noexcept
+    {
+        return slot % m_NumShards;
+    }
+    uint32_t GetShardIndex(uint32_t slot) const noexcept
+    {
+        return slot / m_NumShards;
+    }
+    HrtfInputBuffer& GetInputBuffer(uint32_t slot, uint32_t bank) noexcept
+    {
+        return m_HrtfInputBuffers
+            [(bank * m_NumShards + GetShard(slot)) * m_SourcesPerShard + GetShardIndex(slot)];
+    }
+    float* GetSampleBuffer(uint32_t slot, uint32_t bank) noexcept
+    {
+        return m_SampleBuffers[bank * m_MaxSources + slot].Data;
+    }
+
+    // Generation << 1 | c_Owned. The owner's release and the mixer's steal both end an ownership with a compare
+    // exchange from the generation the owner acquired, so exactly one of them frees the slot.
+    static constexpr uint32_t c_Owned = 1;
+
+    // Input audio is double buffered. Sources fill the write bank while the mixer renders and clears the other.
+    // Slots go back to the pool with both banks clear.
+    static constexpr uint32_t c_NumBanks = 2;
+
+    struct SlotState
+    {
+        std::atomic<float> Audibility;
+        std::atomic<uint32_t> Ownership;
+
+        // Writers of the source on each bank, so that the mixer can wait for the last ones after moving everyone on
+        // to the other bank, and only frees a slot once nobody writes to it
+        std::atomic<uint32_t> Writers[c_NumBanks];
+
+        // Whether the engine holds resources for the slot. Only touched on the mixer thread, which acquires them for
+        // a new owner and releases them once the ownership ended.
+        bool Rendering;
+
+        // Fade in the first quantum of the next owner. Only touched on the mixer thread.
+        bool FadeIn;
+
+        // Latest emitter. Only touched on the mixer thread.
+        bool HasEmitter;
+        EmitterParameters Emitter;
+
+        // What was last sent to the engine. Touched by the job of the slot's shard while it runs, and by the mixer
+        // thread otherwise.
+        bool HasSentParams;
+        ATKVectorF SentDirection;
+        float SentDistancePowerDb;
+    };
+
+    struct ListenerMatrix
+    {
+        float Matrix[16];
+    };
 
     // Data
     static std::unique_ptr<HrtfWrapper> s_HrtfWrapper;
 
+    const uint32_t m_MaxSources;
     AlignedStore::AlignedBuffers<float> m_SampleBuffers;
-    HrtfInputBuffer m_HrtfInputBuffers[c_HrtfMaxSources];
-    HrtfEngineHandle m_FlexEngine;
-    std::stack<unsigned char> m_AvailableProcessingSlots;
+    std::atomic<uint32_t> m_WriteBank;
+    uint32_t m_FrameCount;
+    const uint32_t m_NumShards;
+    const uint32_t m_SourcesPerShard;
+    std::unique_ptr<HrtfInputBuffer[]> m_HrtfInputBuffers;
+    std::unique_ptr<HrtfEngineHandle[]> m_FlexEngines;
+    SlotAllocator m_ProcessingSlots;
+    std::vector<SourceInfo> m_Sources;
+    std::unique_ptr<SlotState[]> m_SlotStates;
+
+    // Written by the sources, drained by the mixer thread once per pass
+    std::unique_ptr<LatestValueMailbox<EmitterParameters>[]> m_EmitterMailboxes;
+    LatestValueMailbox<ListenerMatrix> m_ListenerMailbox;
+
+    // The listener mailbox has a single writer at a time: the source that sets m_PostingListener. It posts the
+    // listener if m_ListenerTick, the DSP tick of the last one posted, is behind.
+    std::atomic<bool> m_PostingListener;
+    std::atomic<uint64_t> m_ListenerTick;
+
+    // Listener transform as rows of a 3x4 matrix, and the structure of arrays the emitters are converted in: x, y, z
+    // and distance gain, to listener space direction and distance power in dB. The emitters are grouped by shard,
+    // m_ShardEmitters holds the end of each shard's group. Written on the mixer thread, read by the shards' jobs.
+    float m_ListenerTransform[12];
+    bool m_HasListener;
+    std::unique_ptr<uint32_t[]> m_EmitterSlots;
+    std::unique_ptr<uint32_t[]> m_ShardEmitters;
+    AlignedStore::AlignedBuffers<float> m_Positions;
+    AlignedStore::AlignedBuffers<float> m_Directions;
+
+    // Snapshot of the acquired slots, taken by ProcessHrtfs once per quantum and narrowed down to the rendered ones
+    std::unique_ptr<uint32_t[]> m_ActiveSlots;
+
+    // Loudest source turned down since the last pass. At most one slot is stolen per pass, which limits churn to one
+    // voice per quantum.
+    std::atomic<float> m_StealAudibility;
+    uint32_t m_StolenSlot;
+    AlignedStore::FloatBuffer m_FadeIn;
+    AlignedStore::FloatBuffer m_FadeOut;
+
+    // Per quantum state of the shards, one shard per engine. Shards other than the first render a stereo partial
+    // mix, which the mixer thread adds to the output.
+    std::unique_ptr<uint32_t[]> m_ShardInputs;
+    AlignedStore::AlignedBuffers<float> m_PartialMixes;
+    uint32_t m_ReadBank;
+    bool m_LateWriters;
+    float* m_ShardOutput;
+    uint32_t m_ShardSamples;
+    uint32_t m_ShardChannels;
+    uint32_t m_ShardResult;
+
+    // Per job timings of the last pass, recorded to PluginMetrics by shard
+    std::unique_ptr<JobScheduler::JobTiming[]> m_JobTimings;
+
+    // Declared last so the workers stop before anything they render from goes away
+    std::unique_ptr<JobScheduler> m_Scheduler;
 };
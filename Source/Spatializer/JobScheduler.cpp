@@ -0,0 +1,259 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "JobScheduler.h"
+#include <chrono>
+
+#ifdef WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+#if defined(LINUX) || defined(ANDROID)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Lets Submit find the deque of the calling worker
+static thread_local const JobScheduler* s_CurrentScheduler = nullptr;
+static thread_local uint32_t s_CurrentThread = 0;
+
+// Best effort, the threads still work at normal priority if the process isn't allowed to raise it
+static void RaiseCurrentThreadPriority() noexcept
+{
+#ifdef WINDOWS
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#else
+    sched_param param = {};
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+#endif
+}
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Workers park on the address of the counter");
+
+// Blocks while word holds value, until WakeAll. May return early, so callers check the word again.
+static void WaitWhileEqual(std::atomic<uint32_t>& word, uint32_t value) noexcept
+{
+#ifdef WINDOWS
+    WaitOnAddress(&word, &value, sizeof(value), INFINITE);
+#elif defined(LINUX) || defined(ANDROID)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, value, nullptr, nullptr, 0);
+#else
+    (void) word;
+    (void) value;
+    std::this_thread::yield();
+#endif
+}
+
+static void WakeAll(std::atomic<uint32_t>& word) noexcept
+{
+#ifdef WINDOWS
+    WakeByAddressAll(&word);
+#elif defined(LINUX) || defined(ANDROID)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#else
+    (void) word;
+#endif
+}
+
+JobScheduler::ThreadState::ThreadState(uint32_t maxJobs) : Deque(maxJobs), Jobs(new Job[maxJobs]), NumJobs(0)
+{
+}
+
+JobScheduler::JobScheduler(uint32_t numThreads, uint32_t maxJobsPerThread)
+    : m_NumThreads(numThreads > 0 ? numThreads : 1)
+    , m_MaxJobsPerThread(maxJobsPerThread)
+    , m_Pending(0)
+    , m_Generation(0)
+    , m_Sleepers(0)
+    , m_Stop(false)
+    , m_BatchOpen(false)
+{
+    m_States.reserve(m_NumThreads);
+    for (auto i = 0u; i < m_NumThreads; ++i)
+    {
+        m_States.push_back(std::make_unique<ThreadState>(maxJobsPerThread));
+    }
+
+    m_Threads.reserve(m_NumThreads - 1);
+    for (auto i = 1u; i < m_NumThreads; ++i)
+    {
+        m_Threads.emplace_back(&JobScheduler::WorkerLoop, this, i);
+    }
+}
+
+JobScheduler::~JobScheduler()
+{
+    m_Stop.store(true, std::memory_order_relaxed);
+    m_Generation.fetch_add(1, std::memory_order_release);
+    WakeAll(m_Generation);
+    for (auto& thread : m_Threads)
+    {
+        thread.join();
+    }
+}
+
+uint64_t JobScheduler::GetTimeNs() noexcept
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+uint32_t JobScheduler::GetCurrentThreadIndex() const noexcept
+{
+    return s_CurrentScheduler == this ? s_CurrentThread : 0;
+}
+
+bool JobScheduler::Submit(JobFunction function, void* context, uint32_t index) noexcept
+{
+    const auto thread = GetCurrentThreadIndex();
+
+    // The arenas are reused once the previous batch is done and its timings are no longer needed
+    const auto startBatch = thread == 0 && !m_BatchOpen;
+    if (startBatch)
+    {
+        for (auto& state : m_States)
+        {
+            state->NumJobs = 0;
+        }
+        m_BatchOpen = true;
+    }
+
+    auto& state = *m_States[thread];
+    if (state.NumJobs == m_MaxJobsPerThread)
+    {
+        return false;
+    }
+    auto job = &state.Jobs[state.NumJobs];
+    job->Function = function;
+    job->Context = context;
+    job->Timing = {0, 0, index, thread};
+
+    // Count the job before anyone can run it
+    m_Pending.fetch_add(1, std::memory_order_acq_rel);
+    if (!state.Deque.Push(job))
+    {
+        m_Pending.fetch_sub(1, std::memory_order_acq_rel);
+        return false;
+    }
+    ++state.NumJobs;
+
+    // Parked workers count themselves before they look at the generation one last time, so either they see the new
+    // batch or it sees them
+    if (startBatch && !m_Threads.empty())
+    {
+        m_Generation.fetch_add(1, std::memory_order_seq_cst);
+        if (m_Sleepers.load(std::memory_order_seq_cst) != 0)
+        {
+            WakeAll(m_Generation);
+        }
+    }
+    return true;
+}
+
+void JobScheduler::Wait() noexcept
+{
+    auto victim = 1u;
+    while (m_Pending.load(std::memory_order_acquire) != 0)
+    {
+        if (auto job = FindJob(0, victim))
+        {
+            Execute(job, 0);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    m_BatchOpen = false;
+}
+
+uint32_t JobScheduler::GetJobTimings(JobTiming* timings, uint32_t capacity) const noexcept
+{
+    auto count = 0u;
+    for (const auto& state : m_States)
+    {
+        for (auto i = 0u; i < state->NumJobs && count < capacity; ++i)
+        {
+            timings[count++] = state->Jobs[i].Timing;
+        }
+    }
+    return count;
+}
+
+// Own jobs first, newest first while they are still in cache. Otherwise steal the oldest job of another thread,
+// starting where the last steal succeeded.
+JobScheduler::Job* JobScheduler::FindJob(uint32_t thread, uint32_t& victim) noexcept
+{
+    if (auto job = m_States[thread]->Deque.Pop())
+    {
+        return job;
+    }
+    for (auto attempt = 0u; attempt < m_NumThreads; ++attempt)
+    {
+        victim = victim % m_NumThreads;
+        if (victim != thread)
+        {
+            if (auto job = m_States[victim]->Deque.Steal())
+            {
+                return job;
+            }
+        }
+        ++victim;
+    }
+    return nullptr;
+}
+
+void JobScheduler::Execute(Job* job, uint32_t thread) noexcept
+{
+    job->Timing.Thread = thread;
+    job->Timing.StartNs = GetTimeNs();
+    job->Function(job->Context, job->Timing.Index);
+    job->Timing.EndNs = GetTimeNs();
+    m_Pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobScheduler::WorkerLoop(uint32_t thread) noexcept
+{
+    s_CurrentScheduler = this;
+    s_CurrentThread = thread;
+    RaiseCurrentThreadPriority();
+
+    auto generation = 0u;
+    auto victim = thread + 1;
+    for (;;)
+    {
+        if (m_Generation.load(std::memory_order_acquire) == generation)
+        {
+            m_Sleepers.fetch_add(1, std::memory_order_seq_cst);
+            while (m_Generation.load(std::memory_order_seq_cst) == generation)
+            {
+                WaitWhileEqual(m_Generation, generation);
+            }
+            m_Sleepers.fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (m_Stop.load(std::memory_order_acquire))
+        {
+            return;
+        }
+        generation = m_Generation.load(std::memory_order_acquire);
+
+        while (m_Pending.load(std::memory_order_acquire) != 0)
+        {
+            if (auto job = FindJob(thread, victim))
+            {
+                Execute(job, thread);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
@@ -0,0 +1,99 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include "WorkStealingDeque.h"
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+// Small job system for fanning out DSP work from the audio thread. Worker threads are started up front, run at
+// real-time priority where the platform allows it, and park between batches. Every thread owns a fixed-size
+// work-stealing deque and job arena, so nothing is allocated or locked once the scheduler is running. Workers park on
+// an atomic batch counter, which the owner bumps to start a batch. It only makes a system call to wake them if any
+// are parked.
+//
+// One thread, the owner, submits a batch and then calls Wait, which helps run the jobs. Jobs may submit more jobs
+// to the same batch. Every job records when and where it ran.
+class JobScheduler final
+{
+public:
+    using JobFunction = void (*)(void* context, uint32_t index);
+
+    struct JobTiming
+    {
+        uint64_t StartNs;
+        uint64_t EndNs;
+        uint32_t Index;
+        uint32_t Thread;
+    };
+
+    // Starts numThreads - 1 workers, the owner is the remaining thread. Each thread can queue up to
+    // maxJobsPerThread jobs per batch.
+    JobScheduler(uint32_t numThreads, uint32_t maxJobsPerThread);
+    ~JobScheduler();
+
+    JobScheduler(const JobScheduler&) = delete;
+    JobScheduler& operator=(const JobScheduler&) = delete;
+
+    uint32_t GetThreadCount() const noexcept
+    {
+        return m_NumThreads;
+    }
+
+    // Queues function(context, index) on the calling thread's deque. Call from the owner or from inside a job.
+    // Returns false if the deque is full, in which case the caller should run the job itself.
+    bool Submit(JobFunction function, void* context, uint32_t index) noexcept;
+
+    // Runs and steals jobs on the owner thread until the whole batch has finished
+    void Wait() noexcept;
+
+    // Copies the timings of the last batch to timings and returns how many were written. Call after Wait.
+    uint32_t GetJobTimings(JobTiming* timings, uint32_t capacity) const noexcept;
+
+    // Monotonic clock used for the job timings
+    static uint64_t GetTimeNs() noexcept;
+
+private:
+    struct Job
+    {
+        JobFunction Function;
+        void* Context;
+        JobTiming Timing;
+    };
+
+    // Deque, and the jobs queued on it this batch. Only the owning thread hands out jobs.
+    struct ThreadState
+    {
+        explicit ThreadState(uint32_t maxJobs);
+
+        WorkStealingDeque<Job> Deque;
+        std::unique_ptr<Job[]> Jobs;
+        uint32_t NumJobs;
+    };
+
+    uint32_t GetCurrentThreadIndex() const noexcept;
+    Job* FindJob(uint32_t thread, uint32_t& victim) noexcept;
+    void Execute(Job* job, uint32_t thread) noexcept;
+    void WorkerLoop(uint32_t thread) noexcept;
+
+    const uint32_t m_NumThreads;
+    const uint32_t m_MaxJobsPerThread;
+    std::vector<std::unique_ptr<ThreadState>> m_States;
+
+    // Jobs submitted to the current batch and not finished yet
+    std::atomic<uint32_t> m_Pending;
+
+    // Bumped at the start of every batch, and to stop. Workers that found nothing to do park on it, counted in
+    // m_Sleepers.
+    std::atomic<uint32_t> m_Generation;
+    std::atomic<uint32_t> m_Sleepers;
+    std::atomic<bool> m_Stop;
+
+    // Set by the owner's first Submit, cleared by Wait
+    bool m_BatchOpen;
+
+    std::vector<std::thread> m_Threads;
+};
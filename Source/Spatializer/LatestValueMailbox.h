@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Lock-free single writer, single reader mailbox that only keeps the latest value. Backed by a triple buffer:
+// the writer and the reader each own one copy, and hand the third one back and forth through an atomic index,
+// so neither side ever waits for the other. Writes the reader hasn't picked up yet are overwritten.
+template <typename T>
+class LatestValueMailbox final
+{
+public:
+    LatestValueMailbox() noexcept : m_WriteIndex(0), m_Shared(1), m_ReadIndex(2)
+    {
+    }
+
+    LatestValueMailbox(const LatestValueMailbox&) = delete;
+    LatestValueMailbox& operator=(const LatestValueMailbox&) = delete;
+
+    // Writer side. Publishes value, replacing any value the reader hasn't taken yet.
+    void Write(const T& value) noexcept
+    {
+        m_Values[m_WriteIndex] = value;
+        m_WriteIndex = m_Shared.exchange(m_WriteIndex | c_Fresh, std::memory_order_acq_rel) & c_IndexMask;
+    }
+
+    // Reader side. Copies the latest value to value and returns true, or returns false if nothing was written
+    // since the last read.
+    bool Read(T& value) noexcept
+    {
+        if ((m_Shared.load(std::memory_order_relaxed) & c_Fresh) == 0)
+        {
+            return false;
+        }
+        m_ReadIndex = m_Shared.exchange(m_ReadIndex, std::memory_order_acq_rel) & c_IndexMask;
+        value = m_Values[m_ReadIndex];
+        return true;
+    }
+
+    // Drops a value that hasn't been read yet
+    void Discard() noexcept
+    {
+        m_Shared.fetch_and(c_IndexMask, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint32_t c_IndexMask = 3;
+    static constexpr uint32_t c_Fresh = 4;
+
+    T m_Values[3];
+    uint32_t m_WriteIndex;
+    std::atomic<uint32_t> m_Shared;
+    uint32_t m_ReadIndex;
+};
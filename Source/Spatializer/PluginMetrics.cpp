@@ -0,0 +1,135 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "PluginMetrics.h"
+#include "RollingHistogram.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace PluginMetrics
+{
+    static RollingHistogram s_Histograms[static_cast<int>(Histogram::Count)];
+    static std::atomic<uint32_t> s_Counters[static_cast<int>(Counter::Count)];
+
+    static const char* const c_HistogramNames[] = {
+        "ProcessTimeUs", "MixerProcessTimeUs", "HrtfPassTimeUs", "ActiveSources"};
+    static const char* const c_CounterNames[] = {
+        "VoiceSteals", "AcquireFailures", "DeadlineMisses", "LateInputs", "ParameterUpdates"};
+    static_assert(sizeof(c_HistogramNames) / sizeof(c_HistogramNames[0]) == static_cast<int>(Histogram::Count), "");
+    static_assert(sizeof(c_CounterNames) / sizeof(c_CounterNames[0]) == static_cast<int>(Counter::Count), "");
+
+    // Fields of the last timing of every shard, and the number of shards recorded so far. A reader may see fields of
+    // two passes, which is fine for monitoring.
+    static std::atomic<float> s_Shards[c_MaxShards][SF_COUNT];
+    static std::atomic<uint32_t> s_NumShards(0);
+    static const char c_ShardPrefix[] = "ShardRenderTimeUs/";
+
+    void Record(Histogram histogram, float value) noexcept
+    {
+        s_Histograms[static_cast<int>(histogram)].Record(value, JobScheduler::GetTimeNs());
+    }
+
+    void Increment(Counter counter) noexcept
+    {
+        s_Counters[static_cast<int>(counter)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void RecordShard(uint32_t shard, const ShardTiming& timing) noexcept
+    {
+        if (shard >= c_MaxShards)
+        {
+            return;
+        }
+        const float fields[SF_COUNT] = {
+            timing.RenderUs,
+            static_cast<float>(timing.Thread),
+            static_cast<float>(timing.Inputs),
+            static_cast<float>(timing.FirstSlot),
+            static_cast<float>(timing.LastSlot),
+            static_cast<float>(timing.SlotStride)};
+        for (auto i = 0; i < SF_COUNT; ++i)
+        {
+            s_Shards[shard][i].store(fields[i], std::memory_order_relaxed);
+        }
+        auto numShards = s_NumShards.load(std::memory_order_relaxed);
+        while (shard >= numShards &&
+               !s_NumShards.compare_exchange_weak(numShards, shard + 1, std::memory_order_release))
+        {
+        }
+    }
+
+    // Parses the shard of a "ShardRenderTimeUs/<n>" name, or returns c_MaxShards if name isn't one
+    static uint32_t GetShard(const char* name) noexcept
+    {
+        const auto prefixLength = sizeof(c_ShardPrefix) - 1;
+        if (std::strncmp(name, c_ShardPrefix, prefixLength) != 0 || name[prefixLength] < '0' ||
+            name[prefixLength] > '9')
+        {
+            return c_MaxShards;
+        }
+        char* end = nullptr;
+        const auto shard = std::strtoul(name + prefixLength, &end, 10);
+        return *end == '\0' && shard < c_MaxShards ? static_cast<uint32_t>(shard) : c_MaxShards;
+    }
+
+    static void FillHistogram(RollingHistogram& histogram, float* buffer, int numSamples) noexcept
+    {
+        const auto snapshot = histogram.Read(JobScheduler::GetTimeNs());
+        const float fields[HF_FIRSTBUCKET] = {
+            snapshot.Mean, snapshot.GetPercentile(0.5f), snapshot.GetPercentile(0.99f), snapshot.Max,
+            static_cast<float>(snapshot.Count)};
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            if (i < HF_FIRSTBUCKET)
+            {
+                buffer[i] = fields[i];
+            }
+            else if (i - HF_FIRSTBUCKET < static_cast<int>(RollingHistogram::c_NumBuckets))
+            {
+                buffer[i] = static_cast<float>(snapshot.Buckets[i - HF_FIRSTBUCKET]);
+            }
+            else
+            {
+                buffer[i] = 0.0f;
+            }
+        }
+    }
+
+    bool GetFloatBuffer(const char* name, float* buffer, int numSamples) noexcept
+    {
+        if (name == nullptr || buffer == nullptr || numSamples <= 0)
+        {
+            return false;
+        }
+
+        for (auto i = 0; i < static_cast<int>(Histogram::Count); ++i)
+        {
+            if (std::strcmp(name, c_HistogramNames[i]) == 0)
+            {
+                FillHistogram(s_Histograms[i], buffer, numSamples);
+                return true;
+            }
+        }
+        for (auto i = 0; i < static_cast<int>(Counter::Count); ++i)
+        {
+            if (std::strcmp(name, c_CounterNames[i]) == 0)
+            {
+                std::memset(buffer, 0, numSamples * sizeof(float));
+                buffer[0] = static_cast<float>(s_Counters[i].load(std::memory_order_relaxed));
+                return true;
+            }
+        }
+
+        const auto shard = GetShard(name);
+        if (shard < s_NumShards.load(std::memory_order_acquire))
+        {
+            for (auto i = 0; i < numSamples; ++i)
+            {
+                buffer[i] = i < SF_COUNT ? s_Shards[shard][i].load(std::memory_order_relaxed) : 0.0f;
+            }
+            return true;
+        }
+        return false;
+    }
+} // namespace PluginMetrics
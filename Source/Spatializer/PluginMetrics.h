@@ -0,0 +1,112 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include "HrtfConstants.h"
+#include "JobScheduler.h"
+#include <stdint.h>
+
+// Process-wide load statistics of the spatializer and the mixer, readable from Unity through GetFloatBufferCallback
+// of either plugin. Recording is lock-free and doesn't allocate, so it is safe on the audio threads.
+//
+// Histogram metrics cover roughly the last second, see RollingHistogram, and fill the buffer with the fields of
+// HistogramField followed by the bucket counts, as far as numsamples allows:
+//   "ProcessTimeUs"       Spatializer ProcessCallback, in microseconds
+//   "MixerProcessTimeUs"  Spatializer Mixer ProcessCallback, in microseconds
+//   "HrtfPassTimeUs"      HrtfWrapper::Process, in microseconds
+//   "ActiveSources"       Sources rendered per HRTF pass
+// Counter metrics fill the first element with the total since the plugin was loaded:
+//   "VoiceSteals"         Sources handed over to a louder source
+//   "AcquireFailures"     Requests for an HRTF source that were turned down
+//   "DeadlineMisses"      HRTF passes that took longer than a quantum of audio
+//   "LateInputs"          Source quanta left out of an HRTF pass because the source was still writing them
+//   "ParameterUpdates"    Source parameters sent to the HRTF engines, changes below a source's thresholds aren't
+// Shard metrics describe the last HRTF pass that rendered sources, one per engine shard, and fill the buffer with the
+// fields of ShardField:
+//   "ShardRenderTimeUs/<n>"  Job of shard n, which renders slots FirstSlot, FirstSlot + SlotStride, ... LastSlot
+namespace PluginMetrics
+{
+    enum class Histogram
+    {
+        SpatializerProcessUs,
+        MixerProcessUs,
+        HrtfPassUs,
+        ActiveSources,
+        Count
+    };
+
+    enum class Counter
+    {
+        VoiceSteals,
+        AcquireFailures,
+        DeadlineMisses,
+        LateInputs,
+        ParameterUpdates,
+        Count
+    };
+
+    enum HistogramField
+    {
+        HF_MEAN,
+        HF_MEDIAN,
+        HF_P99,
+        HF_MAX,
+        HF_COUNT,
+        HF_FIRSTBUCKET
+    };
+
+    enum ShardField
+    {
+        SF_RENDERUS,
+        SF_THREAD,
+        SF_INPUTS,
+        SF_FIRSTSLOT,
+        SF_LASTSLOT,
+        SF_SLOTSTRIDE,
+        SF_COUNT
+    };
+
+    constexpr uint32_t c_MaxShards = c_HrtfMaxRenderThreads * c_HrtfEnginesPerRenderThread;
+
+    // Time a shard's job took, the render thread it ran on, and the engine inputs it rendered
+    struct ShardTiming
+    {
+        float RenderUs;
+        uint32_t Thread;
+        uint32_t Inputs;
+        uint32_t FirstSlot;
+        uint32_t LastSlot;
+        uint32_t SlotStride;
+    };
+
+    void Record(Histogram histogram, float value) noexcept;
+    void Increment(Counter counter) noexcept;
+
+    // Replaces the timing of shard. Shards from c_MaxShards on are ignored.
+    void RecordShard(uint32_t shard, const ShardTiming& timing) noexcept;
+
+    // Fills buffer with the metric called name and zeros the rest. Returns false if there's no such metric.
+    bool GetFloatBuffer(const char* name, float* buffer, int numSamples) noexcept;
+
+    // Records the time from construction to destruction, in microseconds
+    class ScopedTiming final
+    {
+    public:
+        explicit ScopedTiming(Histogram histogram) noexcept
+            : m_Histogram(histogram), m_StartNs(JobScheduler::GetTimeNs())
+        {
+        }
+
+        ~ScopedTiming()
+        {
+            Record(m_Histogram, (JobScheduler::GetTimeNs() - m_StartNs) * 0.001f);
+        }
+
+        ScopedTiming(const ScopedTiming&) = delete;
+        ScopedTiming& operator=(const ScopedTiming&) = delete;
+
+    private:
+        const Histogram m_Histogram;
+        const uint64_t m_StartNs;
+    };
+} // namespace PluginMetrics
@@ -0,0 +1,150 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdint.h>
+
+// Lock-free histogram of the values recorded in the last second or so. Values are counted in quarter octave buckets:
+// bucket 0 holds values below 1, bucket b holds [2^((b - 1) / 4), 2^(b / 4)), and the last bucket everything above.
+// The counts are kept in c_NumWindows windows of c_WindowNs each, the oldest of which is cleared and reused as time
+// moves on. Record may be called from any number of threads at once and never blocks, allocates or waits. Values
+// recorded while another thread reuses a window can get lost, which is fine for monitoring.
+class RollingHistogram final
+{
+public:
+    static constexpr uint32_t c_NumBuckets = 64;
+    static constexpr uint32_t c_NumWindows = 4;
+    static constexpr uint64_t c_WindowNs = 250000000;
+
+    struct Snapshot
+    {
+        uint32_t Count;
+        float Mean;
+        float Max;
+        uint32_t Buckets[c_NumBuckets];
+
+        // Upper edge of the bucket the given fraction of the values falls in, capped at the largest value
+        float GetPercentile(float fraction) const noexcept
+        {
+            const auto rank = static_cast<uint32_t>(std::ceil(fraction * Count));
+            auto seen = 0u;
+            for (auto b = 0u; b < c_NumBuckets; ++b)
+            {
+                seen += Buckets[b];
+                if (seen >= rank && seen > 0)
+                {
+                    return std::min(GetBucketLimit(b), Max);
+                }
+            }
+            return Max;
+        }
+    };
+
+    RollingHistogram() noexcept : m_Current(0), m_WindowStartNs(0)
+    {
+        for (auto& window : m_Windows)
+        {
+            Clear(window);
+        }
+    }
+
+    RollingHistogram(const RollingHistogram&) = delete;
+    RollingHistogram& operator=(const RollingHistogram&) = delete;
+
+    void Record(float value, uint64_t nowNs) noexcept
+    {
+        Advance(nowNs);
+        auto& window = m_Windows[m_Current.load(std::memory_order_acquire)];
+        window.Buckets[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+        window.Count.fetch_add(1, std::memory_order_relaxed);
+        window.SumMilli.fetch_add(static_cast<uint64_t>(std::max(value, 0.0f) * 1000.0f), std::memory_order_relaxed);
+        auto max = window.Max.load(std::memory_order_relaxed);
+        while (value > max && !window.Max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // Sums the windows. Windows older than the rolling period are dropped first.
+    Snapshot Read(uint64_t nowNs) noexcept
+    {
+        Advance(nowNs);
+        Snapshot snapshot = {};
+        uint64_t sumMilli = 0;
+        for (const auto& window : m_Windows)
+        {
+            for (auto b = 0u; b < c_NumBuckets; ++b)
+            {
+                snapshot.Buckets[b] += window.Buckets[b].load(std::memory_order_relaxed);
+            }
+            snapshot.Count += window.Count.load(std::memory_order_relaxed);
+            sumMilli += window.SumMilli.load(std::memory_order_relaxed);
+            snapshot.Max = std::max(snapshot.Max, window.Max.load(std::memory_order_relaxed));
+        }
+        snapshot.Mean = snapshot.Count > 0 ? static_cast<float>(sumMilli * 0.001 / snapshot.Count) : 0.0f;
+        return snapshot;
+    }
+
+    // Exclusive upper edge of a bucket
+    static float GetBucketLimit(uint32_t bucket) noexcept
+    {
+        return std::exp2(bucket * 0.25f);
+    }
+
+private:
+    struct Window
+    {
+        std::atomic<uint32_t> Buckets[c_NumBuckets];
+        std::atomic<uint32_t> Count;
+        std::atomic<uint64_t> SumMilli; // Sum of the values in thousandths
+        std::atomic<float> Max;
+    };
+
+    static uint32_t GetBucket(float value) noexcept
+    {
+        if (!(value >= 1.0f))
+        {
+            return 0;
+        }
+        const auto bucket = static_cast<uint32_t>(std::log2(value) * 4.0f) + 1;
+        return std::min(bucket, c_NumBuckets - 1);
+    }
+
+    static void Clear(Window& window) noexcept
+    {
+        for (auto& bucket : window.Buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        window.Count.store(0, std::memory_order_relaxed);
+        window.SumMilli.store(0, std::memory_order_relaxed);
+        window.Max.store(0.0f, std::memory_order_relaxed);
+    }
+
+    // Moves on by one window per c_WindowNs that passed. The thread that wins the exchange of the start time clears
+    // the windows that expired, the others go on recording into the current one.
+    void Advance(uint64_t nowNs) noexcept
+    {
+        auto start = m_WindowStartNs.load(std::memory_order_relaxed);
+        if (nowNs < start + c_WindowNs ||
+            !m_WindowStartNs.compare_exchange_strong(start, nowNs, std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        const auto expired = std::min<uint64_t>((nowNs - start) / c_WindowNs, c_NumWindows);
+        auto current = m_Current.load(std::memory_order_relaxed);
+        for (auto i = 0u; i < expired; ++i)
+        {
+            current = (current + 1) % c_NumWindows;
+            Clear(m_Windows[current]);
+        }
+        m_Current.store(current, std::memory_order_release);
+    }
+
+    Window m_Windows[c_NumWindows];
+    std::atomic<uint32_t> m_Current;
+    std::atomic<uint64_t> m_WindowStartNs;
+};
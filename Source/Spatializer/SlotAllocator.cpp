@@ -0,0 +1,104 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "SlotAllocator.h"
+#if _MSC_VER
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit. value must not be zero.
+static uint32_t FindFirstSetBit(uint32_t value) noexcept
+{
+#if _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return static_cast<uint32_t>(index);
+#else
+    return static_cast<uint32_t>(__builtin_ctz(value));
+#endif
+}
+
+// Index of the lowest clear bit. value must not be all ones.
+static uint32_t FindFirstClearBit(uint32_t value) noexcept
+{
+    return FindFirstSetBit(~value);
+}
+
+SlotAllocator::SlotAllocator(uint32_t capacity)
+    : m_Capacity(capacity)
+    , m_NumWords((capacity + c_BitsPerWord - 1) / c_BitsPerWord)
+    , m_Words(new std::atomic<uint32_t>[m_NumWords])
+{
+    for (auto i = 0u; i < m_NumWords; ++i)
+    {
+        m_Words[i].store(0, std::memory_order_relaxed);
+    }
+
+    // Bits past the capacity are permanently taken so they are never handed out
+    const auto unused = m_NumWords * c_BitsPerWord - capacity;
+    if (unused > 0)
+    {
+        m_Words[m_NumWords - 1].store(~0u << (c_BitsPerWord - unused), std::memory_order_relaxed);
+    }
+}
+
+uint32_t SlotAllocator::Acquire() noexcept
+{
+    for (auto i = 0u; i < m_NumWords; ++i)
+    {
+        auto& word = m_Words[i];
+        auto current = word.load(std::memory_order_relaxed);
+
+        // A failed exchange refreshes current, retry until this word is full or a bit is claimed
+        while (current != ~0u)
+        {
+            const auto bit = FindFirstClearBit(current);
+            if (word.compare_exchange_weak(
+                    current, current | (1u << bit), std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                return i * c_BitsPerWord + bit;
+            }
+        }
+    }
+    return c_InvalidSlot;
+}
+
+void SlotAllocator::Release(uint32_t slot) noexcept
+{
+    if (slot < m_Capacity)
+    {
+        m_Words[slot / c_BitsPerWord].fetch_and(~(1u << (slot % c_BitsPerWord)), std::memory_order_release);
+    }
+}
+
+bool SlotAllocator::IsAcquired(uint32_t slot) const noexcept
+{
+    if (slot >= m_Capacity)
+    {
+        return false;
+    }
+    return (m_Words[slot / c_BitsPerWord].load(std::memory_order_acquire) & (1u << (slot % c_BitsPerWord))) != 0;
+}
+
+uint32_t SlotAllocator::GetAcquiredSlots(uint32_t* slots) const noexcept
+{
+    auto count = 0u;
+    for (auto i = 0u; i < m_NumWords; ++i)
+    {
+        auto word = m_Words[i].load(std::memory_order_acquire);
+
+        // Skip the permanently taken bits past the capacity
+        const auto bitsInWord = m_Capacity - i * c_BitsPerWord;
+        if (bitsInWord < c_BitsPerWord)
+        {
+            word &= (1u << bitsInWord) - 1;
+        }
+
+        while (word != 0)
+        {
+            slots[count++] = i * c_BitsPerWord + FindFirstSetBit(word);
+            word &= word - 1;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,41 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+// Lock-free allocator for a fixed number of slots, backed by an atomic bitmap where a set bit marks a slot in use.
+// Acquire and Release may be called concurrently from any thread. Neither blocks nor allocates.
+class SlotAllocator final
+{
+public:
+    static constexpr uint32_t c_InvalidSlot = UINT32_MAX;
+
+    explicit SlotAllocator(uint32_t capacity);
+
+    uint32_t GetCapacity() const noexcept
+    {
+        return m_Capacity;
+    }
+
+    // Returns the lowest free slot, or c_InvalidSlot if all slots are in use
+    uint32_t Acquire() noexcept;
+
+    // Returns a slot obtained from Acquire to the pool
+    void Release(uint32_t slot) noexcept;
+
+    bool IsAcquired(uint32_t slot) const noexcept;
+
+    // Writes the acquired slots to slots in ascending order and returns how many there are.
+    // slots must hold GetCapacity() entries. The cost grows with the number of acquired slots, not the capacity.
+    uint32_t GetAcquiredSlots(uint32_t* slots) const noexcept;
+
+private:
+    static constexpr uint32_t c_BitsPerWord = 32;
+
+    const uint32_t m_Capacity;
+    const uint32_t m_NumWords;
+    std::unique_ptr<std::atomic<uint32_t>[]> m_Words;
+};
@@ -4,6 +4,8 @@
 
 #include "AudioPluginUtil.h"
 #include "HrtfWrapper.h"
+#include "PluginMetrics.h"
+#include "Tracing.h"
 #include "vectormath.h"
 #include "mathutility.h"
 
@@ -31,19 +33,21 @@ namespace SpatializerMixer
         std::memset(effectdata, 0, sizeof(EffectData));
         state->effectdata = effectdata;
 
+        // Initialize the wrapper so that the initial value of MultichannelPanning gets recorded.
+        // This also fixes the HRTF quantum, which matches the DSP buffer size in low latency mode.
+        HrtfWrapper::InitWrapper(state->dspbuffersize);
+        const auto frameCount = HrtfWrapper::GetFrameCount();
+
         // If the DSP buffer size is smaller than the HRTF quantum, allocate a history buffer.
         // Checking for DSP buffer sizes for PowerOfTwo alignment guarantees integral multiples fit within the HRTF
         // quantum. Unity DSP buffer sizes are PowerOfTwo aligned so this is just extra validation.
-        if (state->dspbuffersize < c_HrtfFrameCount && IsPowerOfTwo(state->dspbuffersize))
+        if (state->dspbuffersize < frameCount && IsPowerOfTwo(state->dspbuffersize))
         {
-            effectdata->HrtfHistoryBuffer = std::make_unique<float[]>(2 * c_HrtfFrameCount);
-            std::memset(effectdata->HrtfHistoryBuffer.get(), 0, (2 * c_HrtfFrameCount * sizeof(float)));
+            effectdata->HrtfHistoryBuffer = std::make_unique<float[]>(2 * frameCount);
+            std::memset(effectdata->HrtfHistoryBuffer.get(), 0, (2 * frameCount * sizeof(float)));
             effectdata->ReadOffset = 0;
         }
 
-        // Initialize the wrapper so that the initial value of MultichannelPanning gets recorded
-        HrtfWrapper::InitWrapper();
-
         return UNITY_AUDIODSP_OK;
     }
 
@@ -69,21 +73,30 @@ namespace SpatializerMixer
         return UNITY_AUDIODSP_OK;
     }
 
-    int UNITY_AUDIODSP_CALLBACK GetFloatBufferCallback(UnityAudioEffectState*, const char*, float*, int)
+    // Load statistics shared by all instances, see PluginMetrics.h for the names
+    int UNITY_AUDIODSP_CALLBACK
+    GetFloatBufferCallback(UnityAudioEffectState*, const char* name, float* buffer, int numsamples)
     {
-        return UNITY_AUDIODSP_OK;
+        return PluginMetrics::GetFloatBuffer(name, buffer, numsamples) ? UNITY_AUDIODSP_OK
+                                                                        : UNITY_AUDIODSP_ERR_UNSUPPORTED;
     }
 
     UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK ProcessCallback(
         UnityAudioEffectState* state, float* inBuffer, float* outBuffer, unsigned int length, int inChannels,
         int outChannels)
     {
+        SPATIALIZER_TRACE_SCOPE("SpatializerMixer::ProcessCallback");
+        PluginMetrics::ScopedTiming timing(PluginMetrics::Histogram::MixerProcessUs);
+        const auto frameCount = HrtfWrapper::GetFrameCount();
+
         // Check that I/O formats are right and that the host API supports this feature
         if (!(state->flags & UnityAudioEffectStateFlags_IsPlaying) ||
             (state->flags & UnityAudioEffectStateFlags_IsPaused) ||
             (state->flags & UnityAudioEffectStateFlags_IsMuted) || !IsPowerOfTwo(state->dspbuffersize) ||
-            state->dspbuffersize > c_HrtfFrameCount || state->dspbuffersize != length)
+            state->dspbuffersize > frameCount || state->dspbuffersize != length)
         {
+            // Sources that stop meanwhile must not keep their slots
+            HrtfWrapper::UpdateSlots();
             std::memcpy(outBuffer, inBuffer, length * outChannels * sizeof(float));
             return UNITY_AUDIODSP_OK;
         }
@@ -94,7 +107,7 @@ namespace SpatializerMixer
         if (data->HrtfHistoryBuffer != nullptr)
         {
             // Call HRTF processing if it's time
-            auto ticksPerHrtfBuffer = c_HrtfFrameCount / length;
+            auto ticksPerHrtfBuffer = frameCount / length;
             auto currentTick = (state->currdsptick / length) % ticksPerHrtfBuffer;
             if (currentTick == (ticksPerHrtfBuffer - 1))
             {
@@ -102,9 +115,11 @@ namespace SpatializerMixer
                 data->ReadOffset = 0;
 
                 // In case of failure, fill with silence
-                if (HrtfWrapper::Process(data->HrtfHistoryBuffer.get(), c_HrtfFrameCount, outChannels) == 0)
+                const auto rendered =
+                    HrtfWrapper::Process(data->HrtfHistoryBuffer.get(), frameCount, outChannels, state->samplerate);
+                if (rendered == 0)
                 {
-                    std::memset(data->HrtfHistoryBuffer.get(), 0, c_HrtfFrameCount * outChannels * sizeof(float));
+                    std::memset(data->HrtfHistoryBuffer.get(), 0, frameCount * outChannels * sizeof(float));
                 }
             }
 
@@ -118,11 +133,11 @@ namespace SpatializerMixer
             // Mix output into the stereo content
             VectorMath::Arithmetic::Add_32f_I(outBuffer, inBuffer, length * inChannels);
         }
-        // Non-buffered path
+        // Non-buffered path, taken when the DSP buffer matches the HRTF quantum or in low latency mode
         else
         {
             // Do a mix only if the Process call produces any samples
-            if (HrtfWrapper::Process(outBuffer, length, outChannels) > 0)
+            if (HrtfWrapper::Process(outBuffer, length, outChannels, state->samplerate) > 0)
             {
                 // Mix output into the stereo content
                 VectorMath::Arithmetic::Add_32f_I(outBuffer, inBuffer, length * inChannels);
@@ -4,27 +4,69 @@
 
 #include "AudioPluginUtil.h"
 #include "HrtfWrapper.h"
+#include "PluginMetrics.h"
+#include "Tracing.h"
 #include "vectormath.h"
 #include "mathutility.h"
 
 #include <math.h>
 #include <algorithm>
+#include <cmath>
 #include <memory>
 #include <cstring>
 
 namespace Spatializer
 {
+    enum Param
+    {
+        P_VOICEHOLD,
+        P_PRIORITY,
+        P_ANGLETHRESHOLD,
+        P_GAINTHRESHOLD,
+        P_NUM
+    };
+
     struct EffectData
     {
-        std::unique_ptr<HrtfWrapper::SourceInfo> EffectHrtfInfo;
+        HrtfWrapper::SourceHandle EffectHrtfInfo;
         float SourceDistance;
         float DryDistanceAttenuation;
+        float Params[P_NUM];
+
+        // Cosine of Params[P_ANGLETHRESHOLD], what the mixer compares direction changes against
+        float CosAngleThreshold;
+
+        // Spatial blend the last callback ended on, the next one ramps from there. 0 while passing through.
+        float SpatialBlend;
+
+        // Consecutive frames the source has been too quiet to spatialize
+        uint64_t SilentFrames;
     };
 
+    // Worked out when the angle threshold is set rather than on every pass of the mixer
+    void UpdateCosAngleThreshold(EffectData* data)
+    {
+        data->CosAngleThreshold = std::cos(data->Params[P_ANGLETHRESHOLD] * DegToRadian);
+    }
+
     int InternalRegisterEffectDefinition(UnityAudioEffectDefinition& definition)
     {
+        definition.paramdefs = new UnityAudioParameterDefinition[P_NUM];
+        RegisterParameter(
+            definition, "Voice Hold", "ms", 0.0f, c_MaxVoiceHoldMs, c_DefaultVoiceHoldMs, 1.0f, 1.0f, P_VOICEHOLD,
+            "How long a silent source keeps its HRTF resources before releasing them");
+        RegisterParameter(
+            definition, "Priority", "", 0.0f, 10.0f, 1.0f, 1.0f, 1.0f, P_PRIORITY,
+            "Audibility weight when sources compete for HRTF resources");
+        RegisterParameter(
+            definition, "Angle Threshold", "deg", 0.0f, c_MaxParameterAngleThreshold,
+            c_DefaultParameterAngleThreshold, 1.0f, 1.0f, P_ANGLETHRESHOLD,
+            "Smallest change in source direction that updates the HRTF");
+        RegisterParameter(
+            definition, "Gain Threshold", "dB", 0.0f, c_MaxParameterGainThresholdDb, c_DefaultParameterGainThresholdDb,
+            1.0f, 1.0f, P_GAINTHRESHOLD, "Smallest change in distance attenuation that updates the HRTF");
         definition.flags |= UnityAudioEffectDefinitionFlags_IsSpatializer;
-        return 0;
+        return P_NUM;
     }
 
     static UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK DistanceAttenuationCallback(
@@ -52,10 +94,11 @@ namespace Spatializer
         std::memset(effectdata, 0, sizeof(EffectData));
         state->effectdata = effectdata;
         state->spatializerdata->distanceattenuationcallback = DistanceAttenuationCallback;
-        InitParametersFromDefinitions(InternalRegisterEffectDefinition, nullptr);
-        HrtfWrapper::InitWrapper();
+        InitParametersFromDefinitions(InternalRegisterEffectDefinition, effectdata->Params);
+        UpdateCosAngleThreshold(effectdata);
+        HrtfWrapper::InitWrapper(state->dspbuffersize);
 
-        effectdata->EffectHrtfInfo.reset(HrtfWrapper::GetHrtfSource());
+        effectdata->EffectHrtfInfo = HrtfWrapper::GetHrtfSource(0.0f);
 
         return effectdata->EffectHrtfInfo ? UNITY_AUDIODSP_OK : UNITY_AUDIODSP_ERR_UNSUPPORTED;
     }
@@ -72,95 +115,109 @@ namespace Spatializer
         return UNITY_AUDIODSP_OK;
     }
 
-    UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK SetFloatParameterCallback(UnityAudioEffectState*, int, float)
+    UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK
+    SetFloatParameterCallback(UnityAudioEffectState* state, int index, float value)
     {
+        auto data = state->GetEffectData<EffectData>();
+        if (data == nullptr || index < 0 || index >= P_NUM)
+        {
+            return UNITY_AUDIODSP_ERR_UNSUPPORTED;
+        }
+        data->Params[index] = value;
+        if (index == P_ANGLETHRESHOLD)
+        {
+            UpdateCosAngleThreshold(data);
+        }
         return UNITY_AUDIODSP_OK;
     }
 
-    UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK GetFloatParameterCallback(UnityAudioEffectState*, int, float*, char*)
+    UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK
+    GetFloatParameterCallback(UnityAudioEffectState* state, int index, float* value, char* valuestr)
     {
+        auto data = state->GetEffectData<EffectData>();
+        if (data == nullptr || index < 0 || index >= P_NUM)
+        {
+            return UNITY_AUDIODSP_ERR_UNSUPPORTED;
+        }
+        if (value != nullptr)
+        {
+            *value = data->Params[index];
+        }
+        if (valuestr != nullptr)
+        {
+            valuestr[0] = 0;
+        }
         return UNITY_AUDIODSP_OK;
     }
 
-    int UNITY_AUDIODSP_CALLBACK GetFloatBufferCallback(UnityAudioEffectState*, const char*, float*, int)
+    // Load statistics shared by all instances, see PluginMetrics.h for the names
+    int UNITY_AUDIODSP_CALLBACK
+    GetFloatBufferCallback(UnityAudioEffectState*, const char* name, float* buffer, int numsamples)
     {
-        return UNITY_AUDIODSP_OK;
+        return PluginMetrics::GetFloatBuffer(name, buffer, numsamples) ? UNITY_AUDIODSP_OK
+                                                                        : UNITY_AUDIODSP_ERR_UNSUPPORTED;
     }
 
-    static ATKVectorF ListenerToSourceDirection(const float* sourceMatrix, const float* listenerMatrix)
+    // There's no acoustics support yet, the mixer derives the parameters using a through-the-wall method
+    void UpdateAcousticParams(
+        const UnityAudioEffectState* state, const EffectData* data, const HrtfWrapper::SourceWriter& writer)
     {
-        const auto* const S = sourceMatrix;
-        const auto* const L = listenerMatrix;
-
         // S[12] = SourcePos.x, S[13] = SourcePos.y, S[14] = SourcePos.z
-        auto loc_x = L[0] * S[12] + L[4] * S[13] + L[8] * S[14] + L[12];
-        auto loc_y = L[1] * S[12] + L[5] * S[13] + L[9] * S[14] + L[13];
-        auto loc_z = -(L[2] * S[12] + L[6] * S[13] + L[10] * S[14] + L[14]);
-
-        return {loc_x, loc_y, loc_z};
-    }
-
-    // Update acoustic params with default values
-    void UpdateAcousticParams(const EffectData* data, const ATKVectorF direction)
-    {
-        if (data->EffectHrtfInfo)
-        {
-            HrtfAcousticParameters acousticParams = {};
-            acousticParams.PrimaryArrivalDirection = direction;
-            acousticParams.PrimaryArrivalGeometryPowerDb = c_DefaultPrimaryArrivalGeometryPowerDb;
-            acousticParams.PrimaryArrivalDistancePowerDb = AmplitudeToDb(data->DryDistanceAttenuation);
-            // Disable DSP for secondary arrival
-            acousticParams.SecondaryArrivalDirection = {0, 0, 0};
-
-            acousticParams.EffectiveSourceDistance = data->SourceDistance;
-
-            // Start with default reverb power, then scale by distance and user parameters
-            acousticParams.EarlyReflectionsPowerDb = c_DefaultEarlyReflectionsPowerDb;
-            acousticParams.EarlyReflections60DbDecaySeconds = c_DefaultEarlyReflections60DbDecaySeconds;
-            acousticParams.LateReverb60DbDecaySeconds = c_DefaultLateReverb60DbDecaySeconds;
-            acousticParams.Outdoorness = c_DefaultOutdoorness;
-
-            data->EffectHrtfInfo->SetParameters(&acousticParams);
-        }
+        const auto* const S = state->spatializerdata->sourcematrix;
+        HrtfWrapper::EmitterParameters emitter;
+        emitter.Position[0] = S[12];
+        emitter.Position[1] = S[13];
+        emitter.Position[2] = S[14];
+        emitter.DistanceGain = data->DryDistanceAttenuation;
+        emitter.Distance = data->SourceDistance;
+        emitter.CosAngleThreshold = data->CosAngleThreshold;
+        emitter.GainThresholdDb = data->Params[P_GAINTHRESHOLD];
+        writer.SetEmitter(emitter);
+        HrtfWrapper::SetListener(state->spatializerdata->listenermatrix, state->currdsptick);
     }
 
     // Both inbuffer and outbuffer are assumed to be stereo, and the same length
     void PrepareAudioData(
-        const UnityAudioEffectState* state, const float* inbuffer, float* outbuffer, const unsigned int length,
-        int inChannels)
+        const UnityAudioEffectState* state, const HrtfWrapper::SourceWriter& writer, const float* inbuffer,
+        float* outbuffer, const unsigned int length, int inChannels)
     {
-        auto ticksPerHrtfBuffer = c_HrtfFrameCount / state->dspbuffersize;
+        auto ticksPerHrtfBuffer = HrtfWrapper::GetFrameCount() / state->dspbuffersize;
         auto currentTick = (state->currdsptick / state->dspbuffersize) % ticksPerHrtfBuffer;
         auto offsetIntoHrtfBuffer = currentTick * state->dspbuffersize;
 
         auto data = state->GetEffectData<EffectData>();
-        auto hrtfBuffer = data->EffectHrtfInfo->GetBuffer() + offsetIntoHrtfBuffer;
-        auto spatialBlend = state->spatializerdata->spatialblend;
+        auto hrtfBuffer = writer.GetBuffer() + offsetIntoHrtfBuffer;
+        const auto spatialBlend = std::min(state->spatializerdata->spatialblend, 1.0f);
+        const auto previousBlend = data->SpatialBlend;
+        data->SpatialBlend = spatialBlend;
 
         // Unity downmixes multichannel to stereo, or upmixes mono to stereo, before handing
         // to spatializer, but audio buffer may have additional empty channels depending on size
         // of final output device. Ignore these channels and just downmix stereo to mono.
-        for (auto i = 0u; i < length; ++i)
+        if (spatialBlend < 1.0f || previousBlend < 1.0f)
         {
-            hrtfBuffer[i] = (inbuffer[i * inChannels] + inbuffer[i * inChannels + 1]);
-        }
-        VectorMath::Arithmetic::MulC_32f(hrtfBuffer, hrtfBuffer, 0.5, length);
-
-        // At this point, we'll get 100% HRTF signal. We want to apply the "spatialblend" param
-        // To do this, adjust the amount of signal sent to the hrtfInputBuffer, and send some stereo
-        // to the output buffer
-        if (spatialBlend < 1.0f)
-        {
-            VectorMath::Arithmetic::MulC_32f(hrtfBuffer, hrtfBuffer, spatialBlend, length);
-            VectorMath::Arithmetic::MulC_32f(outbuffer, inbuffer, 1 - spatialBlend, length * inChannels);
+            // We want to apply the "spatialblend" param. To do this, adjust the amount of signal sent to the
+            // hrtfInputBuffer, and send some stereo to the output buffer. The gains ramp from the previous blend
+            // across the callback, so that blend changes don't click.
+            const auto blendStep = (spatialBlend - previousBlend) / length;
+            VectorMath::Arithmetic::DownmixCrossfade_32f(
+                hrtfBuffer, outbuffer, inbuffer, inChannels, previousBlend, blendStep, length);
         }
         else
         {
+            VectorMath::Arithmetic::DownmixStereo_32f(hrtfBuffer, inbuffer, inChannels, 0.5f, length);
+
             // If spatial blend == 1, we don't want any stereo signal bleeding through.
             std::memset(outbuffer, 0, length * inChannels * sizeof(float));
         }
     }
 
+    // How loud the source is in the mix, weighted by the user priority. Used to pick voices to steal.
+    static float GetAudibility(const UnityAudioEffectState* state, const EffectData* data)
+    {
+        return data->DryDistanceAttenuation * state->spatializerdata->spatialblend * data->Params[P_PRIORITY];
+    }
+
     // There's a lot of conditions in which the Spatializer should disable itself and operate in passthrough mode
     // This function helps clarify when that is
     bool ShouldSpatialize(UnityAudioEffectState* state)
@@ -173,7 +230,7 @@ namespace Spatializer
 
         // DSP buffer size must be a power of two aligned and smaller than HRTF quantum.
         // This ensures even multiples fit inside a single HRTF pass for buffering.
-        if (!IsPowerOfTwo(state->dspbuffersize) || state->dspbuffersize > c_HrtfFrameCount)
+        if (!IsPowerOfTwo(state->dspbuffersize) || state->dspbuffersize > HrtfWrapper::GetFrameCount())
         {
             return false;
         }
@@ -201,6 +258,9 @@ namespace Spatializer
         UnityAudioEffectState* state, float* inbuffer, float* outbuffer, unsigned int length, int inChannels,
         int outChannels)
     {
+        SPATIALIZER_TRACE_SCOPE("Spatializer::ProcessCallback");
+        PluginMetrics::ScopedTiming timing(PluginMetrics::Histogram::SpatializerProcessUs);
+
         // Don't need to support this because it doesn't seem this scenario exists in the Unity audio engine
         if (inChannels != outChannels)
         {
@@ -209,19 +269,41 @@ namespace Spatializer
 
         auto data = state->GetEffectData<EffectData>();
 
+        // A louder source took over the slot, let go of it and compete for a new one below
+        if (data && HrtfWrapper::WasStolen(data->EffectHrtfInfo))
+        {
+            data->EffectHrtfInfo = nullptr;
+        }
+
         if (!ShouldSpatialize(state))
         {
-            // Clearing out the SourceInfo releases the source and prevents hrtf processing
             if (data)
             {
-                data->EffectHrtfInfo = nullptr;
-
                 // If we're not spatializing because the gain is too low, mute the output
                 if (data->DryDistanceAttenuation <= c_MinAudibleGain)
                 {
+                    // Keep the source virtualized through brief dips so it resumes without re-acquiring and
+                    // resetting its filters. Nothing is written to its HRTF buffer, so the engine renders silence.
+                    data->SilentFrames += length;
+                    const auto holdFrames =
+                        static_cast<uint64_t>(data->Params[P_VOICEHOLD] * 0.001f * state->samplerate);
+                    if (data->SilentFrames > holdFrames)
+                    {
+                        data->EffectHrtfInfo = nullptr;
+                    }
+                    else if (data->EffectHrtfInfo)
+                    {
+                        // Silent sources are the first to go when a louder one needs a slot
+                        data->EffectHrtfInfo->SetAudibility(0.0f);
+                    }
+
                     memset(outbuffer, 0, length * outChannels * sizeof(float));
                     return UNITY_AUDIODSP_OK;
                 }
+
+                // Clearing out the SourceInfo releases the source and prevents hrtf processing
+                data->EffectHrtfInfo = nullptr;
+                data->SpatialBlend = 0.0f;
             }
 
             // In all other cases, do a pass-through
@@ -229,13 +311,16 @@ namespace Spatializer
             return UNITY_AUDIODSP_OK;
         }
 
+        data->SilentFrames = 0;
+
         // If we previously released the source, get one back
         if (data->EffectHrtfInfo == nullptr)
         {
-            data->EffectHrtfInfo.reset(HrtfWrapper::GetHrtfSource());
+            data->EffectHrtfInfo = HrtfWrapper::GetHrtfSource(GetAudibility(state, data));
 
             // If EffectHrtfInfo is still null, that means we're not able to get HRTF resources.
-            // Mute this source to prevent unexpectedly loud sounds
+            // Mute this source to prevent unexpectedly loud sounds. If it is loud enough to steal a slot, one
+            // frees up after the next HRTF pass.
             if (data->EffectHrtfInfo == nullptr)
             {
                 memset(outbuffer, 0, length * outChannels * sizeof(float));
@@ -243,17 +328,18 @@ namespace Spatializer
             }
         }
 
-        // There's no acoustics support yet, update params using a through-the-wall method
-        auto S = state->spatializerdata->sourcematrix;
-        auto L = state->spatializerdata->listenermatrix;
-        UpdateAcousticParams(data, ListenerToSourceDirection(S, L));
+        data->EffectHrtfInfo->SetAudibility(GetAudibility(state, data));
 
-        // Sometimes, the previous allocation can fail and produce a SourceBuffer with a null array
-        // Make sure we have a buffer to use before proceeding
-        if (data->EffectHrtfInfo->GetBuffer())
+        // The writer is turned down once the slot was stolen. Mute this block, the next one competes for a new slot.
+        const auto writer = HrtfWrapper::BeginWrite(data->EffectHrtfInfo);
+        if (!writer)
         {
-            PrepareAudioData(state, inbuffer, outbuffer, length, outChannels);
+            data->EffectHrtfInfo = nullptr;
+            memset(outbuffer, 0, length * outChannels * sizeof(float));
+            return UNITY_AUDIODSP_OK;
         }
+        UpdateAcousticParams(state, data, writer);
+        PrepareAudioData(state, writer, inbuffer, outbuffer, length, outChannels);
 
         return UNITY_AUDIODSP_OK;
     }
@@ -0,0 +1,227 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "Tracing.h"
+
+#ifdef SPATIALIZER_TRACING
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+namespace Tracing
+{
+    struct TraceEvent
+    {
+        const char* Name;
+        uint64_t StartNs;
+        uint64_t EndNs;
+    };
+
+    // Single writer, single reader ring. The thread that owns it pushes, the drain thread pops.
+    class TraceRing final
+    {
+    public:
+        static constexpr uint32_t c_Capacity = 8192;
+
+        bool Push(const TraceEvent& event) noexcept
+        {
+            const auto head = m_Head.load(std::memory_order_relaxed);
+            if (head - m_Tail.load(std::memory_order_acquire) == c_Capacity)
+            {
+                m_Dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            m_Events[head % c_Capacity] = event;
+            m_Head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        template <typename Consumer>
+        void Drain(Consumer consume)
+        {
+            auto tail = m_Tail.load(std::memory_order_relaxed);
+            const auto head = m_Head.load(std::memory_order_acquire);
+            for (; tail != head; ++tail)
+            {
+                consume(m_Events[tail % c_Capacity]);
+            }
+            m_Tail.store(tail, std::memory_order_release);
+        }
+
+        uint32_t GetDropped() const noexcept
+        {
+            return m_Dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        TraceEvent m_Events[c_Capacity];
+        std::atomic<uint32_t> m_Head{0};
+        std::atomic<uint32_t> m_Tail{0};
+        std::atomic<uint32_t> m_Dropped{0};
+    };
+
+    // Rings are handed out to threads in order of their first event. Threads beyond c_MaxThreads aren't traced.
+    constexpr uint32_t c_MaxThreads = 16;
+    static TraceRing s_Rings[c_MaxThreads];
+    static std::atomic<uint32_t> s_NumRings{0};
+    static std::atomic<uint32_t> s_UntracedThreadEvents{0};
+    static thread_local TraceRing* s_ThreadRing = nullptr;
+    static thread_local bool s_ThreadUntraced = false;
+
+    // Owns the trace file and the thread that drains the rings into it
+    class TraceWriter final
+    {
+    public:
+        ~TraceWriter()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Stop = true;
+            }
+            m_Wake.notify_one();
+            if (m_Thread.joinable())
+            {
+                m_Thread.join();
+            }
+            if (m_File != nullptr)
+            {
+                Finish();
+                std::fclose(m_File);
+            }
+        }
+
+        void Start()
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_File != nullptr)
+            {
+                return;
+            }
+
+            const auto path = std::getenv("SPATIALIZER_TRACE_FILE");
+            m_File = std::fopen(path != nullptr && path[0] != 0 ? path : "SpatializerTrace.json", "w");
+            if (m_File == nullptr)
+            {
+                return;
+            }
+            m_OriginNs = JobScheduler::GetTimeNs();
+            std::fputs("[\n", m_File);
+            m_Thread = std::thread([this] { DrainLoop(); });
+        }
+
+    private:
+        static constexpr auto c_DrainInterval = std::chrono::milliseconds(100);
+
+        void DrainLoop()
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            while (!m_Stop)
+            {
+                m_Wake.wait_for(lock, c_DrainInterval, [this] { return m_Stop; });
+                DrainAll();
+                std::fflush(m_File);
+            }
+        }
+
+        void DrainAll()
+        {
+            const auto numRings = std::min(s_NumRings.load(std::memory_order_acquire), c_MaxThreads);
+            for (auto thread = 0u; thread < numRings; ++thread)
+            {
+                s_Rings[thread].Drain([&](const TraceEvent& event) { WriteEvent(thread, event); });
+            }
+        }
+
+        double ToTraceUs(uint64_t ns) const noexcept
+        {
+            return (static_cast<double>(ns) - static_cast<double>(m_OriginNs)) * 0.001;
+        }
+
+        void WriteSeparator()
+        {
+            std::fputs(m_NumEvents++ == 0 ? "" : ",\n", m_File);
+        }
+
+        void WriteEvent(uint32_t thread, const TraceEvent& event)
+        {
+            if (!m_NamedThreads[thread])
+            {
+                m_NamedThreads[thread] = true;
+                WriteSeparator();
+                std::fprintf(
+                    m_File,
+                    R"({"name":"thread_name","ph":"M","pid":1,"tid":%u,"args":{"name":"Audio thread %u"}})", thread,
+                    thread);
+            }
+            WriteSeparator();
+            std::fprintf(
+                m_File, R"({"name":"%s","cat":"audio","ph":"X","pid":1,"tid":%u,"ts":%.3f,"dur":%.3f})", event.Name,
+                thread, ToTraceUs(event.StartNs), (event.EndNs - event.StartNs) * 0.001);
+        }
+
+        // Drains what's left and closes the event array
+        void Finish()
+        {
+            DrainAll();
+            auto dropped = s_UntracedThreadEvents.load(std::memory_order_relaxed);
+            for (const auto& ring : s_Rings)
+            {
+                dropped += ring.GetDropped();
+            }
+            if (dropped > 0)
+            {
+                WriteSeparator();
+                std::fprintf(
+                    m_File, R"({"name":"Dropped trace events","ph":"i","s":"g","pid":1,"tid":0,"ts":%.3f,)"
+                            R"("args":{"count":%u}})",
+                    ToTraceUs(JobScheduler::GetTimeNs()), dropped);
+            }
+            std::fputs("\n]\n", m_File);
+        }
+
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        std::thread m_Thread;
+        bool m_Stop = false;
+        std::FILE* m_File = nullptr;
+        uint64_t m_OriginNs = 0;
+        uint64_t m_NumEvents = 0;
+        bool m_NamedThreads[c_MaxThreads] = {};
+    };
+
+    static TraceWriter s_Writer;
+
+    void Start()
+    {
+        s_Writer.Start();
+    }
+
+    void Record(const char* name, uint64_t startNs, uint64_t endNs) noexcept
+    {
+        if (s_ThreadRing == nullptr)
+        {
+            if (s_ThreadUntraced)
+            {
+                s_UntracedThreadEvents.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            const auto index = s_NumRings.fetch_add(1, std::memory_order_acq_rel);
+            if (index >= c_MaxThreads)
+            {
+                s_ThreadUntraced = true;
+                s_UntracedThreadEvents.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            s_ThreadRing = &s_Rings[index];
+        }
+        s_ThreadRing->Push({name, startNs, endNs});
+    }
+} // namespace Tracing
+
+#endif // SPATIALIZER_TRACING
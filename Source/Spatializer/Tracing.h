@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+// Trace points of the audio callbacks, compiled in with the SPATIALIZER_TRACING CMake option and compiled out,
+// macros and all, otherwise. Every thread records the scopes it runs into a ring of its own, without locking or
+// allocating. A background thread drains the rings into a trace file in the Chrome trace event format, which
+// chrome://tracing and ui.perfetto.dev open. The file is SPATIALIZER_TRACE_FILE, or SpatializerTrace.json in the
+// working directory, and is written until the plugin is unloaded. Events are dropped when a ring fills up faster
+// than it is drained, and their number is recorded at the end of the trace.
+#ifdef SPATIALIZER_TRACING
+
+#include "JobScheduler.h"
+#include <stdint.h>
+
+namespace Tracing
+{
+    // Opens the trace file and starts draining. Later calls do nothing.
+    void Start();
+
+    // name must outlive the trace, usually it's a string literal
+    void Record(const char* name, uint64_t startNs, uint64_t endNs) noexcept;
+
+    // Records the time from construction to destruction
+    class Scope final
+    {
+    public:
+        explicit Scope(const char* name) noexcept : m_Name(name), m_StartNs(JobScheduler::GetTimeNs())
+        {
+        }
+
+        ~Scope()
+        {
+            Record(m_Name, m_StartNs, JobScheduler::GetTimeNs());
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* const m_Name;
+        const uint64_t m_StartNs;
+    };
+} // namespace Tracing
+
+#define SPATIALIZER_TRACE_CONCAT_(a, b) a##b
+#define SPATIALIZER_TRACE_CONCAT(a, b) SPATIALIZER_TRACE_CONCAT_(a, b)
+#define SPATIALIZER_TRACE_START() Tracing::Start()
+#define SPATIALIZER_TRACE_SCOPE(name) Tracing::Scope SPATIALIZER_TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#else
+
+#define SPATIALIZER_TRACE_START()
+#define SPATIALIZER_TRACE_SCOPE(name)
+
+#endif
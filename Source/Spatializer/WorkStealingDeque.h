@@ -0,0 +1,102 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+// Chase-Lev deque of pointers, with a fixed capacity. The owning thread pushes and pops at the bottom, any other
+// thread steals from the top. Nothing is allocated after construction, and no side ever blocks.
+template <typename T>
+class WorkStealingDeque final
+{
+public:
+    // Holds at least capacity items, rounded up to a power of two
+    explicit WorkStealingDeque(uint32_t capacity)
+        : m_Mask(RoundUpToPowerOfTwo(capacity) - 1)
+        , m_Items(new std::atomic<T*>[RoundUpToPowerOfTwo(capacity)])
+        , m_Top(0)
+        , m_Bottom(0)
+    {
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Owner only. Returns false if the deque is full.
+    bool Push(T* item) noexcept
+    {
+        const auto bottom = m_Bottom.load(std::memory_order_relaxed);
+        const auto top = m_Top.load(std::memory_order_acquire);
+        if (bottom - top > m_Mask)
+        {
+            return false;
+        }
+        m_Items[bottom & m_Mask].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner only. Takes the newest item, or returns nullptr if there is none.
+    T* Pop() noexcept
+    {
+        const auto bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+        m_Bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = m_Top.load(std::memory_order_relaxed);
+        if (top > bottom)
+        {
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        auto item = m_Items[bottom & m_Mask].load(std::memory_order_relaxed);
+        if (top == bottom)
+        {
+            // Last item, race the thieves for it
+            if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                item = nullptr;
+            }
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread. Takes the oldest item, or returns nullptr if there is none or another thread got to it first.
+    T* Steal() noexcept
+    {
+        auto top = m_Top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto bottom = m_Bottom.load(std::memory_order_acquire);
+        if (top >= bottom)
+        {
+            return nullptr;
+        }
+
+        auto item = m_Items[top & m_Mask].load(std::memory_order_relaxed);
+        if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+        return item;
+    }
+
+private:
+    static uint32_t RoundUpToPowerOfTwo(uint32_t value) noexcept
+    {
+        uint32_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const int64_t m_Mask;
+    std::unique_ptr<std::atomic<T*>[]> m_Items;
+    alignas(64) std::atomic<int64_t> m_Top;
+    alignas(64) std::atomic<int64_t> m_Bottom;
+};
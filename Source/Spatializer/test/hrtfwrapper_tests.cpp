@@ -0,0 +1,348 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "gtest.h"
+#include "HrtfWrapper.h"
+#include "PluginMetrics.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace AudioUnitTests
+{
+    // The wrapper is a process-wide singleton. Every test starts and ends with all slots free.
+    class CHrtfWrapperTests : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            HrtfWrapper::InitWrapper(c_HrtfFrameCount);
+            m_Output.resize(2 * HrtfWrapper::GetFrameCount());
+        }
+
+        // Frees the slots the test let go of
+        void TearDown() override
+        {
+            RunPass();
+        }
+
+        void RunPass()
+        {
+            HrtfWrapper::Process(m_Output.data(), HrtfWrapper::GetFrameCount(), 2, c_HrtfSampleRate);
+        }
+
+        static float GetCounter(const char* name)
+        {
+            float total = 0.0f;
+            PluginMetrics::GetFloatBuffer(name, &total, 1);
+            return total;
+        }
+
+        std::vector<float> m_Output;
+    };
+
+    TEST_F(CHrtfWrapperTests, LouderSourceTakesOverQuietestSlot)
+    {
+        const auto maxSources = HrtfWrapper::GetMaxSources();
+        std::vector<HrtfWrapper::SourceHandle> sources;
+        for (auto i = 0u; i < maxSources; ++i)
+        {
+            sources.push_back(HrtfWrapper::GetHrtfSource(0.5f));
+            ASSERT_TRUE(sources.back());
+        }
+        sources[7]->SetAudibility(0.1f);
+        const auto stealsBefore = GetCounter("VoiceSteals");
+
+        // Not loud enough to take over anything
+        EXPECT_FALSE(HrtfWrapper::GetHrtfSource(0.15f));
+        RunPass();
+        EXPECT_FALSE(HrtfWrapper::WasStolen(sources[7]));
+
+        // The next pass fades out the quietest source, the one after frees its slot
+        EXPECT_FALSE(HrtfWrapper::GetHrtfSource(1.0f));
+        RunPass();
+        EXPECT_EQ(stealsBefore + 1, GetCounter("VoiceSteals"));
+        for (auto i = 0u; i < maxSources; ++i)
+        {
+            EXPECT_EQ(i == 7, HrtfWrapper::WasStolen(sources[i])) << "source " << i;
+        }
+        EXPECT_FALSE(HrtfWrapper::BeginWrite(sources[7]));
+        EXPECT_TRUE(HrtfWrapper::BeginWrite(sources[6]));
+        RunPass();
+
+        auto louder = HrtfWrapper::GetHrtfSource(1.0f);
+        ASSERT_TRUE(louder);
+        EXPECT_EQ(7u, louder->GetIndex());
+        EXPECT_FALSE(HrtfWrapper::WasStolen(louder));
+
+        // Dropping the stolen handle leaves the new owner alone
+        sources[7].reset();
+        EXPECT_FALSE(HrtfWrapper::WasStolen(louder));
+        EXPECT_FALSE(HrtfWrapper::GetHrtfSource(0.0f));
+    }
+
+    // The mixer frees released slots even while it doesn't render, see SpatializerMixerPlugin
+    TEST_F(CHrtfWrapperTests, ReleasedSlotIsFreedWithoutAPass)
+    {
+        const auto maxSources = HrtfWrapper::GetMaxSources();
+        std::vector<HrtfWrapper::SourceHandle> sources;
+        for (auto i = 0u; i < maxSources; ++i)
+        {
+            sources.push_back(HrtfWrapper::GetHrtfSource(0.5f));
+            ASSERT_TRUE(sources.back());
+        }
+
+        sources[5].reset();
+        HrtfWrapper::UpdateSlots();
+        auto source = HrtfWrapper::GetHrtfSource(0.5f);
+        ASSERT_TRUE(source);
+        EXPECT_EQ(5u, source->GetIndex());
+        EXPECT_TRUE(HrtfWrapper::BeginWrite(source));
+    }
+
+    // A source that is still writing when the mixer wants to render its bank holds up neither the pass nor the reuse of
+    // its slot by someone else
+    TEST_F(CHrtfWrapperTests, LateWriterSitsThePassOut)
+    {
+        const auto maxSources = HrtfWrapper::GetMaxSources();
+        std::vector<HrtfWrapper::SourceHandle> sources;
+        for (auto i = 0u; i < maxSources; ++i)
+        {
+            sources.push_back(HrtfWrapper::GetHrtfSource(0.5f));
+            ASSERT_TRUE(sources.back());
+        }
+        const auto lateBefore = GetCounter("LateInputs");
+
+        auto writer = std::make_unique<HrtfWrapper::SourceWriter>(HrtfWrapper::BeginWrite(sources[3]));
+        ASSERT_TRUE(*writer);
+        RunPass();
+        EXPECT_EQ(lateBefore + 1, GetCounter("LateInputs"));
+
+        // The slot isn't freed while the writer may still write to it
+        sources[3].reset();
+        HrtfWrapper::UpdateSlots();
+        EXPECT_FALSE(HrtfWrapper::GetHrtfSource(0.0f));
+
+        writer.reset();
+        HrtfWrapper::UpdateSlots();
+        auto source = HrtfWrapper::GetHrtfSource(0.0f);
+        ASSERT_TRUE(source);
+        EXPECT_EQ(3u, source->GetIndex());
+
+        // Writers that are done in time don't count
+        RunPass();
+        EXPECT_EQ(lateBefore + 1, GetCounter("LateInputs"));
+    }
+
+    // Parameters only reach the engine once the direction or the gain moved by at least the source's thresholds
+    TEST_F(CHrtfWrapperTests, SendsParametersOnlyWhenAThresholdIsCrossed)
+    {
+        const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+        HrtfWrapper::SetListener(identity, 1);
+        auto source = HrtfWrapper::GetHrtfSource(0.5f);
+        ASSERT_TRUE(source);
+
+        const auto angleThreshold = 2.0f; // Degrees
+        const auto gainThresholdDb = 1.0f;
+        const auto degToRadian = 3.14159265f / 180.0f;
+        auto updatesBefore = GetCounter("ParameterUpdates");
+
+        // Renders a pass with the emitter 2 m away, angleDegrees to the right of straight ahead, and returns how many
+        // parameter updates it sent
+        const auto sendPass = [&](float angleDegrees, float gainDb) {
+            {
+                const auto writer = HrtfWrapper::BeginWrite(source);
+                EXPECT_TRUE(writer);
+                HrtfWrapper::EmitterParameters emitter;
+                emitter.Position[0] = 2.0f * std::sin(angleDegrees * degToRadian);
+                emitter.Position[1] = 0.0f;
+                emitter.Position[2] = -2.0f * std::cos(angleDegrees * degToRadian);
+                emitter.DistanceGain = 0.5f * std::pow(10.0f, gainDb / 20.0f);
+                emitter.Distance = 2.0f;
+                emitter.CosAngleThreshold = std::cos(angleThreshold * degToRadian);
+                emitter.GainThresholdDb = gainThresholdDb;
+                writer.SetEmitter(emitter);
+            }
+            RunPass();
+            const auto updates = GetCounter("ParameterUpdates");
+            const auto sent = updates - updatesBefore;
+            updatesBefore = updates;
+            return sent;
+        };
+
+        // A static emitter is sent once
+        EXPECT_EQ(1.0f, sendPass(0.0f, 0.0f));
+        EXPECT_EQ(0.0f, sendPass(0.0f, 0.0f));
+        RunPass();
+        EXPECT_EQ(0.0f, sendPass(0.0f, 0.0f));
+
+        // Changes are measured from what was last sent, not from the last pass
+        EXPECT_EQ(0.0f, sendPass(angleThreshold - 0.1f, 0.0f));
+        EXPECT_EQ(1.0f, sendPass(angleThreshold + 0.1f, 0.0f));
+        EXPECT_EQ(0.0f, sendPass(angleThreshold + 0.1f, gainThresholdDb - 0.1f));
+        EXPECT_EQ(1.0f, sendPass(angleThreshold + 0.1f, gainThresholdDb + 0.1f));
+        EXPECT_EQ(0.0f, sendPass(angleThreshold + 0.1f, gainThresholdDb + 0.1f));
+    }
+
+    // Every shard reports the time its job took in the last pass, and the slots it rendered
+    TEST_F(CHrtfWrapperTests, ReportsTheSlotsOfEveryShard)
+    {
+        std::vector<HrtfWrapper::SourceHandle> sources;
+        for (auto i = 0u; i < 5; ++i)
+        {
+            sources.push_back(HrtfWrapper::GetHrtfSource(0.5f));
+            ASSERT_TRUE(sources.back());
+        }
+        RunPass();
+
+        auto numInputs = 0.0f;
+        auto numShards = 0u;
+        float fields[PluginMetrics::SF_COUNT + 1];
+        while (PluginMetrics::GetFloatBuffer(
+            ("ShardRenderTimeUs/" + std::to_string(numShards)).c_str(), fields, PluginMetrics::SF_COUNT + 1))
+        {
+            EXPECT_GE(fields[PluginMetrics::SF_RENDERUS], 0.0f);
+            EXPECT_EQ(static_cast<float>(numShards), fields[PluginMetrics::SF_FIRSTSLOT]);
+            if (fields[PluginMetrics::SF_INPUTS] > 0.0f)
+            {
+                EXPECT_EQ(
+                    fields[PluginMetrics::SF_FIRSTSLOT] +
+                        (fields[PluginMetrics::SF_INPUTS] - 1) * fields[PluginMetrics::SF_SLOTSTRIDE],
+                    fields[PluginMetrics::SF_LASTSLOT]);
+            }
+            EXPECT_EQ(0.0f, fields[PluginMetrics::SF_COUNT]);
+            numInputs += fields[PluginMetrics::SF_INPUTS];
+            ++numShards;
+        }
+        EXPECT_GE(numShards, 1u);
+        EXPECT_EQ(static_cast<float>(sources.size()), numInputs);
+
+        EXPECT_FALSE(PluginMetrics::GetFloatBuffer("ShardRenderTimeUs/", fields, 1));
+        EXPECT_FALSE(PluginMetrics::GetFloatBuffer("ShardRenderTimeUs/0x", fields, 1));
+        EXPECT_FALSE(PluginMetrics::GetFloatBuffer("ShardRenderTimeUs/-1", fields, 1));
+    }
+
+    // Sources come and go, and write audio, while the mixer steals slots for louder ones, so that owners regularly let
+    // go of a slot in the same pass that steals it. Every ownership has its own generation: a slot freed twice would
+    // be handed to two sources with the same generation.
+    TEST_F(CHrtfWrapperTests, ConcurrentReleaseAndStealNeverShareSlots)
+    {
+        constexpr uint32_t c_NumThreads = 4;
+        constexpr uint32_t c_NumSteals = 200;
+        const auto maxSources = HrtfWrapper::GetMaxSources();
+        const auto maxHeld = maxSources / 2;
+
+        std::mutex ownersLock;
+        std::set<uint64_t> owners;
+        std::atomic<uint32_t> sharedSlots(0);
+        std::atomic<uint32_t> stolen(0);
+        std::atomic<bool> done(false);
+
+        auto getOwner = [](const HrtfWrapper::SourceHandle& source) {
+            return static_cast<uint64_t>(source->GetIndex()) << 32 | source.get_deleter().Generation;
+        };
+        auto drop = [&](HrtfWrapper::SourceHandle& source) {
+            {
+                std::lock_guard<std::mutex> lock(ownersLock);
+                owners.erase(getOwner(source));
+            }
+            source.reset();
+        };
+
+        std::vector<std::thread> threads;
+        for (auto t = 0u; t < c_NumThreads; ++t)
+        {
+            threads.emplace_back([&, t]() {
+                std::mt19937 generator(t);
+                std::uniform_real_distribution<float> audibilities(0.0f, 1.0f);
+                std::vector<HrtfWrapper::SourceHandle> sources;
+                while (!done.load(std::memory_order_relaxed))
+                {
+                    for (auto& source : sources)
+                    {
+                        if (source && HrtfWrapper::WasStolen(source))
+                        {
+                            stolen.fetch_add(1, std::memory_order_relaxed);
+                            drop(source);
+                        }
+                    }
+                    sources.erase(
+                        std::remove_if(
+                            sources.begin(), sources.end(),
+                            [](const HrtfWrapper::SourceHandle& source) { return !source; }),
+                        sources.end());
+
+                    if (sources.size() < maxHeld)
+                    {
+                        auto source = HrtfWrapper::GetHrtfSource(audibilities(generator));
+                        if (source)
+                        {
+                            std::lock_guard<std::mutex> lock(ownersLock);
+                            if (!owners.insert(getOwner(source)).second)
+                            {
+                                sharedSlots.fetch_add(1, std::memory_order_relaxed);
+                            }
+                            sources.push_back(std::move(source));
+                        }
+                    }
+                    if (!sources.empty())
+                    {
+                        const auto n = generator() % sources.size();
+                        sources[n]->SetAudibility(audibilities(generator));
+                        if (const auto writer = HrtfWrapper::BeginWrite(sources[n]))
+                        {
+                            std::fill(writer.GetBuffer(), writer.GetBuffer() + HrtfWrapper::GetFrameCount(), 0.5f);
+                        }
+                        if (generator() % 4 == 0)
+                        {
+                            drop(sources[n]);
+                        }
+                    }
+                    std::this_thread::yield();
+                }
+                for (auto& source : sources)
+                {
+                    if (source)
+                    {
+                        drop(source);
+                    }
+                }
+            });
+        }
+
+        // Give up after a while rather than hang if steals stop happening
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+        while (stolen.load(std::memory_order_relaxed) < c_NumSteals && std::chrono::steady_clock::now() < deadline)
+        {
+            RunPass();
+        }
+        done.store(true, std::memory_order_relaxed);
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        EXPECT_EQ(0u, sharedSlots.load());
+        EXPECT_GE(stolen.load(), c_NumSteals);
+
+        // Every slot went back to the pool exactly once
+        RunPass();
+        std::vector<HrtfWrapper::SourceHandle> sources;
+        std::set<uint32_t> indices;
+        for (auto i = 0u; i < maxSources; ++i)
+        {
+            sources.push_back(HrtfWrapper::GetHrtfSource(0.0f));
+            ASSERT_TRUE(sources.back());
+            indices.insert(sources.back()->GetIndex());
+        }
+        EXPECT_EQ(maxSources, indices.size());
+        EXPECT_FALSE(HrtfWrapper::GetHrtfSource(0.0f));
+    }
+} // namespace AudioUnitTests
@@ -0,0 +1,436 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "gtest.h"
+#include "JobScheduler.h"
+#include "LatestValueMailbox.h"
+#include "SlotAllocator.h"
+#include "WorkStealingDeque.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace AudioUnitTests
+{
+    TEST(CSlotAllocatorTests, HandsOutLowestSlotsUntilExhausted)
+    {
+        SlotAllocator allocator(40);
+        for (auto i = 0u; i < 40; ++i)
+        {
+            ASSERT_EQ(i, allocator.Acquire());
+            EXPECT_TRUE(allocator.IsAcquired(i));
+        }
+        EXPECT_EQ(SlotAllocator::c_InvalidSlot, allocator.Acquire());
+        EXPECT_EQ(SlotAllocator::c_InvalidSlot, allocator.Acquire());
+    }
+
+    // Bits past the capacity pad out the last word. They must never be handed out or reported.
+    TEST(CSlotAllocatorTests, NeverExposesPaddingBits)
+    {
+        for (auto capacity : {1u, 31u, 33u, 63u, 64u, 65u, 100u})
+        {
+            SlotAllocator allocator(capacity);
+            EXPECT_EQ(capacity, allocator.GetCapacity());
+
+            std::vector<uint32_t> slots(capacity);
+            EXPECT_EQ(0u, allocator.GetAcquiredSlots(slots.data())) << "capacity " << capacity;
+            for (auto i = 0u; i < capacity; ++i)
+            {
+                ASSERT_LT(allocator.Acquire(), capacity);
+            }
+            EXPECT_EQ(SlotAllocator::c_InvalidSlot, allocator.Acquire()) << "capacity " << capacity;
+            EXPECT_EQ(capacity, allocator.GetAcquiredSlots(slots.data())) << "capacity " << capacity;
+            EXPECT_EQ(capacity - 1, slots.back());
+
+            // Slots past the capacity are neither acquired nor releasable
+            EXPECT_FALSE(allocator.IsAcquired(capacity));
+            allocator.Release(capacity);
+            EXPECT_EQ(SlotAllocator::c_InvalidSlot, allocator.Acquire()) << "capacity " << capacity;
+        }
+    }
+
+    TEST(CSlotAllocatorTests, ReacquiresReleasedSlots)
+    {
+        SlotAllocator allocator(70);
+        for (auto i = 0u; i < 70; ++i)
+        {
+            allocator.Acquire();
+        }
+
+        allocator.Release(65);
+        allocator.Release(3);
+        allocator.Release(40);
+        EXPECT_FALSE(allocator.IsAcquired(3));
+        EXPECT_FALSE(allocator.IsAcquired(40));
+        EXPECT_FALSE(allocator.IsAcquired(65));
+
+        std::vector<uint32_t> slots(70);
+        ASSERT_EQ(67u, allocator.GetAcquiredSlots(slots.data()));
+        for (auto i = 1u; i < 67; ++i)
+        {
+            EXPECT_LT(slots[i - 1], slots[i]);
+        }
+
+        // Lowest first, across words
+        EXPECT_EQ(3u, allocator.Acquire());
+        EXPECT_EQ(40u, allocator.Acquire());
+        EXPECT_EQ(65u, allocator.Acquire());
+        EXPECT_EQ(SlotAllocator::c_InvalidSlot, allocator.Acquire());
+    }
+
+    // Threads acquire and release as fast as they can, more of them than there are slots. A slot that is handed out
+    // twice at once shows up as a second owner.
+    TEST(CSlotAllocatorTests, ConcurrentAcquireAndReleaseNeverShareSlots)
+    {
+        constexpr uint32_t c_Capacity = 37;
+        constexpr uint32_t c_NumThreads = 8;
+        constexpr uint32_t c_Iterations = 20000;
+
+        SlotAllocator allocator(c_Capacity);
+        std::unique_ptr<std::atomic<uint32_t>[]> owners(new std::atomic<uint32_t>[c_Capacity]);
+        for (auto i = 0u; i < c_Capacity; ++i)
+        {
+            owners[i].store(0);
+        }
+        std::atomic<uint32_t> sharedSlots(0);
+        std::atomic<uint32_t> acquired(0);
+
+        std::vector<std::thread> threads;
+        for (auto t = 0u; t < c_NumThreads; ++t)
+        {
+            threads.emplace_back([&]() {
+                uint32_t held[4];
+                for (auto i = 0u; i < c_Iterations; ++i)
+                {
+                    // Hold a few slots at a time so that the pool runs dry now and then
+                    auto count = 0u;
+                    for (; count < 4; ++count)
+                    {
+                        held[count] = allocator.Acquire();
+                        if (held[count] == SlotAllocator::c_InvalidSlot)
+                        {
+                            break;
+                        }
+                        if (owners[held[count]].fetch_add(1) != 0)
+                        {
+                            sharedSlots.fetch_add(1);
+                        }
+                        acquired.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    while (count > 0)
+                    {
+                        --count;
+                        owners[held[count]].fetch_sub(1);
+                        allocator.Release(held[count]);
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        EXPECT_EQ(0u, sharedSlots.load());
+        EXPECT_GT(acquired.load(), c_NumThreads * c_Iterations);
+
+        // Everything went back to the pool
+        std::vector<uint32_t> slots(c_Capacity);
+        EXPECT_EQ(0u, allocator.GetAcquiredSlots(slots.data()));
+        for (auto i = 0u; i < c_Capacity; ++i)
+        {
+            EXPECT_EQ(i, allocator.Acquire());
+        }
+    }
+
+    TEST(CLatestValueMailboxTests, ReadsOnlyTheLatestValueOnce)
+    {
+        LatestValueMailbox<uint32_t> mailbox;
+        uint32_t value = 0;
+        EXPECT_FALSE(mailbox.Read(value));
+
+        mailbox.Write(1);
+        mailbox.Write(2);
+        mailbox.Write(3);
+        ASSERT_TRUE(mailbox.Read(value));
+        EXPECT_EQ(3u, value);
+        EXPECT_FALSE(mailbox.Read(value));
+
+        // Every buffer takes a turn as the shared one
+        for (auto i = 4u; i < 20; ++i)
+        {
+            mailbox.Write(i);
+            ASSERT_TRUE(mailbox.Read(value));
+            EXPECT_EQ(i, value);
+        }
+        EXPECT_FALSE(mailbox.Read(value));
+    }
+
+    TEST(CLatestValueMailboxTests, DiscardedValueIsNeverRead)
+    {
+        LatestValueMailbox<uint32_t> mailbox;
+        uint32_t value = 0;
+        mailbox.Write(1);
+        mailbox.Discard();
+        EXPECT_FALSE(mailbox.Read(value));
+        EXPECT_EQ(0u, value);
+
+        // Neither the discarded value nor an older one comes back once the writer moves on
+        mailbox.Write(2);
+        ASSERT_TRUE(mailbox.Read(value));
+        EXPECT_EQ(2u, value);
+        mailbox.Write(3);
+        mailbox.Write(4);
+        mailbox.Discard();
+        mailbox.Write(5);
+        ASSERT_TRUE(mailbox.Read(value));
+        EXPECT_EQ(5u, value);
+        EXPECT_FALSE(mailbox.Read(value));
+
+        // Discarding with nothing pending changes nothing
+        mailbox.Discard();
+        EXPECT_FALSE(mailbox.Read(value));
+        mailbox.Write(6);
+        ASSERT_TRUE(mailbox.Read(value));
+        EXPECT_EQ(6u, value);
+    }
+
+    // The writer publishes values whose fields all hold the same counter. A value the reader gets must be whole, and
+    // newer than the last one it got.
+    TEST(CLatestValueMailboxTests, ConcurrentReaderNeverSeesTornOrOlderValues)
+    {
+        constexpr uint64_t c_NumWrites = 200000;
+        struct Value
+        {
+            uint64_t Fields[64];
+        };
+
+        LatestValueMailbox<Value> mailbox;
+        std::atomic<bool> started(false);
+        std::thread writer([&]() {
+            started.store(true);
+            for (auto counter = 1ull; counter <= c_NumWrites; ++counter)
+            {
+                Value value;
+                std::fill(std::begin(value.Fields), std::end(value.Fields), counter);
+                mailbox.Write(value);
+                // Let the reader in, also when there are fewer cores than threads
+                if (counter % 64 == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        while (!started.load())
+        {
+            std::this_thread::yield();
+        }
+
+        auto torn = 0u;
+        auto older = 0u;
+        auto reads = 0u;
+        uint64_t last = 0;
+        Value value;
+        while (last < c_NumWrites)
+        {
+            if (!mailbox.Read(value))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            ++reads;
+            for (auto field : value.Fields)
+            {
+                torn += field != value.Fields[0] ? 1 : 0;
+            }
+            older += value.Fields[0] <= last ? 1 : 0;
+            last = std::max(last, value.Fields[0]);
+        }
+        writer.join();
+
+        EXPECT_EQ(0u, torn);
+        EXPECT_EQ(0u, older);
+        EXPECT_GT(reads, 1u);
+        EXPECT_FALSE(mailbox.Read(value));
+    }
+
+    TEST(CWorkStealingDequeTests, OwnerPopsNewestAndThievesStealOldest)
+    {
+        WorkStealingDeque<uint32_t> deque(4);
+        uint32_t items[5] = {0, 1, 2, 3, 4};
+        for (auto i = 0u; i < 4; ++i)
+        {
+            ASSERT_TRUE(deque.Push(&items[i]));
+        }
+        EXPECT_FALSE(deque.Push(&items[4]));
+
+        EXPECT_EQ(&items[0], deque.Steal());
+        EXPECT_EQ(&items[3], deque.Pop());
+        EXPECT_EQ(&items[1], deque.Steal());
+        EXPECT_EQ(&items[2], deque.Pop());
+        EXPECT_EQ(nullptr, deque.Pop());
+        EXPECT_EQ(nullptr, deque.Steal());
+
+        // Room is made as items are taken, also across the end of the ring
+        for (auto round = 0u; round < 10; ++round)
+        {
+            ASSERT_TRUE(deque.Push(&items[round % 5]));
+            ASSERT_TRUE(deque.Push(&items[(round + 1) % 5]));
+            EXPECT_EQ(&items[round % 5], deque.Steal());
+            EXPECT_EQ(&items[(round + 1) % 5], deque.Pop());
+        }
+        EXPECT_EQ(nullptr, deque.Pop());
+    }
+
+    TEST(CWorkStealingDequeTests, RoundsCapacityUpToPowerOfTwo)
+    {
+        WorkStealingDeque<uint32_t> deque(5);
+        uint32_t item = 0;
+        for (auto i = 0u; i < 8; ++i)
+        {
+            ASSERT_TRUE(deque.Push(&item));
+        }
+        EXPECT_FALSE(deque.Push(&item));
+    }
+
+    // The owner pushes and pops in bursts while thieves steal, so that they regularly race for the last item. Every
+    // item must be taken exactly once.
+    TEST(CWorkStealingDequeTests, ConcurrentPopAndStealTakeEveryItemOnce)
+    {
+        constexpr uint32_t c_NumItems = 50000;
+        constexpr uint32_t c_NumThieves = 3;
+
+        std::vector<uint32_t> items(c_NumItems);
+        std::iota(items.begin(), items.end(), 0u);
+        std::unique_ptr<std::atomic<uint32_t>[]> taken(new std::atomic<uint32_t>[c_NumItems]);
+        for (auto i = 0u; i < c_NumItems; ++i)
+        {
+            taken[i].store(0);
+        }
+        std::atomic<uint32_t> stolen(0);
+
+        WorkStealingDeque<uint32_t> deque(16);
+        std::atomic<uint32_t> started(0);
+        std::atomic<bool> done(false);
+        std::vector<std::thread> thieves;
+        for (auto t = 0u; t < c_NumThieves; ++t)
+        {
+            thieves.emplace_back([&]() {
+                started.fetch_add(1);
+                while (!done.load(std::memory_order_acquire))
+                {
+                    if (auto item = deque.Steal())
+                    {
+                        taken[*item].fetch_add(1, std::memory_order_relaxed);
+                        stolen.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        while (started.load() < c_NumThieves)
+        {
+            std::this_thread::yield();
+        }
+
+        // Let the thieves in after every burst, also when there are fewer cores than threads
+        std::mt19937 generator(1);
+        auto next = 0u;
+        while (next < c_NumItems)
+        {
+            const auto burst = 1 + generator() % 8;
+            for (auto i = 0u; i < burst && next < c_NumItems; ++i)
+            {
+                if (deque.Push(&items[next]))
+                {
+                    ++next;
+                }
+            }
+            const auto pops = generator() % (burst + 1);
+            for (auto i = 0u; i < pops; ++i)
+            {
+                if (auto item = deque.Pop())
+                {
+                    taken[*item].fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            std::this_thread::yield();
+        }
+        while (auto item = deque.Pop())
+        {
+            taken[*item].fetch_add(1, std::memory_order_relaxed);
+        }
+        done.store(true, std::memory_order_release);
+        for (auto& thief : thieves)
+        {
+            thief.join();
+        }
+
+        auto wrong = 0u;
+        for (auto i = 0u; i < c_NumItems; ++i)
+        {
+            wrong += taken[i].load() != 1 ? 1 : 0;
+        }
+        EXPECT_EQ(0u, wrong);
+        EXPECT_GT(stolen.load(), 0u);
+    }
+
+    // Many batches with pauses in between, so that the workers park and have to be woken again. Every job runs
+    // exactly once per batch, and the workers take part.
+    TEST(CJobSchedulerTests, RunsEveryJobOnceAcrossBatches)
+    {
+        constexpr uint32_t c_NumJobs = 16;
+        constexpr uint32_t c_NumBatches = 200;
+
+        std::atomic<uint32_t> runs[c_NumJobs];
+        for (auto& count : runs)
+        {
+            count.store(0);
+        }
+        auto job = [](void* context, uint32_t index) {
+            // Long enough for the workers to wake up and steal
+            const auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(50);
+            while (std::chrono::steady_clock::now() < end)
+            {
+            }
+            static_cast<std::atomic<uint32_t>*>(context)[index].fetch_add(1);
+        };
+
+        JobScheduler scheduler(4, c_NumJobs);
+        JobScheduler::JobTiming timings[c_NumJobs];
+        auto onWorkers = 0u;
+        for (auto batch = 0u; batch < c_NumBatches; ++batch)
+        {
+            for (auto i = 0u; i < c_NumJobs; ++i)
+            {
+                if (!scheduler.Submit(job, runs, i))
+                {
+                    job(runs, i);
+                }
+            }
+            scheduler.Wait();
+
+            ASSERT_EQ(c_NumJobs, scheduler.GetJobTimings(timings, c_NumJobs));
+            for (auto i = 0u; i < c_NumJobs; ++i)
+            {
+                ASSERT_EQ(batch + 1, runs[i].load()) << "job " << i;
+                onWorkers += timings[i].Thread != 0 ? 1 : 0;
+            }
+            if (batch % 10 == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        EXPECT_GT(onWorkers, 0u);
+    }
+} // namespace AudioUnitTests
@@ -0,0 +1,231 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// Measures how the cost of an HRTF pass grows with the number of active sources. Sources are acquired a few at a time
+// up to the size of the pool, every source gets noise and a new random emitter each quantum, and each call to
+// HrtfWrapper::Process is timed. The pool size, quantum and render threads follow the SPATIALIZER_HRTF_* environment
+// variables, like they do in the plugin.
+
+#include "HrtfWrapper.h"
+#include "TimingStats.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Options
+    {
+        uint32_t Quanta = 200;
+        uint32_t WarmupQuanta = 20;
+        uint32_t Step = 8;
+        std::string CsvPath;
+    };
+
+    // A source 1 to 20 meters away in a random direction, with the inverse distance rolloff Unity defaults to.
+    // The thresholds are zero, so that every quantum sends new parameters to the engine.
+    HrtfWrapper::EmitterParameters GetRandomEmitter(std::mt19937& generator)
+    {
+        std::normal_distribution<float> axis(0.0f, 1.0f);
+        std::uniform_real_distribution<float> distances(1.0f, 20.0f);
+
+        float direction[3] = {axis(generator), axis(generator), axis(generator)};
+        auto length =
+            std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+        if (length < 1e-6f)
+        {
+            direction[0] = direction[1] = 0.0f;
+            direction[2] = length = 1.0f;
+        }
+        const auto distance = distances(generator);
+
+        HrtfWrapper::EmitterParameters emitter;
+        for (auto i = 0; i < 3; ++i)
+        {
+            emitter.Position[i] = direction[i] / length * distance;
+        }
+        emitter.DistanceGain = 1.0f / distance;
+        emitter.Distance = distance;
+        emitter.CosAngleThreshold = 1.0f;
+        emitter.GainThresholdDb = 0.0f;
+        return emitter;
+    }
+
+    uint32_t ParseCount(const std::string& option, const std::string& text)
+    {
+        size_t parsed = 0;
+        unsigned long value = 0;
+        try
+        {
+            value = std::stoul(text, &parsed);
+        }
+        catch (const std::exception&)
+        {
+            parsed = 0;
+        }
+        if (parsed != text.size() || value == 0 || value > UINT32_MAX)
+        {
+            throw std::runtime_error(option + " expects a positive count, not " + text);
+        }
+        return static_cast<uint32_t>(value);
+    }
+
+    Options ParseOptions(int argc, char** argv)
+    {
+        Options options;
+        for (auto i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+            if (i + 1 < argc)
+            {
+                if (argument == "--quanta")
+                {
+                    options.Quanta = ParseCount(argument, argv[++i]);
+                    continue;
+                }
+                if (argument == "--warmup")
+                {
+                    options.WarmupQuanta = ParseCount(argument, argv[++i]);
+                    continue;
+                }
+                if (argument == "--step")
+                {
+                    options.Step = ParseCount(argument, argv[++i]);
+                    continue;
+                }
+                if (argument == "--csv")
+                {
+                    options.CsvPath = argv[++i];
+                    continue;
+                }
+            }
+            throw std::runtime_error("unexpected argument " + argument);
+        }
+        return options;
+    }
+
+    void Run(const Options& options)
+    {
+        // One DSP buffer per quantum, so that every call to Process renders a pass
+        const auto config = HrtfWrapper::ReadConfig();
+        HrtfWrapper::InitWrapper(config.FrameCount);
+        const auto frameCount = HrtfWrapper::GetFrameCount();
+        const auto maxSources = HrtfWrapper::GetMaxSources();
+        const auto quantumUs = 1e6 * frameCount / c_HrtfSampleRate;
+
+        static const float c_Identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+        std::vector<HrtfWrapper::SourceHandle> sources;
+        sources.reserve(maxSources);
+        std::vector<float> output(2 * frameCount);
+
+        std::ofstream csv;
+        if (!options.CsvPath.empty())
+        {
+            csv.open(options.CsvPath);
+            if (!csv)
+            {
+                throw std::runtime_error("can't write " + options.CsvPath);
+            }
+            csv << "sources,mean_us,p99_us,max_us,real_time_factor,deadline_misses\n";
+        }
+
+        std::printf(
+            "%u frame quanta (%.0f us at %u Hz), %u source slots, %u render threads, %u passes per row\n", frameCount,
+            quantumUs, c_HrtfSampleRate, maxSources, config.RenderThreads, options.Quanta);
+        std::printf("The real-time factor is the mean pass time over the duration of a quantum\n");
+        std::printf(
+            "%8s %10s %10s %10s %14s %10s %8s\n", "sources", "mean us", "p99 us", "max us", "us per source",
+            "rt factor", "misses");
+
+        std::vector<double> timesUs;
+        timesUs.reserve(options.Quanta);
+        uint64_t dspTick = 0;
+        for (auto count = 1u;;)
+        {
+            while (sources.size() < count)
+            {
+                auto source = HrtfWrapper::GetHrtfSource(1.0f);
+                if (!source)
+                {
+                    throw std::runtime_error("can't acquire source " + std::to_string(sources.size() + 1));
+                }
+                sources.push_back(std::move(source));
+            }
+
+            timesUs.clear();
+            auto deadlineMisses = 0u;
+            for (auto quantum = 0u; quantum < options.WarmupQuanta + options.Quanta; ++quantum)
+            {
+                HrtfWrapper::SetListener(c_Identity, dspTick);
+                dspTick += frameCount;
+                for (const auto& source : sources)
+                {
+                    const auto writer = HrtfWrapper::BeginWrite(source);
+                    writer.SetEmitter(GetRandomEmitter(generator));
+                    const auto buffer = writer.GetBuffer();
+                    for (auto i = 0u; i < frameCount; ++i)
+                    {
+                        buffer[i] = noise(generator);
+                    }
+                }
+
+                const auto start = std::chrono::steady_clock::now();
+                HrtfWrapper::Process(output.data(), frameCount, 2, c_HrtfSampleRate);
+                const auto passUs =
+                    std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+                if (quantum >= options.WarmupQuanta)
+                {
+                    timesUs.push_back(passUs);
+                    deadlineMisses += passUs > quantumUs ? 1 : 0;
+                }
+            }
+
+            const auto stats = GetTimingStats(timesUs);
+            const auto realTimeFactor = stats.MeanUs / quantumUs;
+            std::printf(
+                "%8u %10.1f %10.1f %10.1f %14.2f %10.4f %8u\n", count, stats.MeanUs, stats.P99Us, stats.MaxUs,
+                stats.MeanUs / count, realTimeFactor, deadlineMisses);
+            if (csv.is_open())
+            {
+                csv << count << ',' << stats.MeanUs << ',' << stats.P99Us << ',' << stats.MaxUs << ','
+                    << realTimeFactor << ',' << deadlineMisses << '\n';
+            }
+
+            if (count == maxSources)
+            {
+                break;
+            }
+            count = std::min(maxSources, (count / options.Step + 1) * options.Step);
+        }
+
+        if (csv.is_open() && !csv)
+        {
+            throw std::runtime_error("can't write " + options.CsvPath);
+        }
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        Run(ParseOptions(argc, argv));
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        std::fprintf(
+            stderr, "usage: %s [--quanta <count>] [--warmup <count>] [--step <count>] [--csv <file>]\n",
+            argc > 0 ? argv[0] : "HrtfWrapperBenchmark");
+        return 1;
+    }
+    return 0;
+}
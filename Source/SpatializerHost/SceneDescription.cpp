@@ -0,0 +1,290 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "SceneDescription.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    constexpr double c_Pi = 3.14159265358979323846;
+
+    [[noreturn]] void ThrowParseError(uint32_t line, const std::string& message)
+    {
+        throw std::runtime_error("line " + std::to_string(line) + ": " + message);
+    }
+
+    float ParseFloat(const std::string& text, uint32_t line)
+    {
+        size_t end = 0;
+        float value = 0.0f;
+        try
+        {
+            value = std::stof(text, &end);
+        }
+        catch (const std::exception&)
+        {
+            end = 0;
+        }
+        if (end == 0 || end != text.size() || !std::isfinite(value))
+        {
+            ThrowParseError(line, "expected a number, got '" + text + "'");
+        }
+        return value;
+    }
+
+    uint32_t ParseCount(const std::string& text, uint32_t line)
+    {
+        const auto value = ParseFloat(text, line);
+        if (value < 1.0f || value > 1e6f || value != std::floor(value))
+        {
+            ThrowParseError(line, "expected a positive integer, got '" + text + "'");
+        }
+        return static_cast<uint32_t>(value);
+    }
+
+    // Comma separated list of minCount to maxCount numbers
+    void ParseList(const std::string& text, uint32_t line, float* values, size_t minCount, size_t maxCount)
+    {
+        std::istringstream stream(text);
+        std::string item;
+        size_t count = 0;
+        while (std::getline(stream, item, ','))
+        {
+            if (count == maxCount)
+            {
+                ThrowParseError(line, "too many values in '" + text + "'");
+            }
+            values[count++] = ParseFloat(item, line);
+        }
+        if (count < minCount)
+        {
+            ThrowParseError(line, "too few values in '" + text + "'");
+        }
+    }
+
+    SourceDescription ParseSource(std::istringstream& tokens, uint32_t line, uint32_t& count)
+    {
+        SourceDescription source = {};
+        source.Gain = 0.5f;
+        source.SpatialBlend = 1.0f;
+        source.MinDistance = 1.0f;
+        count = 1;
+
+        auto hasSignal = false;
+        auto hasFrom = false;
+        auto hasTo = false;
+        std::string token;
+        while (tokens >> token)
+        {
+            const auto equals = token.find('=');
+            if (equals == std::string::npos)
+            {
+                ThrowParseError(line, "expected key=value, got '" + token + "'");
+            }
+            const auto key = token.substr(0, equals);
+            const auto value = token.substr(equals + 1);
+
+            if (key == "sine" || key == "noise")
+            {
+                hasSignal = true;
+                if (key == "sine")
+                {
+                    source.Signal = SourceDescription::SignalType::Sine;
+                    source.Frequency = ParseFloat(value, line);
+                }
+                else
+                {
+                    source.Signal = SourceDescription::SignalType::Noise;
+                    source.Seed = ParseCount(value, line);
+                }
+            }
+            else if (key == "gain")
+            {
+                source.Gain = ParseFloat(value, line);
+            }
+            else if (key == "blend")
+            {
+                source.SpatialBlend = ParseFloat(value, line);
+                if (source.SpatialBlend < 0.0f || source.SpatialBlend > 1.0f)
+                {
+                    ThrowParseError(line, "blend must be between 0 and 1");
+                }
+            }
+            else if (key == "mindistance")
+            {
+                source.MinDistance = ParseFloat(value, line);
+                if (source.MinDistance <= 0.0f)
+                {
+                    ThrowParseError(line, "mindistance must be positive");
+                }
+            }
+            else if (key == "from")
+            {
+                ParseList(value, line, source.From, 3, 3);
+                hasFrom = true;
+            }
+            else if (key == "to")
+            {
+                ParseList(value, line, source.To, 3, 3);
+                hasTo = true;
+            }
+            else if (key == "orbit")
+            {
+                float orbit[3] = {};
+                ParseList(value, line, orbit, 2, 3);
+                if (orbit[1] <= 0.0f)
+                {
+                    ThrowParseError(line, "orbit period must be positive");
+                }
+                source.Orbits = true;
+                source.OrbitRadius = orbit[0];
+                source.OrbitPeriod = orbit[1];
+                source.OrbitHeight = orbit[2];
+            }
+            else if (key == "count")
+            {
+                count = ParseCount(value, line);
+            }
+            else
+            {
+                ThrowParseError(line, "unknown source key '" + key + "'");
+            }
+        }
+
+        if (!hasSignal)
+        {
+            ThrowParseError(line, "source needs sine=<Hz> or noise=<seed>");
+        }
+        if (source.Orbits == (hasFrom || hasTo))
+        {
+            ThrowParseError(line, "source needs either from= and to=, or orbit=");
+        }
+        if (!source.Orbits && !(hasFrom && hasTo))
+        {
+            ThrowParseError(line, "source needs both from= and to=");
+        }
+        return source;
+    }
+} // namespace
+
+SceneDescription LoadScene(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("can't open " + path);
+    }
+
+    SceneDescription scene = {};
+    scene.SampleRate = 48000;
+    scene.DspBufferSize = 1024;
+    scene.Channels = 2;
+    scene.Duration = 5.0f;
+
+    std::string text;
+    uint32_t line = 0;
+    while (std::getline(file, text))
+    {
+        ++line;
+        text = text.substr(0, text.find('#'));
+        std::istringstream tokens(text);
+        std::string statement;
+        if (!(tokens >> statement))
+        {
+            continue;
+        }
+
+        std::string value;
+        if (statement == "source")
+        {
+            uint32_t count = 0;
+            const auto source = ParseSource(tokens, line, count);
+            for (auto i = 0u; i < count; ++i)
+            {
+                auto copy = source;
+                copy.OrbitPhase = static_cast<float>(i) / count;
+                copy.Seed = source.Seed + i;
+                scene.Sources.push_back(copy);
+            }
+        }
+        else if (statement == "listener")
+        {
+            for (auto& coordinate : scene.ListenerPosition)
+            {
+                if (!(tokens >> value))
+                {
+                    ThrowParseError(line, "listener needs x y z");
+                }
+                coordinate = ParseFloat(value, line);
+            }
+        }
+        else
+        {
+            if (!(tokens >> value))
+            {
+                ThrowParseError(line, statement + " needs a value");
+            }
+            if (statement == "samplerate")
+            {
+                scene.SampleRate = ParseCount(value, line);
+            }
+            else if (statement == "buffer")
+            {
+                scene.DspBufferSize = ParseCount(value, line);
+            }
+            else if (statement == "channels")
+            {
+                scene.Channels = ParseCount(value, line);
+                if (scene.Channels < 2)
+                {
+                    ThrowParseError(line, "the spatializer needs at least 2 channels");
+                }
+            }
+            else if (statement == "duration")
+            {
+                scene.Duration = ParseFloat(value, line);
+                if (scene.Duration <= 0.0f)
+                {
+                    ThrowParseError(line, "duration must be positive");
+                }
+            }
+            else
+            {
+                ThrowParseError(line, "unknown statement '" + statement + "'");
+            }
+        }
+
+        if (tokens >> value)
+        {
+            ThrowParseError(line, "unexpected '" + value + "'");
+        }
+    }
+
+    if (scene.Sources.empty())
+    {
+        throw std::runtime_error(path + " has no sources");
+    }
+    return scene;
+}
+
+void GetSourcePosition(const SourceDescription& source, float duration, double time, float position[3]) noexcept
+{
+    if (source.Orbits)
+    {
+        const auto angle = 2.0 * c_Pi * (time / source.OrbitPeriod + source.OrbitPhase);
+        position[0] = static_cast<float>(source.OrbitRadius * std::sin(angle));
+        position[1] = source.OrbitHeight;
+        position[2] = static_cast<float>(source.OrbitRadius * std::cos(angle));
+        return;
+    }
+
+    const auto progress = std::min(time / duration, 1.0);
+    for (auto i = 0; i < 3; ++i)
+    {
+        position[i] = static_cast<float>(source.From[i] + (source.To[i] - source.From[i]) * progress);
+    }
+}
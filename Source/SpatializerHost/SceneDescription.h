@@ -0,0 +1,68 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// A source of the offline scene. Copies of a source are spread out: orbits start at evenly spaced phases and each
+// copy gets its own noise seed.
+struct SourceDescription
+{
+    enum class SignalType
+    {
+        Sine,
+        Noise
+    };
+
+    SignalType Signal;
+    float Frequency; // Sine only
+    uint32_t Seed;   // Noise only
+    float Gain;
+    float SpatialBlend;
+
+    // Distance attenuation handed to the plugin is MinDistance / distance past MinDistance, like Unity's
+    // logarithmic rolloff
+    float MinDistance;
+
+    // Either moves from From to To over the length of the scene, or orbits the listener in the horizontal plane
+    bool Orbits;
+    float From[3];
+    float To[3];
+    float OrbitRadius;
+    float OrbitPeriod; // Seconds
+    float OrbitHeight;
+    float OrbitPhase; // Fraction of a turn at the start
+};
+
+// Everything SpatializerHost needs to render a scene. Positions are in Unity's world space, in meters.
+struct SceneDescription
+{
+    uint32_t SampleRate;
+    uint32_t DspBufferSize;
+    uint32_t Channels;
+    float Duration; // Seconds
+    float ListenerPosition[3];
+    std::vector<SourceDescription> Sources;
+};
+
+// Reads a scene from a text file with one statement per line. '#' starts a comment.
+//   samplerate <Hz>            default 48000
+//   buffer <frames>            DSP buffer size, default 1024
+//   channels <count>           output channels, default 2
+//   duration <seconds>         default 5
+//   listener <x> <y> <z>       default at the origin, facing +z
+//   source <key=value>...      one or more sources, with the keys
+//     sine=<Hz> | noise=<seed>     signal, one of them is required
+//     gain=<linear>                default 0.5
+//     blend=<0..1>                 spatial blend, default 1
+//     mindistance=<m>              default 1
+//     from=<x,y,z> to=<x,y,z>      linear path, or
+//     orbit=<radius,period[,height]>
+//     count=<n>                    copies of the source, default 1
+// Throws std::runtime_error naming the line of the first error.
+SceneDescription LoadScene(const std::string& path);
+
+// Position of the source at time seconds into the scene
+void GetSourcePosition(const SourceDescription& source, float duration, double time, float position[3]) noexcept;
@@ -0,0 +1,497 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// Offline host for the spatializer plugin. Loads the plugin the way Unity does, plays a scene through the Microsoft
+// Spatializer and Microsoft Spatializer Mixer effects one DSP tick at a time, and reports what every callback cost.
+// Everything runs on one thread with synthetic signals, so the same scene renders to the same samples on every run.
+
+#include "AudioPluginInterface.h"
+#include "SceneDescription.h"
+#include "TimingStats.h"
+#include "WavWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <dlfcn.h>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef SPATIALIZER_PLUGIN_PATH
+#define SPATIALIZER_PLUGIN_PATH "libAudioPluginMicrosoftSpatializerCrossPlatform.so"
+#endif
+
+namespace
+{
+    constexpr double c_Pi = 3.14159265358979323846;
+
+    struct Options
+    {
+        std::string ScenePath;
+        std::string PluginPath = SPATIALIZER_PLUGIN_PATH;
+        std::string OutputPath;
+        std::string TimingPath;
+
+        // Checksums the output may have, see GetChecksum. Empty if any will do.
+        std::vector<uint64_t> ExpectedChecksums;
+    };
+
+    // The plugin library and the effects it exports
+    class PluginLibrary final
+    {
+    public:
+        explicit PluginLibrary(const std::string& path) : m_Handle(dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL))
+        {
+            if (m_Handle == nullptr)
+            {
+                throw std::runtime_error(std::string("can't load plugin: ") + dlerror());
+            }
+            using GetDefinitions = int (*)(UnityAudioEffectDefinition***);
+            auto getDefinitions = reinterpret_cast<GetDefinitions>(dlsym(m_Handle, "UnityGetAudioEffectDefinitions"));
+            if (getDefinitions == nullptr)
+            {
+                dlclose(m_Handle);
+                throw std::runtime_error(path + " doesn't export UnityGetAudioEffectDefinitions");
+            }
+            m_NumDefinitions = getDefinitions(&m_Definitions);
+        }
+
+        ~PluginLibrary()
+        {
+            dlclose(m_Handle);
+        }
+
+        PluginLibrary(const PluginLibrary&) = delete;
+        PluginLibrary& operator=(const PluginLibrary&) = delete;
+
+        const UnityAudioEffectDefinition& GetEffect(const char* name) const
+        {
+            for (auto i = 0; i < m_NumDefinitions; ++i)
+            {
+                if (std::strcmp(m_Definitions[i]->name, name) == 0)
+                {
+                    return *m_Definitions[i];
+                }
+            }
+            throw std::runtime_error(std::string("plugin has no effect named ") + name);
+        }
+
+    private:
+        void* m_Handle;
+        UnityAudioEffectDefinition** m_Definitions = nullptr;
+        int m_NumDefinitions = 0;
+    };
+
+    // An effect instance and the state Unity keeps for it
+    class EffectInstance final
+    {
+    public:
+        EffectInstance(const UnityAudioEffectDefinition& definition, const SceneDescription& scene, bool spatializer)
+            : m_Definition(definition), m_State(), m_SpatializerData()
+        {
+            m_State.structsize = sizeof(UnityAudioEffectState);
+            m_State.samplerate = scene.SampleRate;
+            m_State.flags = UnityAudioEffectStateFlags_IsPlaying;
+            m_State.internal = this; // Only checked for null by the plugin
+            m_State.spatializerdata = spatializer ? &m_SpatializerData : nullptr;
+            m_State.dspbuffersize = scene.DspBufferSize;
+            m_State.hostapiversion = UNITY_AUDIO_PLUGIN_API_VERSION;
+            m_SpatializerData.spatialblend = 1.0f;
+            m_Created = m_Definition.create(&m_State) == UNITY_AUDIODSP_OK;
+        }
+
+        ~EffectInstance()
+        {
+            m_Definition.release(&m_State);
+        }
+
+        EffectInstance(const EffectInstance&) = delete;
+        EffectInstance& operator=(const EffectInstance&) = delete;
+
+        bool WasCreated() const noexcept
+        {
+            return m_Created;
+        }
+
+        UnityAudioSpatializerData& GetSpatializerData() noexcept
+        {
+            return m_SpatializerData;
+        }
+
+        // Asks the plugin for the distance attenuation Unity should apply on top of its own
+        float GetAttenuation(float distance, float attenuation) noexcept
+        {
+            auto result = attenuation;
+            if (m_SpatializerData.distanceattenuationcallback != nullptr)
+            {
+                m_SpatializerData.distanceattenuationcallback(&m_State, distance, attenuation, &result);
+            }
+            return result;
+        }
+
+        // Reads one of the plugin's named float buffers, false if the plugin doesn't know the name
+        bool GetFloatBuffer(const char* name, float* buffer, int numSamples) noexcept
+        {
+            return m_Definition.getfloatbuffer != nullptr &&
+                   m_Definition.getfloatbuffer(&m_State, name, buffer, numSamples) == UNITY_AUDIODSP_OK;
+        }
+
+        // Runs the process callback for the block starting at sample tick and returns how long it took
+        double Process(uint64_t tick, float* input, float* output, uint32_t length, uint32_t channels) noexcept
+        {
+            m_State.prevdsptick = m_State.currdsptick;
+            m_State.currdsptick = tick;
+            const auto start = std::chrono::steady_clock::now();
+            m_Definition.process(&m_State, input, output, length, channels, channels);
+            const auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::micro>(end - start).count();
+        }
+
+    private:
+        const UnityAudioEffectDefinition& m_Definition;
+        UnityAudioEffectState m_State;
+        UnityAudioSpatializerData m_SpatializerData;
+        bool m_Created;
+    };
+
+    // Deterministic test signal of a source
+    class SignalGenerator final
+    {
+    public:
+        SignalGenerator(const SourceDescription& source, uint32_t sampleRate)
+            : m_Source(source)
+            , m_PhaseStep(2.0 * c_Pi * source.Frequency / sampleRate)
+            , m_Phase(0)
+            , m_Noise(source.Seed)
+        {
+        }
+
+        float Next() noexcept
+        {
+            if (m_Source.Signal == SourceDescription::SignalType::Sine)
+            {
+                const auto value = static_cast<float>(std::sin(m_Phase));
+                m_Phase = std::fmod(m_Phase + m_PhaseStep, 2.0 * c_Pi);
+                return value;
+            }
+
+            // xorshift32, uniform in [-1, 1)
+            m_Noise ^= m_Noise << 13;
+            m_Noise ^= m_Noise >> 17;
+            m_Noise ^= m_Noise << 5;
+            return static_cast<float>(m_Noise) / 2147483648.0f - 1.0f;
+        }
+
+    private:
+        const SourceDescription& m_Source;
+        const double m_PhaseStep;
+        double m_Phase;
+        uint32_t m_Noise;
+    };
+
+    void PrintStats(const char* name, const std::vector<double>& timesUs)
+    {
+        const auto stats = GetTimingStats(timesUs);
+        std::printf(
+            "%-12s %10zu %10.1f %10.1f %10.1f %10.1f\n", name, timesUs.size(), stats.MeanUs, stats.MedianUs,
+            stats.P99Us, stats.MaxUs);
+    }
+
+    // The plugin's own load statistics, which cover about the last second of the render
+    void PrintPluginMetrics(EffectInstance& effect)
+    {
+        std::printf("%-20s %10s %10s %10s %10s %10s\n", "plugin metric", "count", "mean", "median", "p99", "max");
+        for (auto name : {"ProcessTimeUs", "MixerProcessTimeUs", "HrtfPassTimeUs", "ActiveSources"})
+        {
+            float fields[5];
+            if (effect.GetFloatBuffer(name, fields, 5))
+            {
+                std::printf(
+                    "%-20s %10.0f %10.1f %10.1f %10.1f %10.1f\n", name, fields[4], fields[0], fields[1], fields[2],
+                    fields[3]);
+            }
+        }
+        for (auto name : {"VoiceSteals", "AcquireFailures", "DeadlineMisses", "LateInputs", "ParameterUpdates"})
+        {
+            float total;
+            if (effect.GetFloatBuffer(name, &total, 1))
+            {
+                std::printf("%-20s %10.0f\n", name, total);
+            }
+        }
+
+        // Last pass of every engine shard, and the slots it rendered
+        std::printf("%-20s %10s %10s %10s %16s\n", "last shard pass", "time us", "thread", "inputs", "slots");
+        for (auto shard = 0u;; ++shard)
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "ShardRenderTimeUs/%u", shard);
+            float fields[6];
+            if (!effect.GetFloatBuffer(name, fields, 6))
+            {
+                break;
+            }
+            char slots[32] = "-";
+            if (fields[2] > 0.0f)
+            {
+                std::snprintf(slots, sizeof(slots), "%.0f-%.0f/%.0f", fields[3], fields[4], fields[5]);
+            }
+            std::printf("%-20s %10.1f %10.0f %10.0f %16s\n", name, fields[0], fields[1], fields[2], slots);
+        }
+    }
+
+    // FNV-1a over the bits of the output, to compare renders without keeping the WAV files
+    uint64_t GetChecksum(const std::vector<float>& samples) noexcept
+    {
+        auto hash = 14695981039346656037ull;
+        const auto bytes = reinterpret_cast<const unsigned char*>(samples.data());
+        for (size_t i = 0; i < samples.size() * sizeof(float); ++i)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t ParseChecksum(const std::string& text)
+    {
+        size_t parsed = 0;
+        unsigned long long value = 0;
+        try
+        {
+            value = std::stoull(text, &parsed, 16);
+        }
+        catch (const std::exception&)
+        {
+            parsed = 0;
+        }
+        if (parsed == 0 || parsed != text.size())
+        {
+            throw std::runtime_error("invalid checksum " + text);
+        }
+        return value;
+    }
+
+    Options ParseOptions(int argc, char** argv)
+    {
+        Options options;
+        for (auto i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+            if (argument.rfind("--", 0) == 0 && i + 1 < argc)
+            {
+                if (argument == "--plugin")
+                {
+                    options.PluginPath = argv[++i];
+                    continue;
+                }
+                if (argument == "--output")
+                {
+                    options.OutputPath = argv[++i];
+                    continue;
+                }
+                if (argument == "--timing")
+                {
+                    options.TimingPath = argv[++i];
+                    continue;
+                }
+                if (argument == "--expect-checksum")
+                {
+                    options.ExpectedChecksums.push_back(ParseChecksum(argv[++i]));
+                    continue;
+                }
+            }
+            if (argument.rfind("--", 0) == 0 || !options.ScenePath.empty())
+            {
+                throw std::runtime_error("unexpected argument " + argument);
+            }
+            options.ScenePath = argument;
+        }
+        if (options.ScenePath.empty())
+        {
+            throw std::runtime_error("no scene file given");
+        }
+        return options;
+    }
+
+    // Returns false if the output doesn't have any of the expected checksums
+    bool Render(const Options& options)
+    {
+        const auto scene = LoadScene(options.ScenePath);
+        const PluginLibrary plugin(options.PluginPath);
+        const auto& spatializer = plugin.GetEffect("Microsoft Spatializer");
+        const auto& mixer = plugin.GetEffect("Microsoft Spatializer Mixer");
+
+        // Unity creates the mixer with the mixer group, before any source plays
+        EffectInstance mixerInstance(mixer, scene, false);
+        std::vector<std::unique_ptr<EffectInstance>> sources;
+        std::vector<SignalGenerator> signals;
+        signals.reserve(scene.Sources.size());
+        for (size_t i = 0; i < scene.Sources.size(); ++i)
+        {
+            sources.push_back(std::make_unique<EffectInstance>(spatializer, scene, true));
+            if (!sources.back()->WasCreated())
+            {
+                std::fprintf(stderr, "warning: source %zu has no HRTF slot, it stays silent until one frees up\n", i);
+            }
+            signals.emplace_back(scene.Sources[i], scene.SampleRate);
+        }
+
+        const auto length = scene.DspBufferSize;
+        const auto channels = scene.Channels;
+        const auto numTicks = static_cast<uint64_t>(std::ceil(scene.Duration * scene.SampleRate / length));
+        std::vector<float> input(length * channels);
+        std::vector<float> output(length * channels);
+        std::vector<float> bus(length * channels);
+        std::vector<float> render;
+        render.reserve(numTicks * length * channels);
+
+        // The listener stays put, Unity hands spatializers its world to local transform
+        float listenerMatrix[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+        for (auto i = 0; i < 3; ++i)
+        {
+            listenerMatrix[12 + i] = -scene.ListenerPosition[i];
+        }
+
+        std::vector<double> sourceUs;
+        std::vector<double> mixerUs;
+        std::vector<double> tickUs;
+        sourceUs.reserve(numTicks * sources.size());
+        mixerUs.reserve(numTicks);
+        tickUs.reserve(numTicks);
+        const auto deadlineUs = 1e6 * length / scene.SampleRate;
+        auto deadlineMisses = 0u;
+
+        const auto renderStart = std::chrono::steady_clock::now();
+        for (uint64_t tick = 0; tick < numTicks; ++tick)
+        {
+            const auto sampleTick = tick * length;
+            const auto time = static_cast<double>(sampleTick) / scene.SampleRate;
+            std::fill(bus.begin(), bus.end(), 0.0f);
+
+            double tickTimeUs = 0;
+            for (size_t i = 0; i < sources.size(); ++i)
+            {
+                const auto& description = scene.Sources[i];
+                auto& source = *sources[i];
+                auto& data = source.GetSpatializerData();
+
+                float position[3];
+                GetSourcePosition(description, scene.Duration, time, position);
+                const float sourceMatrix[16] = {
+                    1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, position[0], position[1], position[2], 1};
+                std::memcpy(data.sourcematrix, sourceMatrix, sizeof(sourceMatrix));
+                std::memcpy(data.listenermatrix, listenerMatrix, sizeof(listenerMatrix));
+                data.spatialblend = description.SpatialBlend;
+
+                float distanceSquared = 0;
+                for (auto j = 0; j < 3; ++j)
+                {
+                    const auto delta = position[j] - scene.ListenerPosition[j];
+                    distanceSquared += delta * delta;
+                }
+                const auto distance = std::sqrt(distanceSquared);
+                const auto rolloff = distance > description.MinDistance ? description.MinDistance / distance : 1.0f;
+                const auto gain = description.Gain * source.GetAttenuation(distance, rolloff);
+
+                // Unity hands spatializers stereo, in the first two channels of the output layout
+                std::fill(input.begin(), input.end(), 0.0f);
+                for (auto frame = 0u; frame < length; ++frame)
+                {
+                    const auto sample = signals[i].Next() * gain;
+                    input[frame * channels] = sample;
+                    input[frame * channels + 1] = sample;
+                }
+
+                const auto elapsedUs = source.Process(sampleTick, input.data(), output.data(), length, channels);
+                sourceUs.push_back(elapsedUs);
+                tickTimeUs += elapsedUs;
+                for (size_t j = 0; j < bus.size(); ++j)
+                {
+                    bus[j] += output[j];
+                }
+            }
+
+            const auto elapsedUs = mixerInstance.Process(sampleTick, bus.data(), output.data(), length, channels);
+            mixerUs.push_back(elapsedUs);
+            tickTimeUs += elapsedUs;
+            tickUs.push_back(tickTimeUs);
+            if (tickTimeUs > deadlineUs)
+            {
+                ++deadlineMisses;
+            }
+            render.insert(render.end(), output.begin(), output.end());
+        }
+        const auto renderSeconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+
+        const auto renderedSeconds = static_cast<double>(numTicks * length) / scene.SampleRate;
+        std::printf(
+            "Rendered %.2f s of %zu sources in %.2f s (%.1fx real time)\n", renderedSeconds, sources.size(),
+            renderSeconds, renderedSeconds / renderSeconds);
+        std::printf(
+            "%-12s %10s %10s %10s %10s %10s\n", "callback", "count", "mean us", "median us", "p99 us", "max us");
+        PrintStats("Spatializer", sourceUs);
+        PrintStats("Mixer", mixerUs);
+        PrintStats("Tick", tickUs);
+        std::printf("Ticks over the %.0f us deadline: %u\n", deadlineUs, deadlineMisses);
+        const auto checksum = GetChecksum(render);
+        std::printf("Output checksum: %016llx\n", static_cast<unsigned long long>(checksum));
+        PrintPluginMetrics(mixerInstance);
+
+        if (!options.TimingPath.empty())
+        {
+            std::ofstream timing(options.TimingPath);
+            timing << "tick,sources_us,mixer_us\n";
+            for (size_t tick = 0; tick < tickUs.size(); ++tick)
+            {
+                timing << tick << ',' << tickUs[tick] - mixerUs[tick] << ',' << mixerUs[tick] << '\n';
+            }
+            if (!timing)
+            {
+                throw std::runtime_error("can't write " + options.TimingPath);
+            }
+        }
+        if (!options.OutputPath.empty())
+        {
+            WriteWavFile(options.OutputPath, render, channels, scene.SampleRate);
+        }
+
+        const auto& expected = options.ExpectedChecksums;
+        if (!expected.empty() && std::find(expected.begin(), expected.end(), checksum) == expected.end())
+        {
+            std::fprintf(stderr, "error: output checksum %016llx, expected", static_cast<unsigned long long>(checksum));
+            for (const auto value : expected)
+            {
+                std::fprintf(stderr, " %016llx", static_cast<unsigned long long>(value));
+            }
+            std::fprintf(stderr, "\n");
+            return false;
+        }
+        return true;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (!Render(ParseOptions(argc, argv)))
+        {
+            return 2;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        std::fprintf(
+            stderr,
+            "usage: %s <scene> [--plugin <library>] [--output <wav>] [--timing <csv>] [--expect-checksum <hex>]\n",
+            argc > 0 ? argv[0] : "SpatializerHost");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,23 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "TimingStats.h"
+#include <algorithm>
+
+TimingStats GetTimingStats(std::vector<double> timesUs)
+{
+    if (timesUs.empty())
+    {
+        return {};
+    }
+    std::sort(timesUs.begin(), timesUs.end());
+    double sum = 0;
+    for (auto time : timesUs)
+    {
+        sum += time;
+    }
+    const auto percentile = [&](double fraction) {
+        return timesUs[std::min(timesUs.size() - 1, static_cast<size_t>(fraction * timesUs.size()))];
+    };
+    return {sum / timesUs.size(), percentile(0.5), percentile(0.99), timesUs.back()};
+}
@@ -0,0 +1,17 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include <vector>
+
+// Summary of a series of timings, in microseconds
+struct TimingStats
+{
+    double MeanUs;
+    double MedianUs;
+    double P99Us;
+    double MaxUs;
+};
+
+// All zero when there are no timings
+TimingStats GetTimingStats(std::vector<double> timesUs);
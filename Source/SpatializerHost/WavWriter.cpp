@@ -0,0 +1,51 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "WavWriter.h"
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    // RIFF is little endian, like every platform the host builds for
+    void WriteValue(std::ofstream& file, uint32_t value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void WriteValue(std::ofstream& file, uint16_t value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+} // namespace
+
+void WriteWavFile(const std::string& path, const std::vector<float>& samples, uint32_t channels, uint32_t sampleRate)
+{
+    constexpr uint16_t c_WaveFormatIeeeFloat = 3;
+    constexpr uint32_t c_FormatChunkSize = 16;
+    const auto dataSize = static_cast<uint32_t>(samples.size() * sizeof(float));
+    const auto blockAlign = static_cast<uint16_t>(channels * sizeof(float));
+
+    std::ofstream file(path, std::ios::binary);
+    file.write("RIFF", 4);
+    WriteValue(file, 4 + (8 + c_FormatChunkSize) + (8 + dataSize));
+    file.write("WAVE", 4);
+
+    file.write("fmt ", 4);
+    WriteValue(file, c_FormatChunkSize);
+    WriteValue(file, c_WaveFormatIeeeFloat);
+    WriteValue(file, static_cast<uint16_t>(channels));
+    WriteValue(file, sampleRate);
+    WriteValue(file, sampleRate * blockAlign);
+    WriteValue(file, blockAlign);
+    WriteValue(file, static_cast<uint16_t>(8 * sizeof(float)));
+
+    file.write("data", 4);
+    WriteValue(file, dataSize);
+    file.write(reinterpret_cast<const char*>(samples.data()), dataSize);
+
+    if (!file)
+    {
+        throw std::runtime_error("can't write " + path);
+    }
+}
@@ -0,0 +1,11 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Writes interleaved samples to a 32-bit float WAV file, so the output can be compared bit for bit.
+// Throws std::runtime_error if the file can't be written.
+void WriteWavFile(const std::string& path, const std::vector<float>& samples, uint32_t channels, uint32_t sampleRate);
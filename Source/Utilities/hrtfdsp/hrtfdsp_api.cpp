@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "HrtfApi.h"
+#include "hrtfdsp_engine.h"
+
+using HrtfDsp::HrtfEngine;
+
+bool HRTFDSP_API
+HrtfEngineInitialize(uint32_t maxSources, HrtfEngineType engineType, uint32_t framesPerBuffer, ObjectHandle* engine)
+{
+    if (engine == nullptr)
+    {
+        return false;
+    }
+
+    try
+    {
+        *engine = new HrtfEngine(maxSources, engineType, framesPerBuffer);
+    }
+    catch (...)
+    {
+        *engine = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void HRTFDSP_API HrtfEngineUninitialize(ObjectHandle engine)
+{
+    delete static_cast<HrtfEngine*>(engine);
+}
+
+bool HRTFDSP_API HrtfEngineAcquireResourcesForSource(ObjectHandle engine, uint32_t index)
+{
+    return engine != nullptr && static_cast<HrtfEngine*>(engine)->AcquireResourcesForSource(index);
+}
+
+void HRTFDSP_API HrtfEngineReleaseResourcesForSource(ObjectHandle engine, uint32_t index)
+{
+    if (engine != nullptr)
+    {
+        static_cast<HrtfEngine*>(engine)->ReleaseResourcesForSource(index);
+    }
+}
+
+bool HRTFDSP_API
+HrtfEngineSetParametersForSource(ObjectHandle engine, uint32_t index, const HrtfAcousticParameters* params)
+{
+    return engine != nullptr && static_cast<HrtfEngine*>(engine)->SetParametersForSource(index, params);
+}
+
+uint32_t HRTFDSP_API HrtfEngineProcess(
+    ObjectHandle engine, HrtfInputBuffer* inputs, uint32_t numInputs, float* output, uint32_t outputLength)
+{
+    if (engine == nullptr)
+    {
+        return 0;
+    }
+    return static_cast<HrtfEngine*>(engine)->Process(inputs, numInputs, output, outputLength);
+}
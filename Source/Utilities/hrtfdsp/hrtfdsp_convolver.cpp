@@ -0,0 +1,383 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "hrtfdsp_convolver.h"
+#include "vectormath.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace HrtfDsp
+{
+    // Partition spectra hold B + 1 complex bins. Pad to an even count so every partition stays 16-byte aligned.
+    static uint32_t GetAlignedSpectrumStride(uint32_t blockLength)
+    {
+        return (blockLength + 2) & ~1u;
+    }
+
+    PartitionedFilter::PartitionedFilter(uint32_t blockLength, uint32_t numPartitions)
+        : m_NumPartitions(numPartitions)
+        , m_PartitionStride(GetAlignedSpectrumStride(blockLength))
+        , m_ActivePartitions(0)
+        , m_Spectra(AlignedStore::AllocateComplexBuffer(numPartitions * m_PartitionStride))
+    {
+        std::memset(m_Spectra.get(), 0, numPartitions * m_PartitionStride * sizeof(VectorMath::floatFC));
+    }
+
+    UniformPartitionedConvolver::UniformPartitionedConvolver(
+        uint32_t blockLength, uint32_t numPartitions, std::shared_ptr<VectorMath::IRealFft> fft)
+        : m_BlockLength(blockLength)
+        , m_NumPartitions(numPartitions)
+        , m_FftLength(2 * blockLength)
+        , m_SpectrumLength(blockLength + 1)
+        , m_PartitionStride(GetAlignedSpectrumStride(blockLength))
+        , m_Fft(std::move(fft))
+        , m_Head(0)
+    {
+        if (numPartitions == 0 || !m_Fft || m_Fft->GetTimeDomainBufferLength() != m_FftLength)
+        {
+            throw std::invalid_argument("fft");
+        }
+
+        m_DelayLine.reset(AlignedStore::AllocateComplexBuffer(numPartitions * m_PartitionStride));
+        m_InputBlock.reset(AlignedStore::AllocateFloatBuffer(m_FftLength));
+        m_Accumulator.reset(AlignedStore::AllocateComplexBuffer(m_PartitionStride));
+        m_TimeDomain.reset(AlignedStore::AllocateFloatBuffer(m_FftLength));
+        Reset();
+    }
+
+    void UniformPartitionedConvolver::DesignFilter(
+        const float* impulseResponse, uint32_t length, PartitionedFilter& filter) noexcept
+    {
+        const auto numPartitions = std::min(m_NumPartitions, filter.GetNumPartitions());
+        length = std::min(length, numPartitions * m_BlockLength);
+
+        // Each partition is zero-padded to 2B so that the overlap-save output is free of circular aliasing
+        std::memset(m_TimeDomain.get(), 0, m_FftLength * sizeof(float));
+        filter.m_ActivePartitions = 0;
+        for (auto p = 0u; p < numPartitions; ++p)
+        {
+            const auto offset = p * m_BlockLength;
+            const auto taps = offset < length ? std::min(m_BlockLength, length - offset) : 0;
+            if (taps == 0)
+            {
+                std::memset(filter.GetPartition(p), 0, m_SpectrumLength * sizeof(VectorMath::floatFC));
+                continue;
+            }
+
+            std::memcpy(m_TimeDomain.get(), impulseResponse + offset, taps * sizeof(float));
+            std::memset(m_TimeDomain.get() + taps, 0, (m_BlockLength - taps) * sizeof(float));
+            m_Fft->ForwardFft(m_TimeDomain.get(), m_FftLength, filter.GetPartition(p), m_SpectrumLength);
+            filter.m_ActivePartitions = p + 1;
+        }
+    }
+
+    void UniformPartitionedConvolver::Push(const float* input) noexcept
+    {
+        // Slide the overlap-save block along and transform it into the newest delay line slot
+        auto block = m_InputBlock.get();
+        std::memcpy(block, block + m_BlockLength, m_BlockLength * sizeof(float));
+        std::memcpy(block + m_BlockLength, input, m_BlockLength * sizeof(float));
+
+        m_Head = (m_Head + 1) % m_NumPartitions;
+        m_Fft->ForwardFft(block, m_FftLength, m_DelayLine.get() + m_Head * m_PartitionStride, m_SpectrumLength);
+    }
+
+    void UniformPartitionedConvolver::Convolve(const PartitionedFilter& filter, float* output) noexcept
+    {
+        if (std::min(filter.GetActivePartitions(), m_NumPartitions) == 0)
+        {
+            std::memset(output, 0, m_BlockLength * sizeof(float));
+            return;
+        }
+
+        Accumulate(filter, 0, m_NumPartitions, m_Accumulator.get());
+        Transform(m_Accumulator.get(), output);
+    }
+
+    void UniformPartitionedConvolver::Accumulate(
+        const PartitionedFilter& filter, uint32_t first, uint32_t count, VectorMath::floatFC* spectrum) noexcept
+    {
+        if (first == 0)
+        {
+            std::memset(spectrum, 0, m_SpectrumLength * sizeof(VectorMath::floatFC));
+        }
+
+        // Partition p of the filter meets the input block pushed p blocks ago
+        const auto end = std::min(first + count, std::min(filter.GetActivePartitions(), m_NumPartitions));
+        for (auto p = first; p < end; ++p)
+        {
+            const auto slot = (m_Head + m_NumPartitions - p) % m_NumPartitions;
+            VectorMath::Arithmetic::AddProduct_32fc(
+                spectrum, m_DelayLine.get() + slot * m_PartitionStride, filter.GetPartition(p), m_SpectrumLength);
+        }
+    }
+
+    void UniformPartitionedConvolver::Transform(VectorMath::floatFC* spectrum, float* output) noexcept
+    {
+        // The second half of the inverse transform is the valid linear convolution output
+        m_Fft->InverseFft(spectrum, m_SpectrumLength, m_TimeDomain.get(), m_FftLength);
+        std::memcpy(output, m_TimeDomain.get() + m_BlockLength, m_BlockLength * sizeof(float));
+    }
+
+    void UniformPartitionedConvolver::Reset() noexcept
+    {
+        m_Head = 0;
+        std::memset(m_DelayLine.get(), 0, m_NumPartitions * m_PartitionStride * sizeof(VectorMath::floatFC));
+        std::memset(m_InputBlock.get(), 0, m_FftLength * sizeof(float));
+    }
+
+    // Linear ramp that reaches 1 on the last sample of the block
+    static void FillFades(float* fadeIn, float* fadeOut, uint32_t length)
+    {
+        for (auto i = 0u; i < length; ++i)
+        {
+            fadeIn[i] = static_cast<float>(i + 1) / length;
+            fadeOut[i] = 1.0f - fadeIn[i];
+        }
+    }
+
+    NonUniformPartitionedConvolver::NonUniformPartitionedConvolver(
+        uint32_t headBlockLength, uint32_t tailBlockLength, uint32_t maxFilterLength, uint32_t numChannels,
+        std::shared_ptr<VectorMath::IRealFft> headFft, std::shared_ptr<VectorMath::IRealFft> tailFft)
+        : m_TailBlockLength(tailBlockLength)
+        , m_Head(
+              headBlockLength,
+              (std::min(maxFilterLength, 2 * tailBlockLength) + headBlockLength - 1) / headBlockLength,
+              std::move(headFft))
+        , m_Channels(numChannels)
+        , m_TailFill(0)
+        , m_TailUnits(0)
+        , m_TailUnit(0)
+        , m_TailChannel(0)
+        , m_TailPosition(0)
+    {
+        if (headBlockLength == 0 || tailBlockLength < headBlockLength || tailBlockLength % headBlockLength != 0)
+        {
+            throw std::invalid_argument("tailBlockLength");
+        }
+
+        // The head covers the first two tail blocks of taps, the tail everything after
+        if (maxFilterLength > 2 * tailBlockLength)
+        {
+            const auto tailPartitions = (maxFilterLength - 2 * tailBlockLength + tailBlockLength - 1) / tailBlockLength;
+            m_Tail = std::make_unique<UniformPartitionedConvolver>(tailBlockLength, tailPartitions, std::move(tailFft));
+            m_TailInput.reset(AlignedStore::AllocateFloatBuffer(tailBlockLength));
+        }
+
+        for (auto& channel : m_Channels)
+        {
+            channel.Head = std::make_unique<PartitionedFilter>(headBlockLength, m_Head.GetNumPartitions());
+            channel.NextHead = std::make_unique<PartitionedFilter>(headBlockLength, m_Head.GetNumPartitions());
+            channel.HeadPending = false;
+            channel.TailPending = false;
+            channel.Fading = false;
+            if (m_Tail)
+            {
+                const auto numPartitions = m_Tail->GetNumPartitions();
+                channel.Tail = std::make_unique<PartitionedFilter>(tailBlockLength, numPartitions);
+                channel.NextTail = std::make_unique<PartitionedFilter>(tailBlockLength, numPartitions);
+                channel.FadingTail = std::make_unique<PartitionedFilter>(tailBlockLength, numPartitions);
+                channel.TailOutput.reset(AlignedStore::AllocateFloatBuffer(tailBlockLength));
+                channel.NextTailOutput.reset(AlignedStore::AllocateFloatBuffer(tailBlockLength));
+                channel.TailSpectrum.reset(AlignedStore::AllocateComplexBuffer(m_Tail->GetSpectrumStride()));
+                channel.FadingSpectrum.reset(AlignedStore::AllocateComplexBuffer(m_Tail->GetSpectrumStride()));
+            }
+        }
+
+        m_Scratch.reset(AlignedStore::AllocateFloatBuffer(tailBlockLength));
+        m_HeadFadeIn.reset(AlignedStore::AllocateFloatBuffer(headBlockLength));
+        m_HeadFadeOut.reset(AlignedStore::AllocateFloatBuffer(headBlockLength));
+        m_TailFadeIn.reset(AlignedStore::AllocateFloatBuffer(tailBlockLength));
+        m_TailFadeOut.reset(AlignedStore::AllocateFloatBuffer(tailBlockLength));
+        FillFades(m_HeadFadeIn.get(), m_HeadFadeOut.get(), headBlockLength);
+        FillFades(m_TailFadeIn.get(), m_TailFadeOut.get(), tailBlockLength);
+        Reset();
+    }
+
+    void NonUniformPartitionedConvolver::SetFilter(
+        uint32_t channel, const float* impulseResponse, uint32_t length, bool crossfade) noexcept
+    {
+        auto& state = m_Channels[channel];
+        const auto headLength = 2 * m_TailBlockLength;
+        m_Head.DesignFilter(impulseResponse, std::min(length, headLength), crossfade ? *state.NextHead : *state.Head);
+        state.HeadPending = crossfade;
+
+        if (m_Tail)
+        {
+            const auto tailLength = length > headLength ? length - headLength : 0;
+            m_Tail->DesignFilter(impulseResponse + headLength, tailLength, crossfade ? *state.NextTail : *state.Tail);
+            state.TailPending = crossfade;
+
+            // A filter swapped in right away also cancels a fade in progress
+            state.Fading = state.Fading && crossfade;
+        }
+    }
+
+    void NonUniformPartitionedConvolver::Process(const float* input, float* const* outputs) noexcept
+    {
+        const auto headBlockLength = m_Head.GetBlockLength();
+        m_Head.Push(input);
+
+        if (outputs != nullptr)
+        {
+            for (auto i = 0u; i < m_Channels.size(); ++i)
+            {
+                auto& channel = m_Channels[i];
+                m_Head.Convolve(*channel.Head, outputs[i]);
+                if (channel.HeadPending)
+                {
+                    m_Head.Convolve(*channel.NextHead, m_Scratch.get());
+                    Crossfade(outputs[i], m_Scratch.get(), m_HeadFadeOut.get(), m_HeadFadeIn.get(), headBlockLength);
+                    std::swap(channel.Head, channel.NextHead);
+                    channel.HeadPending = false;
+                }
+                if (m_Tail)
+                {
+                    VectorMath::Arithmetic::Add_32f_I(
+                        outputs[i], channel.TailOutput.get() + m_TailFill, headBlockLength);
+                }
+            }
+        }
+
+        if (!m_Tail)
+        {
+            return;
+        }
+
+        // Do this head block's share of the tail work on the previous tail block, which the first step pushes
+        const auto step = m_TailFill / headBlockLength;
+        if (step == 0)
+        {
+            StartTailBlock(outputs != nullptr);
+        }
+        RenderTailStep(step);
+
+        std::memcpy(m_TailInput.get() + m_TailFill, input, headBlockLength * sizeof(float));
+        m_TailFill += headBlockLength;
+        if (m_TailFill < m_TailBlockLength)
+        {
+            return;
+        }
+
+        // The tail output computed over this block is due in the next one
+        m_TailFill = 0;
+        for (auto& channel : m_Channels)
+        {
+            std::swap(channel.TailOutput, channel.NextTailOutput);
+        }
+    }
+
+    // Pushes the completed tail block and plans its work. Pending filter changes are picked up here, so that a
+    // block is convolved with the same filters throughout. Without outputs, the delay line advances but the next
+    // tail output is silent.
+    void NonUniformPartitionedConvolver::StartTailBlock(bool render) noexcept
+    {
+        m_Tail->Push(m_TailInput.get());
+
+        m_TailUnits = 0;
+        m_TailUnit = 0;
+        m_TailChannel = 0;
+        m_TailPosition = 0;
+        for (auto& channel : m_Channels)
+        {
+            channel.TailUnits = 0;
+            if (!render)
+            {
+                std::memset(channel.NextTailOutput.get(), 0, m_TailBlockLength * sizeof(float));
+                continue;
+            }
+            if (channel.TailPending)
+            {
+                std::swap(channel.NextTail, channel.FadingTail);
+                channel.TailPending = false;
+                channel.Fading = true;
+            }
+            channel.TailUnits = m_Tail->GetNumPartitions() * (channel.Fading ? 2 : 1);
+            m_TailUnits += channel.TailUnits;
+        }
+    }
+
+    // Step s of a tail block gets units [s * U / S, (s + 1) * U / S) of the U units in the block. A channel's
+    // inverse transforms are done by the step that completes its last unit.
+    void NonUniformPartitionedConvolver::RenderTailStep(uint32_t step) noexcept
+    {
+        const auto numSteps = m_TailBlockLength / m_Head.GetBlockLength();
+        const auto end = (step + 1) * m_TailUnits / numSteps;
+        const auto numPartitions = m_Tail->GetNumPartitions();
+        while (m_TailUnit < end)
+        {
+            auto& channel = m_Channels[m_TailChannel];
+            const auto channelUnits = channel.TailUnits;
+            const auto count = std::min(end - m_TailUnit, channelUnits - m_TailPosition);
+
+            // The current filter's partitions come first, then those of the filter it fades to
+            auto position = m_TailPosition;
+            if (position < numPartitions)
+            {
+                const auto current = std::min(count, numPartitions - position);
+                m_Tail->Accumulate(*channel.Tail, position, current, channel.TailSpectrum.get());
+                position += current;
+            }
+            if (position < m_TailPosition + count)
+            {
+                m_Tail->Accumulate(
+                    *channel.FadingTail, position - numPartitions, m_TailPosition + count - position,
+                    channel.FadingSpectrum.get());
+            }
+
+            m_TailUnit += count;
+            m_TailPosition += count;
+            if (m_TailPosition == channelUnits)
+            {
+                FinishTail(channel);
+                ++m_TailChannel;
+                m_TailPosition = 0;
+            }
+        }
+    }
+
+    void NonUniformPartitionedConvolver::FinishTail(Channel& channel) noexcept
+    {
+        m_Tail->Transform(channel.TailSpectrum.get(), channel.NextTailOutput.get());
+        if (!channel.Fading)
+        {
+            return;
+        }
+
+        m_Tail->Transform(channel.FadingSpectrum.get(), m_Scratch.get());
+        Crossfade(
+            channel.NextTailOutput.get(), m_Scratch.get(), m_TailFadeOut.get(), m_TailFadeIn.get(), m_TailBlockLength);
+        std::swap(channel.Tail, channel.FadingTail);
+        channel.Fading = false;
+    }
+
+    void NonUniformPartitionedConvolver::Reset() noexcept
+    {
+        m_Head.Reset();
+        m_TailFill = 0;
+        m_TailUnits = 0;
+        m_TailUnit = 0;
+        m_TailChannel = 0;
+        m_TailPosition = 0;
+        if (m_Tail)
+        {
+            m_Tail->Reset();
+            std::memset(m_TailInput.get(), 0, m_TailBlockLength * sizeof(float));
+            for (auto& channel : m_Channels)
+            {
+                channel.Fading = false;
+                channel.TailUnits = 0;
+                std::memset(channel.TailOutput.get(), 0, m_TailBlockLength * sizeof(float));
+                std::memset(channel.NextTailOutput.get(), 0, m_TailBlockLength * sizeof(float));
+            }
+        }
+    }
+
+    void NonUniformPartitionedConvolver::Crossfade(
+        float* current, const float* next, const float* fadeOut, const float* fadeIn, uint32_t length) noexcept
+    {
+        VectorMath::Arithmetic::Mul_32f(current, current, fadeOut, length);
+        VectorMath::Arithmetic::AddProduct_32f(current, next, fadeIn, length);
+    }
+} // namespace HrtfDsp
@@ -0,0 +1,205 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include "AlignedAllocator.h"
+#include <memory>
+#include <vector>
+
+namespace HrtfDsp
+{
+    // Frequency domain representation of an impulse response, split into equally sized partitions.
+    // Designed by, and only valid for, a UniformPartitionedConvolver with the same block length.
+    class PartitionedFilter final
+    {
+    public:
+        PartitionedFilter(uint32_t blockLength, uint32_t numPartitions);
+
+        uint32_t GetNumPartitions() const noexcept
+        {
+            return m_NumPartitions;
+        }
+
+        // Number of non-zero partitions in the current filter
+        uint32_t GetActivePartitions() const noexcept
+        {
+            return m_ActivePartitions;
+        }
+
+        uint32_t GetPartitionStride() const noexcept
+        {
+            return m_PartitionStride;
+        }
+
+        VectorMath::floatFC* GetPartition(uint32_t partition) noexcept
+        {
+            return m_Spectra.get() + partition * m_PartitionStride;
+        }
+
+        const VectorMath::floatFC* GetPartition(uint32_t partition) const noexcept
+        {
+            return m_Spectra.get() + partition * m_PartitionStride;
+        }
+
+    private:
+        friend class UniformPartitionedConvolver;
+
+        const uint32_t m_NumPartitions;
+        const uint32_t m_PartitionStride;
+        uint32_t m_ActivePartitions;
+        AlignedStore::ComplexBuffer m_Spectra;
+    };
+
+    // Uniformly-partitioned overlap-save (UPOLS) convolution.
+    // Each block of B input samples is transformed once with a 2B point FFT and pushed into a frequency-domain
+    // delay line (FDL). The output spectrum of a filter is the sum over partitions of FDL[p] * H[p], so a block
+    // costs one forward FFT, one inverse FFT per filter and P complex multiply-accumulates, instead of the
+    // B * P * B multiplies of direct-form convolution. Several filters can be applied to the same input,
+    // which is how the engine renders both ears and crossfades between filters without transforming twice.
+    class UniformPartitionedConvolver final
+    {
+    public:
+        UniformPartitionedConvolver(
+            uint32_t blockLength, uint32_t numPartitions, std::shared_ptr<VectorMath::IRealFft> fft);
+
+        uint32_t GetBlockLength() const noexcept
+        {
+            return m_BlockLength;
+        }
+
+        uint32_t GetNumPartitions() const noexcept
+        {
+            return m_NumPartitions;
+        }
+
+        // Transforms an impulse response into filter. Taps beyond the convolver's capacity are ignored.
+        void DesignFilter(const float* impulseResponse, uint32_t length, PartitionedFilter& filter) noexcept;
+
+        // Pushes one block of GetBlockLength() input samples into the delay line
+        void Push(const float* input) noexcept;
+
+        // Filters the most recently pushed block, writing GetBlockLength() samples to output
+        void Convolve(const PartitionedFilter& filter, float* output) noexcept;
+
+        // Convolve in pieces, for callers that spread the work of a block over time. Accumulate adds partitions
+        // [first, first + count) of filter, applied to the delay line, to a spectrum of GetSpectrumStride() bins.
+        // Starting at partition 0 overwrites the spectrum. Transform turns it into GetBlockLength() output samples.
+        void Accumulate(
+            const PartitionedFilter& filter, uint32_t first, uint32_t count, VectorMath::floatFC* spectrum) noexcept;
+        void Transform(VectorMath::floatFC* spectrum, float* output) noexcept;
+
+        uint32_t GetSpectrumStride() const noexcept
+        {
+            return m_PartitionStride;
+        }
+
+        // Clears the delay line
+        void Reset() noexcept;
+
+    private:
+        const uint32_t m_BlockLength;
+        const uint32_t m_NumPartitions;
+        const uint32_t m_FftLength;
+        const uint32_t m_SpectrumLength;
+        const uint32_t m_PartitionStride;
+        std::shared_ptr<VectorMath::IRealFft> m_Fft;
+
+        // Ring of input block spectra, m_Head is the most recent
+        AlignedStore::ComplexBuffer m_DelayLine;
+        uint32_t m_Head;
+
+        // Previous and current input blocks, the overlap-save FFT input
+        AlignedStore::FloatBuffer m_InputBlock;
+
+        // Scratch for accumulation and the inverse transform
+        AlignedStore::ComplexBuffer m_Accumulator;
+        AlignedStore::FloatBuffer m_TimeDomain;
+    };
+
+    // Non-uniformly partitioned convolution for low-latency rendering.
+    // The first two tail blocks' worth of taps are convolved in small head partitions, so output is available every
+    // head block. The remaining taps are convolved in large tail partitions that are only transformed once per tail
+    // block. Their output is needed two tail blocks after the input, so the tail work of each block, the forward
+    // transform, the multiply-accumulates and the inverse transforms, is spread evenly over the head blocks of the
+    // next one instead of landing on the head block that completes it. This keeps the latency of the head block
+    // size, and a steady cost per head block, while the per-sample cost of the tail stays close to that of a uniform
+    // convolver with large blocks. Filter updates are crossfaded over one head block (head) and one tail block (tail).
+    // The engine doesn't use it: its HRIRs are too short to have a tail that takes larger partitions than the head.
+    class NonUniformPartitionedConvolver final
+    {
+    public:
+        // tailBlockLength must be a multiple of headBlockLength. The transforms must have twice the block lengths.
+        NonUniformPartitionedConvolver(
+            uint32_t headBlockLength, uint32_t tailBlockLength, uint32_t maxFilterLength, uint32_t numChannels,
+            std::shared_ptr<VectorMath::IRealFft> headFft, std::shared_ptr<VectorMath::IRealFft> tailFft);
+
+        uint32_t GetBlockLength() const noexcept
+        {
+            return m_Head.GetBlockLength();
+        }
+
+        // Sets the impulse response of one output channel. With crossfade == false the filter is swapped in
+        // immediately, which is only click-free while the delay line is silent.
+        void SetFilter(uint32_t channel, const float* impulseResponse, uint32_t length, bool crossfade) noexcept;
+
+        // Consumes one block of GetBlockLength() input samples and writes one block to each of outputs.
+        // With outputs == nullptr the delay lines advance without rendering.
+        void Process(const float* input, float* const* outputs) noexcept;
+
+        // Clears all delay lines
+        void Reset() noexcept;
+
+    private:
+        struct Channel
+        {
+            std::unique_ptr<PartitionedFilter> Head;
+            std::unique_ptr<PartitionedFilter> NextHead;
+            std::unique_ptr<PartitionedFilter> Tail;
+            std::unique_ptr<PartitionedFilter> NextTail;
+            bool HeadPending;
+            bool TailPending;
+
+            // Filter the tail fades to in the tail block being computed. NextTail is free for SetFilter meanwhile.
+            std::unique_ptr<PartitionedFilter> FadingTail;
+            bool Fading;
+
+            // Units of tail work planned for this channel in the current tail block
+            uint32_t TailUnits;
+
+            // Tail output for the current tail block, computed during the previous one, and the output being
+            // computed for the next one with its spectra
+            AlignedStore::FloatBuffer TailOutput;
+            AlignedStore::FloatBuffer NextTailOutput;
+            AlignedStore::ComplexBuffer TailSpectrum;
+            AlignedStore::ComplexBuffer FadingSpectrum;
+        };
+
+        static void Crossfade(
+            float* current, const float* next, const float* fadeOut, const float* fadeIn, uint32_t length) noexcept;
+
+        void StartTailBlock(bool render) noexcept;
+        void RenderTailStep(uint32_t step) noexcept;
+        void FinishTail(Channel& channel) noexcept;
+
+        const uint32_t m_TailBlockLength;
+        UniformPartitionedConvolver m_Head;
+        std::unique_ptr<UniformPartitionedConvolver> m_Tail;
+        std::vector<Channel> m_Channels;
+
+        // Input collected for the next tail block
+        AlignedStore::FloatBuffer m_TailInput;
+        uint32_t m_TailFill;
+
+        // Progress through the tail work of the current block. A unit is one partition of one filter of a channel.
+        uint32_t m_TailUnits;
+        uint32_t m_TailUnit;
+        uint32_t m_TailChannel;
+        uint32_t m_TailPosition;
+
+        AlignedStore::FloatBuffer m_Scratch;
+        AlignedStore::FloatBuffer m_HeadFadeIn;
+        AlignedStore::FloatBuffer m_HeadFadeOut;
+        AlignedStore::FloatBuffer m_TailFadeIn;
+        AlignedStore::FloatBuffer m_TailFadeOut;
+    };
+} // namespace HrtfDsp
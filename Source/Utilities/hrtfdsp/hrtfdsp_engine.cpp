@@ -0,0 +1,231 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "hrtfdsp_engine.h"
+#include "hrtfdsp_hrir.h"
+#include "mathutility.h"
+#include "vectormath.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace HrtfDsp
+{
+    HrtfEngine::HrtfEngine(uint32_t maxSources, HrtfEngineType, uint32_t framesPerBuffer)
+        : m_MaxSources(maxSources)
+        , m_FramesPerBuffer(framesPerBuffer)
+        , m_BlockLength(std::min(framesPerBuffer, c_ConvolutionBlockLength))
+        , m_NumPartitions((c_HrirLength + m_BlockLength - 1) / m_BlockLength)
+        , m_Sources(maxSources)
+    {
+        // Overlap-save needs a power of two FFT, and a quantum that is a multiple of the SIMD width
+        if (maxSources == 0 || framesPerBuffer < 4 || !IsPowerOfTwo(static_cast<int>(framesPerBuffer)))
+        {
+            throw std::invalid_argument("framesPerBuffer");
+        }
+
+        // FFT state is only touched from Process, so all sources share one transform
+        auto fft = VectorMath::CreateSharedRealFft(2 * m_BlockLength);
+
+        for (auto& source : m_Sources)
+        {
+            source.Convolver = std::make_unique<UniformPartitionedConvolver>(m_BlockLength, m_NumPartitions, fft);
+            source.FilterLeft = std::make_unique<PartitionedFilter>(m_BlockLength, m_NumPartitions);
+            source.FilterRight = std::make_unique<PartitionedFilter>(m_BlockLength, m_NumPartitions);
+            source.Acquired = false;
+            ResetSource(source);
+        }
+
+        m_NextFilterLeft = std::make_unique<PartitionedFilter>(m_BlockLength, m_NumPartitions);
+        m_NextFilterRight = std::make_unique<PartitionedFilter>(m_BlockLength, m_NumPartitions);
+        m_HrirLeft.reset(AlignedStore::AllocateFloatBuffer(c_HrirLength));
+        m_HrirRight.reset(AlignedStore::AllocateFloatBuffer(c_HrirLength));
+        m_Convolved.reset(AlignedStore::AllocateFloatBuffer(m_BlockLength));
+        m_ConvolvedNext.reset(AlignedStore::AllocateFloatBuffer(m_BlockLength));
+        m_FadeIn.reset(AlignedStore::AllocateFloatBuffer(m_FramesPerBuffer));
+        m_FadeOut.reset(AlignedStore::AllocateFloatBuffer(m_FramesPerBuffer));
+        m_GainRamp.reset(AlignedStore::AllocateFloatBuffer(m_BlockLength));
+        m_MixLeft.reset(AlignedStore::AllocateFloatBuffer(m_FramesPerBuffer));
+        m_MixRight.reset(AlignedStore::AllocateFloatBuffer(m_FramesPerBuffer));
+
+        // Linear crossfade that reaches the new filter on the last frame of the quantum
+        for (auto i = 0u; i < m_FramesPerBuffer; ++i)
+        {
+            m_FadeIn[i] = static_cast<float>(i + 1) / m_FramesPerBuffer;
+            m_FadeOut[i] = 1.0f - m_FadeIn[i];
+        }
+    }
+
+    bool HrtfEngine::AcquireResourcesForSource(uint32_t index) noexcept
+    {
+        if (index >= m_MaxSources)
+        {
+            return false;
+        }
+        ResetSource(m_Sources[index]);
+        m_Sources[index].Acquired = true;
+        return true;
+    }
+
+    void HrtfEngine::ReleaseResourcesForSource(uint32_t index) noexcept
+    {
+        if (index < m_MaxSources)
+        {
+            m_Sources[index].Acquired = false;
+        }
+    }
+
+    bool HrtfEngine::SetParametersForSource(uint32_t index, const HrtfAcousticParameters* params) noexcept
+    {
+        if (index >= m_MaxSources || params == nullptr || !m_Sources[index].Acquired)
+        {
+            return false;
+        }
+        m_Sources[index].Parameters = *params;
+        m_Sources[index].HasParameters = true;
+        return true;
+    }
+
+    uint32_t HrtfEngine::Process(
+        const HrtfInputBuffer* inputs, uint32_t numInputs, float* output, uint32_t outputLength) noexcept
+    {
+        if (inputs == nullptr || output == nullptr || outputLength % m_FramesPerBuffer != 0)
+        {
+            return 0;
+        }
+        const auto numChannels = outputLength / m_FramesPerBuffer;
+        if (numChannels < 2)
+        {
+            return 0;
+        }
+
+        std::memset(m_MixLeft.get(), 0, m_FramesPerBuffer * sizeof(float));
+        std::memset(m_MixRight.get(), 0, m_FramesPerBuffer * sizeof(float));
+
+        const auto numSources = std::min(numInputs, m_MaxSources);
+        for (auto i = 0u; i < numSources; ++i)
+        {
+            if (m_Sources[i].Acquired && inputs[i].Buffer != nullptr && inputs[i].Length >= m_FramesPerBuffer)
+            {
+                RenderSource(m_Sources[i], inputs[i].Buffer);
+            }
+        }
+
+        // Binaural mix goes to the first two channels, any others are left silent
+        std::memset(output, 0, outputLength * sizeof(float));
+        for (auto i = 0u; i < m_FramesPerBuffer; ++i)
+        {
+            output[i * numChannels] = m_MixLeft[i];
+            output[i * numChannels + 1] = m_MixRight[i];
+        }
+
+        return outputLength;
+    }
+
+    void HrtfEngine::ResetSource(SourceState& source) noexcept
+    {
+        source.HasParameters = false;
+        source.HasFilter = false;
+        source.Parameters = {};
+        source.FilterDirection = {0, 0, 0};
+        source.Gain = 0.0f;
+        source.Convolver->Reset();
+    }
+
+    void HrtfEngine::DesignFilter(
+        UniformPartitionedConvolver& convolver, const ATKVectorF& direction, PartitionedFilter& left,
+        PartitionedFilter& right) noexcept
+    {
+        SynthesizeHrir(direction, c_EngineSampleRate, m_HrirLeft.get(), m_HrirRight.get(), c_HrirLength);
+        convolver.DesignFilter(m_HrirLeft.get(), c_HrirLength, left);
+        convolver.DesignFilter(m_HrirRight.get(), c_HrirLength, right);
+    }
+
+    // Renders one convolution block of one ear at offset frames into the quantum, and mixes it into mix
+    void HrtfEngine::RenderEar(
+        UniformPartitionedConvolver& convolver, const PartitionedFilter& filter, const PartitionedFilter* nextFilter,
+        float startGain, float endGain, uint32_t offset, float* mix) noexcept
+    {
+        auto rendered = m_Convolved.get();
+        convolver.Convolve(filter, rendered);
+
+        // Crossfade from the previous direction's filter output to the new one
+        if (nextFilter != nullptr)
+        {
+            convolver.Convolve(*nextFilter, m_ConvolvedNext.get());
+            VectorMath::Arithmetic::Mul_32f(rendered, rendered, m_FadeOut.get() + offset, m_BlockLength);
+            VectorMath::Arithmetic::AddProduct_32f(
+                rendered, m_ConvolvedNext.get(), m_FadeIn.get() + offset, m_BlockLength);
+        }
+
+        if (startGain == endGain)
+        {
+            VectorMath::Arithmetic::AddProductC_32f(mix + offset, rendered, endGain, m_BlockLength);
+        }
+        else
+        {
+            const auto delta = endGain - startGain;
+            for (auto i = 0u; i < m_BlockLength; ++i)
+            {
+                m_GainRamp[i] = startGain + delta * m_FadeIn[offset + i];
+            }
+            VectorMath::Arithmetic::AddProduct_32f(mix + offset, rendered, m_GainRamp.get(), m_BlockLength);
+        }
+    }
+
+    void HrtfEngine::RenderSource(SourceState& source, const float* input) noexcept
+    {
+        auto& convolver = *source.Convolver;
+
+        // Keep the delay line running so that the filter tail is correct once parameters arrive
+        if (!source.HasParameters)
+        {
+            for (auto offset = 0u; offset < m_FramesPerBuffer; offset += m_BlockLength)
+            {
+                convolver.Push(input + offset);
+            }
+            return;
+        }
+
+        const auto& params = source.Parameters;
+        const auto& direction = params.PrimaryArrivalDirection;
+        const auto targetGain =
+            DbToAmplitude(params.PrimaryArrivalGeometryPowerDb + params.PrimaryArrivalDistancePowerDb);
+
+        // The first quantum after acquisition starts directly with the requested filter and gain
+        auto directionChanged = false;
+        if (!source.HasFilter)
+        {
+            DesignFilter(convolver, direction, *source.FilterLeft, *source.FilterRight);
+            source.FilterDirection = direction;
+            source.Gain = targetGain;
+            source.HasFilter = true;
+        }
+        else if (
+            direction.x != source.FilterDirection.x || direction.y != source.FilterDirection.y ||
+            direction.z != source.FilterDirection.z)
+        {
+            DesignFilter(convolver, direction, *m_NextFilterLeft, *m_NextFilterRight);
+            directionChanged = true;
+        }
+
+        for (auto offset = 0u; offset < m_FramesPerBuffer; offset += m_BlockLength)
+        {
+            convolver.Push(input + offset);
+            RenderEar(
+                convolver, *source.FilterLeft, directionChanged ? m_NextFilterLeft.get() : nullptr, source.Gain,
+                targetGain, offset, m_MixLeft.get());
+            RenderEar(
+                convolver, *source.FilterRight, directionChanged ? m_NextFilterRight.get() : nullptr, source.Gain,
+                targetGain, offset, m_MixRight.get());
+        }
+
+        if (directionChanged)
+        {
+            std::swap(source.FilterLeft, m_NextFilterLeft);
+            std::swap(source.FilterRight, m_NextFilterRight);
+            source.FilterDirection = direction;
+        }
+        source.Gain = targetGain;
+    }
+} // namespace HrtfDsp
@@ -0,0 +1,85 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include "HrtfApi.h"
+#include "hrtfdsp_convolver.h"
+#include "AlignedAllocator.h"
+#include <memory>
+#include <vector>
+
+namespace HrtfDsp
+{
+    // The engine API does not carry a sample rate. Like the prebuilt engine, filters are designed for 48kHz.
+    constexpr uint32_t c_EngineSampleRate = 48000;
+
+    // Partition length of the HRIR convolution. Quanta larger than this are rendered in several blocks.
+    constexpr uint32_t c_ConvolutionBlockLength = 256;
+
+    // Reference binaural renderer behind the HrtfEngine* C API.
+    // Each source is filtered with a spherical head model HRIR pair using uniformly-partitioned convolution. Quanta up
+    // to c_ConvolutionBlockLength are convolved in blocks of the quantum, so small quanta render without added latency.
+    // At c_HrirLength taps there is no tail long enough for larger, non-uniform partitions to pay off.
+    // Direction changes are crossfaded over one quantum and gain changes are ramped to avoid zipper noise.
+    // All methods must be called from the same thread, or be externally serialized.
+    class HrtfEngine final
+    {
+    public:
+        HrtfEngine(uint32_t maxSources, HrtfEngineType engineType, uint32_t framesPerBuffer);
+        ~HrtfEngine() = default;
+
+        bool AcquireResourcesForSource(uint32_t index) noexcept;
+        void ReleaseResourcesForSource(uint32_t index) noexcept;
+        bool SetParametersForSource(uint32_t index, const HrtfAcousticParameters* params) noexcept;
+        uint32_t
+        Process(const HrtfInputBuffer* inputs, uint32_t numInputs, float* output, uint32_t outputLength) noexcept;
+
+    private:
+        struct SourceState
+        {
+            bool Acquired;
+            bool HasParameters;
+            bool HasFilter;
+            HrtfAcousticParameters Parameters;
+
+            // Direction and gain the current filter and output were rendered with
+            ATKVectorF FilterDirection;
+            float Gain;
+
+            // Input delay line shared by both ears, and the frequency domain HRIR of each ear
+            std::unique_ptr<UniformPartitionedConvolver> Convolver;
+            std::unique_ptr<PartitionedFilter> FilterLeft;
+            std::unique_ptr<PartitionedFilter> FilterRight;
+        };
+
+        void ResetSource(SourceState& source) noexcept;
+        void DesignFilter(
+            UniformPartitionedConvolver& convolver, const ATKVectorF& direction, PartitionedFilter& left,
+            PartitionedFilter& right) noexcept;
+        void RenderEar(
+            UniformPartitionedConvolver& convolver, const PartitionedFilter& filter,
+            const PartitionedFilter* nextFilter, float startGain, float endGain, uint32_t offset,
+            float* mix) noexcept;
+        void RenderSource(SourceState& source, const float* input) noexcept;
+
+        const uint32_t m_MaxSources;
+        const uint32_t m_FramesPerBuffer;
+        const uint32_t m_BlockLength;
+        const uint32_t m_NumPartitions;
+
+        std::vector<SourceState> m_Sources;
+
+        // Scratch buffers shared by all sources during Process
+        std::unique_ptr<PartitionedFilter> m_NextFilterLeft;
+        std::unique_ptr<PartitionedFilter> m_NextFilterRight;
+        AlignedStore::FloatBuffer m_HrirLeft;
+        AlignedStore::FloatBuffer m_HrirRight;
+        AlignedStore::FloatBuffer m_Convolved;
+        AlignedStore::FloatBuffer m_ConvolvedNext;
+        AlignedStore::FloatBuffer m_FadeIn;
+        AlignedStore::FloatBuffer m_FadeOut;
+        AlignedStore::FloatBuffer m_GainRamp;
+        AlignedStore::FloatBuffer m_MixLeft;
+        AlignedStore::FloatBuffer m_MixRight;
+    };
+} // namespace HrtfDsp
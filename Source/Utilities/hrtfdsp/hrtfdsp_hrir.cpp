@@ -0,0 +1,84 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "hrtfdsp_hrir.h"
+#include "mathutility.h"
+#include <cmath>
+#include <cstring>
+
+namespace HrtfDsp
+{
+    constexpr float c_Pi = static_cast<float>(M_PI);
+
+    // Spherical head model constants
+    constexpr float c_HeadRadius = 0.0875f;    // In meters
+    constexpr float c_SpeedOfSound = 343.0f;   // In meters per second
+    constexpr float c_MinShadowAlpha = 0.1f;   // Head shadow gain at the shadowed pole
+    constexpr float c_MinShadowAngle = 2.618f; // 150 degrees, angle of deepest shadow
+
+    // Half-width of the windowed sinc used for fractional delays. Also the bulk delay added to keep the HRIR causal.
+    constexpr int c_SincHalfWidth = 8;
+
+    // Time of arrival at an ear relative to the center of the head, offset so that it is never negative.
+    // angleFromEar is the angle between the source direction and the outward ear axis.
+    static float WoodworthDelaySeconds(float angleFromEar)
+    {
+        constexpr float halfPi = c_Pi / 2;
+        if (angleFromEar < halfPi)
+        {
+            return (c_HeadRadius / c_SpeedOfSound) * (1.0f - std::cos(angleFromEar));
+        }
+        return (c_HeadRadius / c_SpeedOfSound) * (1.0f + angleFromEar - halfPi);
+    }
+
+    static void SynthesizeEar(float angleFromEar, uint32_t sampleRate, float* hrir, uint32_t length)
+    {
+        std::memset(hrir, 0, length * sizeof(float));
+
+        // Fractional delay: Hann-windowed sinc centered on the arrival time
+        const auto delay = WoodworthDelaySeconds(angleFromEar) * sampleRate + c_SincHalfWidth;
+        const auto center = static_cast<int>(std::floor(delay));
+        for (auto k = center - c_SincHalfWidth + 1; k <= center + c_SincHalfWidth; ++k)
+        {
+            if (k < 0 || k >= static_cast<int>(length))
+            {
+                continue;
+            }
+            const auto x = static_cast<float>(k) - delay;
+            const auto phase = c_Pi * x;
+            const auto sinc = std::fabs(phase) < 1e-6f ? 1.0f : std::sin(phase) / phase;
+            const auto window = 0.5f + 0.5f * std::cos(phase / c_SincHalfWidth);
+            hrir[k] = sinc * window;
+        }
+
+        // Head shadow: H(s) = (alpha * s + beta) / (s + beta), discretized with the bilinear transform
+        const auto alpha = (1.0f + c_MinShadowAlpha / 2) +
+                           (1.0f - c_MinShadowAlpha / 2) * std::cos(c_Pi * angleFromEar / c_MinShadowAngle);
+        const auto beta = 2.0f * c_SpeedOfSound / c_HeadRadius;
+        const auto twoFs = 2.0f * sampleRate;
+        const auto b0 = (alpha * twoFs + beta) / (twoFs + beta);
+        const auto b1 = (beta - alpha * twoFs) / (twoFs + beta);
+        const auto a1 = (beta - twoFs) / (twoFs + beta);
+
+        auto x1 = 0.0f;
+        auto y1 = 0.0f;
+        for (auto i = 0u; i < length; ++i)
+        {
+            const auto x0 = hrir[i];
+            const auto y0 = b0 * x0 + b1 * x1 - a1 * y1;
+            x1 = x0;
+            y1 = y0;
+            hrir[i] = y0;
+        }
+    }
+
+    void SynthesizeHrir(const ATKVectorF& direction, uint32_t sampleRate, float* left, float* right, uint32_t length)
+    {
+        // Ears lie on the x axis, so the angle to each ear only depends on the normalized x component.
+        // A zero-length direction is rendered straight ahead, equidistant from both ears.
+        const auto norm = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+        const auto cosToRightEar = norm < 1e-4f ? 0.0f : Clamp(direction.x / norm, -1.0f, 1.0f);
+        SynthesizeEar(std::acos(-cosToRightEar), sampleRate, left, length);
+        SynthesizeEar(std::acos(cosToRightEar), sampleRate, right, length);
+    }
+} // namespace HrtfDsp
@@ -0,0 +1,17 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include "HrtfApi.h"
+#include <stdint.h>
+
+namespace HrtfDsp
+{
+    // Length of the synthesized head-related impulse responses, in samples
+    constexpr uint32_t c_HrirLength = 256;
+
+    // Synthesizes a left/right head-related impulse response pair for a rigid spherical head (Brown & Duda, 1998):
+    // a Woodworth interaural delay followed by a one-pole/one-zero head shadow filter per ear.
+    // direction does not need to be normalized. A zero-length direction is rendered as straight ahead.
+    void SynthesizeHrir(const ATKVectorF& direction, uint32_t sampleRate, float* left, float* right, uint32_t length);
+} // namespace HrtfDsp
@@ -0,0 +1,139 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// Open reference implementation of the HrtfDsp engine API.
+// Mirrors the surface of the prebuilt Microsoft.ProjectAcoustics.HrtfDsp package so that the spatializer
+// can be built, profiled and load-tested on platforms where the binary is not available. Rendering is based
+// on a spherical head model and is not perceptually equivalent to the shipping engine.
+#pragma once
+
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#define HRTFDSP_API __cdecl
+#else
+#define HRTFDSP_API
+#endif
+
+typedef struct ATKVectorF
+{
+    float x;
+    float y;
+    float z;
+} ATKVectorF;
+
+#ifdef __cplusplus
+using VectorF = ATKVectorF;
+#endif
+
+// Mono input for one source. Buffer == nullptr marks the source as inactive for the current pass.
+typedef struct HrtfInputBuffer
+{
+    float* Buffer;
+    uint32_t Length;
+} HrtfInputBuffer;
+
+// Per-source rendering parameters. Directions use the Windows coordinate system (x+ right, y+ up, z- forward)
+typedef struct HrtfAcousticParameters
+{
+    float EffectiveSourceDistance;
+    ATKVectorF PrimaryArrivalDirection;
+    float PrimaryArrivalGeometryPowerDb;
+    float PrimaryArrivalDistancePowerDb;
+    ATKVectorF SecondaryArrivalDirection;
+    float SecondaryArrivalGeometryPowerDb;
+    float SecondaryArrivalDistancePowerDb;
+    float EarlyReflectionsPowerDb;
+    float EarlyReflections60DbDecaySeconds;
+    float LateReverb60DbDecaySeconds;
+    float Outdoorness;
+} HrtfAcousticParameters;
+
+// The reference engine renders the primary arrival only, regardless of the requested engine type
+typedef enum HrtfEngineType
+{
+    HrtfEngineType_FlexBinaural_High = 0,
+    HrtfEngineType_FlexBinaural_Low,
+    HrtfEngineType_FlexBinaural_High_NoReverb,
+    HrtfEngineType_FlexBinaural_Low_NoReverb,
+    HrtfEngineType_Count
+} HrtfEngineType;
+
+typedef void* ObjectHandle;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Creates an engine that renders up to maxSources sources in quanta of framesPerBuffer frames
+    bool HRTFDSP_API HrtfEngineInitialize(
+        uint32_t maxSources, HrtfEngineType engineType, uint32_t framesPerBuffer, ObjectHandle* engine);
+
+    void HRTFDSP_API HrtfEngineUninitialize(ObjectHandle engine);
+
+    // Prepares the source at index for rendering. Resets any filter state left over from a previous owner.
+    bool HRTFDSP_API HrtfEngineAcquireResourcesForSource(ObjectHandle engine, uint32_t index);
+
+    void HRTFDSP_API HrtfEngineReleaseResourcesForSource(ObjectHandle engine, uint32_t index);
+
+    bool HRTFDSP_API
+    HrtfEngineSetParametersForSource(ObjectHandle engine, uint32_t index, const HrtfAcousticParameters* params);
+
+    // Renders one quantum of all active inputs into interleaved output. outputLength is the total number of floats
+    // in output and must be a multiple of framesPerBuffer with at least two channels. Returns the number of floats
+    // written, or 0 on failure.
+    uint32_t HRTFDSP_API HrtfEngineProcess(
+        ObjectHandle engine, HrtfInputBuffer* inputs, uint32_t numInputs, float* output, uint32_t outputLength);
+
+#ifdef __cplusplus
+}
+
+// Owning handle for an engine instance
+class HrtfEngineHandle final
+{
+public:
+    HrtfEngineHandle() = default;
+    HrtfEngineHandle(const HrtfEngineHandle&) = delete;
+    HrtfEngineHandle& operator=(const HrtfEngineHandle&) = delete;
+
+    ~HrtfEngineHandle()
+    {
+        Reset();
+    }
+
+    ObjectHandle Get() const noexcept
+    {
+        return m_Handle;
+    }
+
+    void Reset(ObjectHandle handle = nullptr) noexcept
+    {
+        if (m_Handle)
+        {
+            HrtfEngineUninitialize(m_Handle);
+        }
+        m_Handle = handle;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return m_Handle != nullptr;
+    }
+
+private:
+    ObjectHandle m_Handle = nullptr;
+};
+
+inline bool HrtfEngineInitialize(
+    uint32_t maxSources, HrtfEngineType engineType, uint32_t framesPerBuffer, HrtfEngineHandle* engine)
+{
+    ObjectHandle handle = nullptr;
+    if (!HrtfEngineInitialize(maxSources, engineType, framesPerBuffer, &handle))
+    {
+        return false;
+    }
+    engine->Reset(handle);
+    return true;
+}
+#endif
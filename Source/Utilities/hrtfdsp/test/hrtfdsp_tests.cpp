@@ -0,0 +1,285 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "gtest.h"
+#include "HrtfApi.h"
+#include "hrtfdsp_convolver.h"
+#include "vectormath.h"
+#include "AlignedAllocator.h" // AlignedStore
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace AudioUnitTests
+{
+    constexpr uint32_t c_TestFrameCount = 1024;
+    constexpr uint32_t c_TestMaxSources = 4;
+
+    class CHrtfDspReferenceTests : public ::testing::Test
+    {
+    protected:
+        void SetUp()
+        {
+            ASSERT_TRUE(HrtfEngineInitialize(
+                c_TestMaxSources, HrtfEngineType_FlexBinaural_High_NoReverb, c_TestFrameCount, &m_Engine));
+
+            std::mt19937 generator(42);
+            std::uniform_real_distribution<float> distribution(-0.5f, 0.5f);
+            m_Input.resize(c_TestFrameCount);
+            for (auto& sample : m_Input)
+            {
+                sample = distribution(generator);
+            }
+            m_Output.resize(2 * c_TestFrameCount);
+            for (auto& input : m_Inputs)
+            {
+                input = {nullptr, 0};
+            }
+        }
+
+        // Renders a few quanta of noise from a single source and returns the energy of each ear
+        std::pair<float, float> RenderEnergy(ATKVectorF direction)
+        {
+            EXPECT_TRUE(HrtfEngineAcquireResourcesForSource(m_Engine.Get(), 0));
+            HrtfAcousticParameters params = {};
+            params.PrimaryArrivalDirection = direction;
+            EXPECT_TRUE(HrtfEngineSetParametersForSource(m_Engine.Get(), 0, &params));
+            m_Inputs[0] = {m_Input.data(), c_TestFrameCount};
+
+            auto left = 0.0f;
+            auto right = 0.0f;
+            for (auto pass = 0; pass < 4; ++pass)
+            {
+                auto written = HrtfEngineProcess(
+                    m_Engine.Get(), m_Inputs, c_TestMaxSources, m_Output.data(), 2 * c_TestFrameCount);
+                EXPECT_EQ(2 * c_TestFrameCount, written);
+                for (auto i = 0u; i < c_TestFrameCount; ++i)
+                {
+                    left += m_Output[2 * i] * m_Output[2 * i];
+                    right += m_Output[2 * i + 1] * m_Output[2 * i + 1];
+                }
+            }
+            HrtfEngineReleaseResourcesForSource(m_Engine.Get(), 0);
+            return {left, right};
+        }
+
+        HrtfEngineHandle m_Engine;
+        HrtfInputBuffer m_Inputs[c_TestMaxSources];
+        AlignedStore::aligned_vector<float> m_Input;
+        AlignedStore::aligned_vector<float> m_Output;
+    };
+
+    TEST_F(CHrtfDspReferenceTests, RejectsInvalidConfiguration)
+    {
+        HrtfEngineHandle engine;
+        EXPECT_FALSE(HrtfEngineInitialize(c_TestMaxSources, HrtfEngineType_FlexBinaural_High_NoReverb, 1000, &engine));
+        EXPECT_FALSE(HrtfEngineInitialize(0, HrtfEngineType_FlexBinaural_High_NoReverb, c_TestFrameCount, &engine));
+        EXPECT_FALSE(HrtfEngineAcquireResourcesForSource(m_Engine.Get(), c_TestMaxSources));
+
+        // Output must hold whole quanta of at least two channels
+        EXPECT_EQ(0u, HrtfEngineProcess(m_Engine.Get(), m_Inputs, c_TestMaxSources, m_Output.data(), c_TestFrameCount));
+        EXPECT_EQ(0u, HrtfEngineProcess(m_Engine.Get(), m_Inputs, c_TestMaxSources, m_Output.data(), 100));
+    }
+
+    TEST_F(CHrtfDspReferenceTests, InactiveSourcesAreSilent)
+    {
+        m_Inputs[1] = {m_Input.data(), c_TestFrameCount};
+        EXPECT_EQ(
+            2 * c_TestFrameCount,
+            HrtfEngineProcess(m_Engine.Get(), m_Inputs, c_TestMaxSources, m_Output.data(), 2 * c_TestFrameCount));
+        for (auto sample : m_Output)
+        {
+            EXPECT_EQ(0.0f, sample);
+        }
+    }
+
+    TEST_F(CHrtfDspReferenceTests, LateralizesSources)
+    {
+        auto front = RenderEnergy({0, 0, -1});
+        EXPECT_GT(front.first, 0.0f);
+        EXPECT_NEAR(1.0f, front.first / front.second, 1e-3f);
+
+        auto right = RenderEnergy({1, 0, 0});
+        EXPECT_GT(right.second, 2.0f * right.first);
+
+        auto left = RenderEnergy({-1, 0, 0});
+        EXPECT_GT(left.first, 2.0f * left.second);
+    }
+
+    // Direct-form reference for the partitioned convolvers
+    static std::vector<float> DirectConvolution(const std::vector<float>& input, const std::vector<float>& filter)
+    {
+        std::vector<float> output(input.size(), 0.0f);
+        for (auto n = 0u; n < input.size(); ++n)
+        {
+            auto sum = 0.0;
+            for (auto k = 0u; k < filter.size() && k <= n; ++k)
+            {
+                sum += static_cast<double>(filter[k]) * input[n - k];
+            }
+            output[n] = static_cast<float>(sum);
+        }
+        return output;
+    }
+
+    static std::vector<float> RandomSignal(size_t length, unsigned int seed)
+    {
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<float> distribution(-0.5f, 0.5f);
+        std::vector<float> signal(length);
+        for (auto& sample : signal)
+        {
+            sample = distribution(generator);
+        }
+        return signal;
+    }
+
+    TEST(CConvolverTests, UniformPartitionedMatchesDirectForm)
+    {
+        constexpr uint32_t blockLength = 64;
+        constexpr uint32_t numBlocks = 24;
+        const auto input = RandomSignal(blockLength * numBlocks, 1);
+
+        // Filter lengths that fill, partially fill and overrun the four partitions. Taps past the end are dropped.
+        for (auto filterLength : {1u, 64u, 200u, 256u, 300u})
+        {
+            const auto filter = RandomSignal(filterLength, filterLength);
+            const auto truncated = std::min(filterLength, 4 * blockLength);
+            const auto expected =
+                DirectConvolution(input, std::vector<float>(filter.begin(), filter.begin() + truncated));
+
+            HrtfDsp::UniformPartitionedConvolver convolver(
+                blockLength, 4, VectorMath::CreateSharedRealFft(2 * blockLength));
+            HrtfDsp::PartitionedFilter partitioned(blockLength, 4);
+            convolver.DesignFilter(filter.data(), filterLength, partitioned);
+
+            AlignedStore::aligned_vector<float> block(blockLength);
+            AlignedStore::aligned_vector<float> output(blockLength);
+            for (auto b = 0u; b < numBlocks; ++b)
+            {
+                std::copy(input.begin() + b * blockLength, input.begin() + (b + 1) * blockLength, block.begin());
+                convolver.Push(block.data());
+                convolver.Convolve(partitioned, output.data());
+                for (auto i = 0u; i < blockLength; ++i)
+                {
+                    ASSERT_NEAR(expected[b * blockLength + i], output[i], 1e-4f) << "filter length " << filterLength;
+                }
+            }
+        }
+    }
+
+    TEST(CConvolverTests, NonUniformPartitionedMatchesDirectForm)
+    {
+        constexpr uint32_t headBlockLength = 32;
+        constexpr uint32_t tailBlockLength = 128;
+        constexpr uint32_t maxFilterLength = 600;
+        constexpr uint32_t numBlocks = 64;
+        const auto input = RandomSignal(headBlockLength * numBlocks, 2);
+
+        // Filters that end in the head, at the head boundary, and several tail blocks in
+        HrtfDsp::NonUniformPartitionedConvolver convolver(
+            headBlockLength, tailBlockLength, maxFilterLength, 2, VectorMath::CreateSharedRealFft(2 * headBlockLength),
+            VectorMath::CreateSharedRealFft(2 * tailBlockLength));
+        for (auto filterLength : {20u, 256u, 600u})
+        {
+            const auto left = RandomSignal(filterLength, filterLength);
+            const auto right = RandomSignal(filterLength / 2 + 1, filterLength + 1);
+            const auto expectedLeft = DirectConvolution(input, left);
+            const auto expectedRight = DirectConvolution(input, right);
+
+            convolver.Reset();
+            convolver.SetFilter(0, left.data(), static_cast<uint32_t>(left.size()), false);
+            convolver.SetFilter(1, right.data(), static_cast<uint32_t>(right.size()), false);
+
+            AlignedStore::aligned_vector<float> block(headBlockLength);
+            AlignedStore::aligned_vector<float> outputLeft(headBlockLength);
+            AlignedStore::aligned_vector<float> outputRight(headBlockLength);
+            float* const outputs[] = {outputLeft.data(), outputRight.data()};
+            for (auto b = 0u; b < numBlocks; ++b)
+            {
+                std::copy(
+                    input.begin() + b * headBlockLength, input.begin() + (b + 1) * headBlockLength, block.begin());
+                convolver.Process(block.data(), outputs);
+                for (auto i = 0u; i < headBlockLength; ++i)
+                {
+                    ASSERT_NEAR(expectedLeft[b * headBlockLength + i], outputLeft[i], 1e-4f)
+                        << "filter length " << filterLength;
+                    ASSERT_NEAR(expectedRight[b * headBlockLength + i], outputRight[i], 1e-4f)
+                        << "filter length " << filterLength;
+                }
+            }
+        }
+    }
+
+    // The tail work of a block is spread over the head blocks of the next one. Filter changes that arrive part way
+    // through must wait for the next tail block, so crossfading to the same filter at any point changes nothing.
+    TEST(CConvolverTests, NonUniformPartitionedCrossfadesBetweenTailSteps)
+    {
+        constexpr uint32_t headBlockLength = 16;
+        constexpr uint32_t tailBlockLength = 64;
+        constexpr uint32_t filterLength = 400;
+        constexpr uint32_t numBlocks = 96;
+        const auto input = RandomSignal(headBlockLength * numBlocks, 3);
+        const auto filter = RandomSignal(filterLength, 4);
+        const auto expected = DirectConvolution(input, filter);
+
+        HrtfDsp::NonUniformPartitionedConvolver convolver(
+            headBlockLength, tailBlockLength, filterLength, 1, VectorMath::CreateSharedRealFft(2 * headBlockLength),
+            VectorMath::CreateSharedRealFft(2 * tailBlockLength));
+        convolver.SetFilter(0, filter.data(), filterLength, false);
+
+        AlignedStore::aligned_vector<float> block(headBlockLength);
+        AlignedStore::aligned_vector<float> output(headBlockLength);
+        float* const outputs[] = {output.data()};
+        for (auto b = 0u; b < numBlocks; ++b)
+        {
+            if (b % 3 == 1)
+            {
+                convolver.SetFilter(0, filter.data(), filterLength, true);
+            }
+            std::copy(input.begin() + b * headBlockLength, input.begin() + (b + 1) * headBlockLength, block.begin());
+            convolver.Process(block.data(), outputs);
+            for (auto i = 0u; i < headBlockLength; ++i)
+            {
+                ASSERT_NEAR(expected[b * headBlockLength + i], output[i], 1e-4f) << "block " << b;
+            }
+        }
+    }
+
+    // Low-latency quanta must render the same signal as the default quantum, just in smaller pieces
+    TEST(CHrtfDspQuantumTests, SmallQuantaMatchDefaultQuantum)
+    {
+        const auto input = RandomSignal(4 * c_TestFrameCount, 3);
+        HrtfAcousticParameters params = {};
+        params.PrimaryArrivalDirection = {0.6f, 0.0f, -0.8f};
+
+        auto render = [&](uint32_t frameCount) {
+            HrtfEngineHandle engine;
+            EXPECT_TRUE(HrtfEngineInitialize(1, HrtfEngineType_FlexBinaural_High_NoReverb, frameCount, &engine));
+            EXPECT_TRUE(HrtfEngineAcquireResourcesForSource(engine.Get(), 0));
+            EXPECT_TRUE(HrtfEngineSetParametersForSource(engine.Get(), 0, &params));
+
+            std::vector<float> rendered(2 * input.size());
+            AlignedStore::aligned_vector<float> block(frameCount);
+            for (auto offset = 0u; offset < input.size(); offset += frameCount)
+            {
+                std::copy(input.begin() + offset, input.begin() + offset + frameCount, block.begin());
+                HrtfInputBuffer buffer = {block.data(), frameCount};
+                EXPECT_EQ(
+                    2 * frameCount,
+                    HrtfEngineProcess(engine.Get(), &buffer, 1, &rendered[2 * offset], 2 * frameCount));
+            }
+            return rendered;
+        };
+
+        const auto reference = render(c_TestFrameCount);
+        for (auto frameCount : {64u, 128u, 256u})
+        {
+            const auto rendered = render(frameCount);
+            for (auto i = 0u; i < reference.size(); ++i)
+            {
+                ASSERT_NEAR(reference[i], rendered[i], 1e-4f) << "quantum " << frameCount;
+            }
+        }
+    }
+} // namespace AudioUnitTests
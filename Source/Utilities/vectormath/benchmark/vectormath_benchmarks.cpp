@@ -0,0 +1,574 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "benchmark/benchmark.h"
+#include "vectormath.h"
+#include "vectormath_generic.h"
+#include "vectormath_sse2.h"
+#include "vectormath_neon.h"
+#include "vectormath_avx2.h"
+#include "vectormath_avx512.h"
+#include "cputype.h"
+#include "AlignedAllocator.h" // AlignedStore
+#include <functional>         // std::function
+#include <random>             // std::mt19937
+#include <string>             // std::string
+
+namespace VectorMathBenchmarks
+{
+    using VectorMath::floatFC;
+
+    // Every Arithmetic function, in the order of vectormath_interfaces.h. Backends leave the functions they do not
+    // implement as nullptr.
+    struct ArithmeticKernels
+    {
+        void (*Add_32f)(float*, float const*, float const*, size_t) = nullptr;
+        void (*Add3_32f)(float*, float const*, float const*, float const*, size_t) = nullptr;
+        void (*Add_32f_I)(float*, float const*, size_t) = nullptr;
+        void (*Add_32fc_I)(floatFC*, floatFC const*, size_t) = nullptr;
+        void (*Add_32fc)(floatFC*, floatFC const*, floatFC const*, size_t) = nullptr;
+        void (*Sub_32f)(float*, float const*, float const*, size_t) = nullptr;
+        void (*Sub_32fc)(floatFC*, floatFC const*, floatFC const*, size_t) = nullptr;
+        void (*Mul_32fc)(floatFC*, floatFC const*, floatFC const*, size_t) = nullptr;
+        void (*Mul_32f)(float*, float const*, float const*, size_t) = nullptr;
+        void (*MulC_32f)(float*, float const*, float, size_t) = nullptr;
+        void (*MulC_32fc)(floatFC*, floatFC const*, float, size_t) = nullptr;
+        void (*AddProduct_32f)(float*, float const*, float const*, size_t) = nullptr;
+        void (*AddProduct_32fc)(floatFC*, floatFC const*, floatFC const*, size_t) = nullptr;
+        void (*AddProductC_32f)(float*, float const*, float, size_t) = nullptr;
+        void (*DotProd_32f)(float*, float const*, float const*, size_t) = nullptr;
+        void (*DotProdC_32f)(float*, float const*, float const*, float const*, float, float, float, size_t) = nullptr;
+        uint32_t (*FindMaxIndex_32f)(float*, size_t) = nullptr;
+        void (*TransformPoints_32f)(
+            float*, float*, float*, float const*, float const*, float const*, float const*, size_t) = nullptr;
+        void (*AmplitudeToDb_32f)(float*, float const*, size_t) = nullptr;
+        void (*DbToAmplitude_32f)(float*, float const*, size_t) = nullptr;
+        void (*VectorToSpherical_32f)(float*, float*, float const*, float const*, float const*, size_t) = nullptr;
+        void (*DownmixStereo_32f)(float*, float const*, size_t, float, size_t) = nullptr;
+        void (*DownmixCrossfade_32f)(float*, float*, float const*, size_t, float, float, size_t) = nullptr;
+        void (*Interpolate_32f)(float*, float const*, float const*, float const*, size_t) = nullptr;
+        void (*InterpolateC_32f)(float*, float const*, float const*, float, size_t) = nullptr;
+    };
+
+    // Source and destination streams of one benchmark. Each stream holds two floats per element, enough for complex
+    // and stereo data. Unaligned runs start every stream one float past the 16 byte boundary.
+    class KernelBuffers final
+    {
+    public:
+        static constexpr size_t c_NumStreams = 3;
+
+        KernelBuffers(size_t length, bool aligned) : m_Offset(aligned ? 0 : 1)
+        {
+            // Multipliers are +-1 so that repeated in-place runs neither overflow nor decay into denormals
+            std::mt19937 generator(5);
+            std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+            for (size_t stream = 0; stream < c_NumStreams; stream++)
+            {
+                m_Sources[stream].resize(2 * length + m_Offset);
+                m_Destinations[stream].resize(2 * length + m_Offset);
+                for (auto& value : m_Sources[stream])
+                {
+                    value = distribution(generator);
+                    if (stream == 1)
+                    {
+                        value = value < 0 ? -1.0f : 1.0f;
+                    }
+                }
+            }
+        }
+
+        float* Src(size_t stream)
+        {
+            return m_Sources[stream].data() + m_Offset;
+        }
+
+        // In-place runs write over the source stream of the same index
+        float* Dst(size_t stream, bool inPlace)
+        {
+            return inPlace ? Src(stream) : m_Destinations[stream].data() + m_Offset;
+        }
+
+        floatFC* SrcC(size_t stream)
+        {
+            return reinterpret_cast<floatFC*>(Src(stream));
+        }
+
+        floatFC* DstC(size_t stream, bool inPlace)
+        {
+            return reinterpret_cast<floatFC*>(Dst(stream, inPlace));
+        }
+
+    private:
+        size_t m_Offset;
+        AlignedStore::aligned_vector<float> m_Sources[c_NumStreams];
+        AlignedStore::aligned_vector<float> m_Destinations[c_NumStreams];
+    };
+
+    using KernelRun = std::function<void(KernelBuffers&, bool inPlace, size_t length)>;
+
+    constexpr int64_t c_MinLength = 16;
+    constexpr int64_t c_MaxLength = 65536;
+    constexpr unsigned int c_MinFftOrder = 64;
+    constexpr unsigned int c_MaxFftOrder = 8192;
+
+    // Registers <backend>/<kernel>/<alignment>[/<in_place|out_of_place>]/<length>. Bytes processed counts every
+    // float read or written, floatsPerElement of them per element.
+    static void RegisterKernel(
+        const std::string& backend, const char* kernel, bool canRunInPlace, int64_t floatsPerElement, KernelRun run)
+    {
+        for (auto aligned : {true, false})
+        {
+            for (auto inPlace : {false, true})
+            {
+                if (inPlace && !canRunInPlace)
+                {
+                    continue;
+                }
+
+                auto name = backend + "/" + kernel + (aligned ? "/aligned" : "/unaligned");
+                if (canRunInPlace)
+                {
+                    name += inPlace ? "/in_place" : "/out_of_place";
+                }
+
+                benchmark::RegisterBenchmark(
+                    name.c_str(),
+                    [=](benchmark::State& state) {
+                        auto length = static_cast<size_t>(state.range(0));
+                        KernelBuffers buffers(length, aligned);
+                        for (auto _ : state)
+                        {
+                            run(buffers, inPlace, length);
+                            benchmark::ClobberMemory();
+                        }
+                        state.SetItemsProcessed(state.iterations() * state.range(0));
+                        auto bytesPerElement = floatsPerElement * static_cast<int64_t>(sizeof(float));
+                        state.SetBytesProcessed(state.iterations() * state.range(0) * bytesPerElement);
+                    })
+                    ->RangeMultiplier(4)
+                    ->Range(c_MinLength, c_MaxLength);
+            }
+        }
+    }
+
+    static void RegisterArithmetic(const std::string& backend, const ArithmeticKernels& k)
+    {
+        // A rotation about z with a translation, so in-place runs stay bounded
+        static const float c_Transform[12] = {0, -1, 0, 0.5f, 1, 0, 0, 0.25f, 0, 0, 1, -0.5f};
+
+        if (k.Add_32f)
+        {
+            RegisterKernel(backend, "Add_32f", true, 3, [f = k.Add_32f](KernelBuffers& b, bool inPlace, size_t n) {
+                f(b.Dst(0, inPlace), b.Src(0), b.Src(1), n);
+            });
+        }
+        if (k.Add3_32f)
+        {
+            RegisterKernel(backend, "Add3_32f", true, 4, [f = k.Add3_32f](KernelBuffers& b, bool inPlace, size_t n) {
+                f(b.Dst(0, inPlace), b.Src(0), b.Src(1), b.Src(2), n);
+            });
+        }
+        if (k.Add_32f_I)
+        {
+            RegisterKernel(backend, "Add_32f_I", false, 3, [f = k.Add_32f_I](KernelBuffers& b, bool, size_t n) {
+                f(b.Src(0), b.Src(1), n);
+            });
+        }
+        if (k.Add_32fc_I)
+        {
+            RegisterKernel(backend, "Add_32fc_I", false, 6, [f = k.Add_32fc_I](KernelBuffers& b, bool, size_t n) {
+                f(b.SrcC(0), b.SrcC(1), n);
+            });
+        }
+        if (k.Add_32fc)
+        {
+            RegisterKernel(backend, "Add_32fc", true, 6, [f = k.Add_32fc](KernelBuffers& b, bool inPlace, size_t n) {
+                f(b.DstC(0, inPlace), b.SrcC(0), b.SrcC(1), n);
+            });
+        }
+        if (k.Sub_32f)
+        {
+            RegisterKernel(backend, "Sub_32f", true, 3, [f = k.Sub_32f](KernelBuffers& b, bool inPlace, size_t n) {
+                f(b.Dst(0, inPlace), b.Src(0), b.Src(1), n);
+            });
+        }
+        if (k.Sub_32fc)
+        {
+            RegisterKernel(backend, "Sub_32fc", true, 6, [f = k.Sub_32fc](KernelBuffers& b, bool inPlace, size_t n) {
+                f(b.DstC(0, inPlace), b.SrcC(0), b.SrcC(1), n);
+            });
+        }
+        if (k.Mul_32fc)
+        {
+            RegisterKernel(backend, "Mul_32fc", false, 6, [f = k.Mul_32fc](KernelBuffers& b, bool, size_t n) {
+                f(b.DstC(0, false), b.SrcC(0), b.SrcC(1), n);
+            });
+        }
+        if (k.Mul_32f)
+        {
+            RegisterKernel(backend, "Mul_32f", true, 3, [f = k.Mul_32f](KernelBuffers& b, bool inPlace, size_t n) {
+                f(b.Dst(0, inPlace), b.Src(0), b.Src(1), n);
+            });
+        }
+        if (k.MulC_32f)
+        {
+            RegisterKernel(backend, "MulC_32f", true, 2, [f = k.MulC_32f](KernelBuffers& b, bool inPlace, size_t n) {
+                f(b.Dst(0, inPlace), b.Src(0), -1.0f, n);
+            });
+        }
+        if (k.MulC_32fc)
+        {
+            RegisterKernel(backend, "MulC_32fc", true, 4, [f = k.MulC_32fc](KernelBuffers& b, bool inPlace, size_t n) {
+                f(b.DstC(0, inPlace), b.SrcC(0), -1.0f, n);
+            });
+        }
+        if (k.AddProduct_32f)
+        {
+            RegisterKernel(
+                backend, "AddProduct_32f", false, 4, [f = k.AddProduct_32f](KernelBuffers& b, bool, size_t n) {
+                    f(b.Src(0), b.Src(1), b.Src(2), n);
+                });
+        }
+        if (k.AddProduct_32fc)
+        {
+            RegisterKernel(
+                backend, "AddProduct_32fc", false, 8, [f = k.AddProduct_32fc](KernelBuffers& b, bool, size_t n) {
+                    f(b.DstC(0, false), b.SrcC(1), b.SrcC(2), n);
+                });
+        }
+        if (k.AddProductC_32f)
+        {
+            RegisterKernel(
+                backend, "AddProductC_32f", false, 3, [f = k.AddProductC_32f](KernelBuffers& b, bool, size_t n) {
+                    f(b.Src(0), b.Src(1), 0.5f, n);
+                });
+        }
+        if (k.DotProd_32f)
+        {
+            RegisterKernel(backend, "DotProd_32f", false, 2, [f = k.DotProd_32f](KernelBuffers& b, bool, size_t n) {
+                float result;
+                f(&result, b.Src(0), b.Src(1), n);
+                benchmark::DoNotOptimize(result);
+            });
+        }
+        if (k.DotProdC_32f)
+        {
+            RegisterKernel(
+                backend, "DotProdC_32f", true, 4, [f = k.DotProdC_32f](KernelBuffers& b, bool inPlace, size_t n) {
+                    f(b.Dst(0, inPlace), b.Src(0), b.Src(1), b.Src(2), 0.25f, 0.5f, 0.25f, n);
+                });
+        }
+        if (k.FindMaxIndex_32f)
+        {
+            RegisterKernel(
+                backend, "FindMaxIndex_32f", false, 1, [f = k.FindMaxIndex_32f](KernelBuffers& b, bool, size_t n) {
+                    benchmark::DoNotOptimize(f(b.Src(0), n));
+                });
+        }
+        if (k.TransformPoints_32f)
+        {
+            RegisterKernel(
+                backend, "TransformPoints_32f", true, 6,
+                [f = k.TransformPoints_32f](KernelBuffers& b, bool inPlace, size_t n) {
+                    f(b.Dst(0, inPlace), b.Dst(1, inPlace), b.Dst(2, inPlace), b.Src(0), b.Src(1), b.Src(2),
+                      c_Transform, n);
+                });
+        }
+        if (k.AmplitudeToDb_32f)
+        {
+            RegisterKernel(
+                backend, "AmplitudeToDb_32f", true, 2,
+                [f = k.AmplitudeToDb_32f](KernelBuffers& b, bool inPlace, size_t n) {
+                    f(b.Dst(0, inPlace), b.Src(0), n);
+                });
+        }
+        if (k.DbToAmplitude_32f)
+        {
+            RegisterKernel(
+                backend, "DbToAmplitude_32f", true, 2,
+                [f = k.DbToAmplitude_32f](KernelBuffers& b, bool inPlace, size_t n) {
+                    f(b.Dst(0, inPlace), b.Src(0), n);
+                });
+        }
+        if (k.VectorToSpherical_32f)
+        {
+            RegisterKernel(
+                backend, "VectorToSpherical_32f", false, 5,
+                [f = k.VectorToSpherical_32f](KernelBuffers& b, bool, size_t n) {
+                    f(b.Dst(0, false), b.Dst(1, false), b.Src(0), b.Src(1), b.Src(2), n);
+                });
+        }
+        if (k.DownmixStereo_32f)
+        {
+            RegisterKernel(
+                backend, "DownmixStereo_32f", false, 3, [f = k.DownmixStereo_32f](KernelBuffers& b, bool, size_t n) {
+                    f(b.Dst(0, false), b.Src(0), 2, 0.5f, n);
+                });
+        }
+        if (k.DownmixCrossfade_32f)
+        {
+            // A constant blend of 0 so the in-place passthrough is not faded towards denormals
+            RegisterKernel(
+                backend, "DownmixCrossfade_32f", true, 5,
+                [f = k.DownmixCrossfade_32f](KernelBuffers& b, bool inPlace, size_t n) {
+                    f(b.Dst(1, false), b.Dst(0, inPlace), b.Src(0), 2, 0.0f, 0.0f, n);
+                });
+        }
+        if (k.Interpolate_32f)
+        {
+            RegisterKernel(
+                backend, "Interpolate_32f", false, 4, [f = k.Interpolate_32f](KernelBuffers& b, bool, size_t n) {
+                    f(b.Dst(0, false), b.Src(0), b.Src(1), b.Src(2), n);
+                });
+        }
+        if (k.InterpolateC_32f)
+        {
+            RegisterKernel(
+                backend, "InterpolateC_32f", false, 3, [f = k.InterpolateC_32f](KernelBuffers& b, bool, size_t n) {
+                    f(b.Dst(0, false), b.Src(0), b.Src(1), 0.3f, n);
+                });
+        }
+    }
+
+    // Registers <backend>/<Forward|Inverse>/<order> for every power of two order in range
+    template <typename Fft>
+    static void RegisterRealFft(const std::string& backend)
+    {
+        for (auto inverse : {false, true})
+        {
+            auto name = "RealFft_" + backend + (inverse ? "/Inverse" : "/Forward");
+            benchmark::RegisterBenchmark(
+                name.c_str(),
+                [=](benchmark::State& state) {
+                    auto order = static_cast<unsigned int>(state.range(0));
+                    Fft fft(order);
+                    auto freqLength = fft.GetFreqDomainBufferLength();
+                    AlignedStore::aligned_vector<float> time(order);
+                    AlignedStore::aligned_vector<floatFC> freq(freqLength);
+                    std::mt19937 generator(3);
+                    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+                    for (auto& sample : time)
+                    {
+                        sample = distribution(generator);
+                    }
+                    fft.ForwardFft(time.data(), order, freq.data(), freqLength);
+
+                    for (auto _ : state)
+                    {
+                        if (inverse)
+                        {
+                            fft.InverseFft(freq.data(), freqLength, time.data(), order);
+                        }
+                        else
+                        {
+                            fft.ForwardFft(time.data(), order, freq.data(), freqLength);
+                        }
+                        benchmark::ClobberMemory();
+                    }
+                    state.SetItemsProcessed(state.iterations() * state.range(0));
+                })
+                ->RangeMultiplier(2)
+                ->Range(c_MinFftOrder, c_MaxFftOrder);
+        }
+    }
+
+    static const char* GetIsaName(VectorMath::ArithmeticIsa isa)
+    {
+        switch (isa)
+        {
+        case VectorMath::ArithmeticIsa::Neon:
+            return "Neon";
+        case VectorMath::ArithmeticIsa::Sse2:
+            return "Sse2";
+        case VectorMath::ArithmeticIsa::Avx2:
+            return "Avx2";
+        case VectorMath::ArithmeticIsa::Avx512:
+            return "Avx512";
+        default:
+            return "Generic";
+        }
+    }
+
+    static void RegisterBenchmarks()
+    {
+        using namespace VectorMath;
+
+        // The public functions, with whatever kernels the dispatcher picked for this CPU. The interpolation
+        // functions are declared but not dispatched, only the backends implement them.
+        {
+            using namespace VectorMath::Arithmetic;
+            RegisterArithmetic(
+                "Dispatched",
+                {Add_32f,
+                 Add_32f,
+                 Add_32f_I,
+                 Add_32fc_I,
+                 Add_32fc,
+                 Sub_32f,
+                 Sub_32fc,
+                 Mul_32fc,
+                 Mul_32f,
+                 MulC_32f,
+                 MulC_32fc,
+                 AddProduct_32f,
+                 AddProduct_32fc,
+                 AddProductC_32f,
+                 DotProd_32f,
+                 DotProdC_32f,
+                 FindMaxIndex_32f,
+                 TransformPoints_32f,
+                 AmplitudeToDb_32f,
+                 DbToAmplitude_32f,
+                 VectorToSpherical_32f,
+                 DownmixStereo_32f,
+                 DownmixCrossfade_32f});
+        }
+
+        {
+            using namespace VectorMath::Arithmetic_Generic;
+            RegisterArithmetic(
+                "Generic",
+                {Add_32f,
+                 Add_32f,
+                 Add_32f_I,
+                 nullptr,
+                 Add_32fc,
+                 Sub_32f,
+                 Sub_32fc,
+                 Mul_32fc,
+                 Mul_32f,
+                 MulC_32f,
+                 nullptr,
+                 AddProduct_32f,
+                 AddProduct_32fc,
+                 AddProductC_32f,
+                 DotProd_32f,
+                 DotProdC_32f,
+                 FindMaxIndex_32f,
+                 TransformPoints_32f,
+                 AmplitudeToDb_32f,
+                 DbToAmplitude_32f,
+                 VectorToSpherical_32f,
+                 DownmixStereo_32f,
+                 DownmixCrossfade_32f,
+                 Interpolate_32f,
+                 InterpolateC_32f});
+        }
+        RegisterRealFft<RealFft_generic>("Generic");
+
+#if defined(ARCH_X86) || defined(ARCH_X64)
+        {
+            using namespace VectorMath::Arithmetic_Sse2;
+            RegisterArithmetic(
+                "Sse2",
+                {Add_32f,
+                 Add_32f,
+                 Add_32f_I,
+                 nullptr,
+                 Add_32fc,
+                 Sub_32f,
+                 Sub_32fc,
+                 Mul_32fc,
+                 Mul_32f,
+                 MulC_32f,
+                 nullptr,
+                 AddProduct_32f,
+                 AddProduct_32fc,
+                 AddProductC_32f,
+                 DotProd_32f,
+                 DotProdC_32f,
+                 FindMaxIndex_32f,
+                 TransformPoints_32f,
+                 AmplitudeToDb_32f,
+                 DbToAmplitude_32f,
+                 VectorToSpherical_32f,
+                 DownmixStereo_32f,
+                 DownmixCrossfade_32f,
+                 Interpolate_32f});
+        }
+        RegisterRealFft<RealFft_Sse2>("Sse2");
+
+        // The AVX kernels are only registered when the CPU can run them
+        auto isa = GetArithmeticIsa();
+        if (isa == ArithmeticIsa::Avx2 || isa == ArithmeticIsa::Avx512)
+        {
+            using namespace VectorMath::Arithmetic_Avx2;
+            ArithmeticKernels kernels;
+            kernels.Add_32f = Add_32f;
+            kernels.Add_32f_I = Add_32f_I;
+            kernels.Sub_32f = Sub_32f;
+            kernels.Mul_32f = Mul_32f;
+            kernels.Mul_32fc = Mul_32fc;
+            kernels.MulC_32f = MulC_32f;
+            kernels.AddProduct_32f = AddProduct_32f;
+            kernels.AddProduct_32fc = AddProduct_32fc;
+            kernels.AddProductC_32f = AddProductC_32f;
+            kernels.DotProd_32f = DotProd_32f;
+            RegisterArithmetic("Avx2", kernels);
+        }
+        if (isa == ArithmeticIsa::Avx512)
+        {
+            using namespace VectorMath::Arithmetic_Avx512;
+            ArithmeticKernels kernels;
+            kernels.Add_32f = Add_32f;
+            kernels.Add_32f_I = Add_32f_I;
+            kernels.Sub_32f = Sub_32f;
+            kernels.Mul_32f = Mul_32f;
+            kernels.Mul_32fc = Mul_32fc;
+            kernels.MulC_32f = MulC_32f;
+            kernels.AddProduct_32f = AddProduct_32f;
+            kernels.AddProduct_32fc = AddProduct_32fc;
+            kernels.AddProductC_32f = AddProductC_32f;
+            kernels.DotProd_32f = DotProd_32f;
+            RegisterArithmetic("Avx512", kernels);
+        }
+#elif defined(ARCH_ARM) || defined(ARCH_ARM64)
+        {
+            using namespace VectorMath::Arithmetic_Neon;
+            RegisterArithmetic(
+                "Neon",
+                {Add_32f,
+                 Add_32f,
+                 Add_32f_I,
+                 nullptr,
+                 Add_32fc,
+                 Sub_32f,
+                 Sub_32fc,
+                 Mul_32fc,
+                 Mul_32f,
+                 MulC_32f,
+                 nullptr,
+                 AddProduct_32f,
+                 AddProduct_32fc,
+                 AddProductC_32f,
+                 DotProd_32f,
+                 DotProdC_32f,
+                 FindMaxIndex_32f,
+                 TransformPoints_32f,
+                 AmplitudeToDb_32f,
+                 DbToAmplitude_32f,
+                 VectorToSpherical_32f,
+                 DownmixStereo_32f,
+                 DownmixCrossfade_32f,
+                 Interpolate_32f});
+        }
+        RegisterRealFft<RealFft_Neon>("Neon");
+#endif
+
+        // Recorded in the JSON context, so results from different machines can be told apart
+        benchmark::AddCustomContext("arithmetic_isa", GetIsaName(GetArithmeticIsa()));
+    }
+} // namespace VectorMathBenchmarks
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    VectorMathBenchmarks::RegisterBenchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
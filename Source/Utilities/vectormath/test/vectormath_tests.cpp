@@ -4,6 +4,8 @@
 #include "gtest.h"
 #include "vectormath.h"
 #include "vectormath_generic.h"
+#include "vectormath_avx2.h"
+#include "vectormath_avx512.h"
 #include "vectormath_test_data.h"
 #include "cputype.h"
 #include "AlignedAllocator.h"  // AlignedStore
@@ -11,6 +13,9 @@
 #include <memory>              // std::unique_ptr
 #include <fstream>             // wofstream
 #include <thread>              // threads
+#include <random>              // std::mt19937
+#include <cmath>               // std::abs
+#include <vector>              // std::vector
 
 // When debugging, uncomment the following line to save results to a file
 // #define SAVE_FILTER_OUTPUT
@@ -112,4 +117,416 @@ namespace AudioUnitTests
             100.0f * static_cast<float>(numMismatchedSamples) / static_cast<float>(frameLength * numFrames);
         EXPECT_TRUE(percentMismatched < 0.5);
     }
+
+    TEST_F(CVectorMathTests, RealFftMatchesReference)
+    {
+        unsigned int numFrames = VectorMathMatlabReference::numTestFrames;
+        unsigned int frameLength = VectorMathMatlabReference::order;
+        unsigned int freqLength = VectorMathMatlabReference::freqDomainLength;
+        unsigned int numMismatchedSamples = 0;
+        AlignedStore::aligned_vector<float> roundTrip(frameLength);
+
+        auto fft = VectorMath::CreateRealFft(frameLength);
+        ASSERT_EQ(freqLength, fft->GetFreqDomainBufferLength());
+
+        for (unsigned int i = 0; i < numFrames; i++)
+        {
+            memcpy(
+                m_TimeDomainAlignedBuffer.data(),
+                &VectorMathMatlabReference::timeDomainReference[i * frameLength],
+                frameLength * sizeof(float));
+            fft->ForwardFft(
+                m_TimeDomainAlignedBuffer.data(), frameLength, m_FreqDomainAlignedBuffer.data(), freqLength);
+
+            auto reference = &VectorMathMatlabReference::freqDomainReference[i * 2 * freqLength];
+            for (unsigned int j = 0; j < freqLength; j++)
+            {
+                if (AreFloatsTooFarApart(m_FreqDomainAlignedBuffer[j].re, reference[2 * j], 10E-4f) ||
+                    AreFloatsTooFarApart(m_FreqDomainAlignedBuffer[j].im, reference[2 * j + 1], 10E-4f))
+                {
+                    numMismatchedSamples++;
+                }
+            }
+
+            // Inverse transform restores the input
+            fft->InverseFft(m_FreqDomainAlignedBuffer.data(), freqLength, roundTrip.data(), frameLength);
+            for (unsigned int j = 0; j < frameLength; j++)
+            {
+                ASSERT_NEAR(m_TimeDomainAlignedBuffer[j], roundTrip[j], 10E-6f);
+            }
+        }
+        auto percentMismatched =
+            100.0f * static_cast<float>(numMismatchedSamples) / static_cast<float>(freqLength * numFrames);
+        EXPECT_TRUE(percentMismatched < 0.5);
+    }
+
+    // The platform FFT must agree with the generic implementation for every supported order
+    TEST_F(CVectorMathTests, RealFftMatchesGeneric)
+    {
+        std::mt19937 generator(7);
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+        for (unsigned int order = 2; order <= 8192; order *= 2)
+        {
+            auto freqLength = order / 2 + 1;
+            AlignedStore::aligned_vector<float> input(order);
+            AlignedStore::aligned_vector<float> roundTrip(order);
+            AlignedStore::aligned_vector<VectorMath::floatFC> expected(freqLength);
+            AlignedStore::aligned_vector<VectorMath::floatFC> actual(freqLength);
+            for (auto& sample : input)
+            {
+                sample = distribution(generator);
+            }
+
+            VectorMath::RealFft_generic generic(order);
+            auto fft = VectorMath::CreateRealFft(order);
+            generic.ForwardFft(input.data(), order, expected.data(), freqLength);
+            fft->ForwardFft(input.data(), order, actual.data(), freqLength);
+
+            // Rounding error grows with the transform size, compare against the spectrum's scale
+            auto tolerance = 10E-6f * order;
+            for (unsigned int k = 0; k < freqLength; k++)
+            {
+                ASSERT_NEAR(expected[k].re, actual[k].re, tolerance) << "order " << order << " bin " << k;
+                ASSERT_NEAR(expected[k].im, actual[k].im, tolerance) << "order " << order << " bin " << k;
+            }
+
+            fft->InverseFft(actual.data(), freqLength, roundTrip.data(), order);
+            for (unsigned int n = 0; n < order; n++)
+            {
+                ASSERT_NEAR(input[n], roundTrip[n], 10E-5f) << "order " << order << " sample " << n;
+            }
+        }
+    }
+
+    // Batched points must match a per-point transform, including the tail and when transformed in place
+    TEST(CVectorMathArithmeticTests, TransformPointsMatchesScalar)
+    {
+        std::mt19937 generator(5);
+        std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+        float matrix[12];
+        for (auto& coefficient : matrix)
+        {
+            coefficient = distribution(generator);
+        }
+
+        for (size_t length : {1u, 3u, 4u, 5u, 16u, 37u})
+        {
+            std::vector<float> x(length), y(length), z(length);
+            for (auto i = 0u; i < length; i++)
+            {
+                x[i] = distribution(generator);
+                y[i] = distribution(generator);
+                z[i] = distribution(generator);
+            }
+            std::vector<float> outX(length), outY(length), outZ(length);
+            VectorMath::Arithmetic::TransformPoints_32f(
+                outX.data(), outY.data(), outZ.data(), x.data(), y.data(), z.data(), matrix, length);
+
+            for (auto i = 0u; i < length; i++)
+            {
+                const float* const outputs[] = {outX.data(), outY.data(), outZ.data()};
+                for (auto row = 0; row < 3; row++)
+                {
+                    const auto m = matrix + 4 * row;
+                    const auto expected = static_cast<double>(m[0]) * x[i] + static_cast<double>(m[1]) * y[i] +
+                                          static_cast<double>(m[2]) * z[i] + m[3];
+                    ASSERT_NEAR(expected, outputs[row][i], 1E-3) << "length " << length << " point " << i;
+                }
+            }
+
+            VectorMath::Arithmetic::TransformPoints_32f(
+                x.data(), y.data(), z.data(), x.data(), y.data(), z.data(), matrix, length);
+            for (auto i = 0u; i < length; i++)
+            {
+                ASSERT_EQ(outX[i], x[i]);
+                ASSERT_EQ(outY[i], y[i]);
+                ASSERT_EQ(outZ[i], z[i]);
+            }
+        }
+    }
+
+    // The SIMD approximations must stay within their documented error of libm, including the tails
+    TEST(CVectorMathArithmeticTests, AmplitudeToDbMatchesLibm)
+    {
+        std::mt19937 generator(7);
+        std::uniform_real_distribution<float> exponent(-37.0f, 6.0f);
+        std::vector<float> amplitudes(1027);
+        for (auto& amplitude : amplitudes)
+        {
+            amplitude = std::pow(10.0f, exponent(generator));
+        }
+        amplitudes[0] = 1.0f;
+        amplitudes[1] = 0.0f;
+        amplitudes[2] = -1.0f;
+
+        std::vector<float> dB(amplitudes.size());
+        VectorMath::Arithmetic::AmplitudeToDb_32f(dB.data(), amplitudes.data(), amplitudes.size());
+        for (auto i = 0u; i < amplitudes.size(); i++)
+        {
+            const auto amplitude = std::max(amplitudes[i], VectorMath::Arithmetic_Generic::c_MinAmplitude);
+            const auto expected = 20.0 * std::log10(static_cast<double>(amplitude));
+            ASSERT_NEAR(expected, dB[i], 1E-4) << "amplitude " << amplitudes[i];
+        }
+    }
+
+    TEST(CVectorMathArithmeticTests, DbToAmplitudeMatchesLibm)
+    {
+        std::mt19937 generator(11);
+        std::uniform_real_distribution<float> distribution(-740.0f, 740.0f);
+        std::vector<float> dB(1027);
+        for (auto& value : dB)
+        {
+            value = distribution(generator);
+        }
+        dB[0] = 0.0f;
+        dB[1] = -6.0f;
+        dB[2] = -2000.0f;
+        dB[3] = 2000.0f;
+
+        std::vector<float> amplitudes(dB.size());
+        VectorMath::Arithmetic::DbToAmplitude_32f(amplitudes.data(), dB.data(), dB.size());
+        for (auto i = 0u; i < dB.size(); i++)
+        {
+            const auto clamped = std::min(
+                std::max(dB[i], VectorMath::Arithmetic_Generic::c_MinAmplitudeDb),
+                VectorMath::Arithmetic_Generic::c_MaxAmplitudeDb);
+            const auto expected = std::pow(10.0, clamped / 20.0);
+            ASSERT_TRUE(std::isfinite(amplitudes[i])) << "dB " << dB[i];
+            ASSERT_NEAR(1.0, amplitudes[i] / expected, 1E-5) << "dB " << dB[i];
+        }
+    }
+
+    TEST(CVectorMathArithmeticTests, VectorToSphericalMatchesLibm)
+    {
+        std::mt19937 generator(13);
+        std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+        std::vector<float> x(1027), y(1027), z(1027);
+        for (auto i = 0u; i < x.size(); i++)
+        {
+            x[i] = distribution(generator);
+            y[i] = distribution(generator);
+            z[i] = distribution(generator);
+        }
+        // Axes, both sides of the azimuth wrap, and vectors too short for a direction
+        const float special[][3] = {{0, 0, -1}, {0, 0, 1},     {1, 0, 0},     {-1, 0, 0}, {0, 1, 0},
+                                    {0, -1, 0}, {1e-6f, 0, -1}, {-1e-6f, 0, -1}, {0, 0, 0},  {1e-5f, 1e-5f, 0}};
+        for (auto i = 0u; i < sizeof(special) / sizeof(special[0]); i++)
+        {
+            x[i] = special[i][0];
+            y[i] = special[i][1];
+            z[i] = special[i][2];
+        }
+
+        constexpr double radianToDeg = 57.295779513082321;
+        std::vector<float> azimuth(x.size()), elevation(x.size());
+        VectorMath::Arithmetic::VectorToSpherical_32f(
+            azimuth.data(), elevation.data(), x.data(), y.data(), z.data(), x.size());
+        for (auto i = 0u; i < x.size(); i++)
+        {
+            const double xi = x[i], yi = y[i], zi = z[i];
+            const auto horizontalLength = std::sqrt(xi * xi + zi * zi);
+            const auto expectedAzimuth = horizontalLength > 1e-4 ? std::atan2(-xi, -zi) * radianToDeg : 0.0;
+            const auto expectedElevation =
+                (horizontalLength + std::abs(yi)) > 1e-4 ? std::atan2(yi, horizontalLength) * radianToDeg : 0.0;
+
+            ASSERT_GE(azimuth[i], 0.0f);
+            ASSERT_LT(azimuth[i], 360.0f);
+            const auto azimuthError = std::fmod(std::abs(expectedAzimuth - azimuth[i]), 360.0);
+            ASSERT_NEAR(0.0, std::min(azimuthError, 360.0 - azimuthError), 1E-3) << "point " << i;
+            ASSERT_NEAR(expectedElevation, elevation[i], 1E-3) << "point " << i;
+        }
+    }
+
+    // Every channel count, with and without a fast path, must match the scalar downmix including the tail
+    TEST(CVectorMathArithmeticTests, DownmixStereoMatchesScalar)
+    {
+        std::mt19937 generator(17);
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+        for (size_t numChannels = 2; numChannels <= 8; numChannels++)
+        {
+            for (size_t length : {1u, 3u, 4u, 7u, 64u, 67u})
+            {
+                std::vector<float> input(length * numChannels);
+                for (auto& sample : input)
+                {
+                    sample = distribution(generator);
+                }
+
+                std::vector<float> output(length);
+                VectorMath::Arithmetic::DownmixStereo_32f(output.data(), input.data(), numChannels, 0.35f, length);
+                for (auto i = 0u; i < length; i++)
+                {
+                    const auto expected = (input[i * numChannels] + input[i * numChannels + 1]) * 0.35f;
+                    ASSERT_FLOAT_EQ(expected, output[i]) << numChannels << " channels, frame " << i;
+                }
+            }
+        }
+    }
+
+    // The blend must ramp across the block without a step at the tail, also when the passthrough is written in place
+    TEST(CVectorMathArithmeticTests, DownmixCrossfadeMatchesScalar)
+    {
+        std::mt19937 generator(19);
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+        for (size_t numChannels = 2; numChannels <= 8; numChannels++)
+        {
+            for (size_t length : {1u, 3u, 4u, 7u, 64u, 67u})
+            {
+                std::vector<float> input(length * numChannels);
+                for (auto& sample : input)
+                {
+                    sample = distribution(generator);
+                }
+                const auto startBlend = 0.2f;
+                const auto blendStep = (0.9f - startBlend) / length;
+
+                std::vector<float> downmix(length), passthrough(length * numChannels);
+                VectorMath::Arithmetic::DownmixCrossfade_32f(
+                    downmix.data(), passthrough.data(), input.data(), numChannels, startBlend, blendStep, length);
+
+                for (auto i = 0u; i < length; i++)
+                {
+                    const auto blend = startBlend + static_cast<double>(blendStep) * (i + 1);
+                    const auto frame = &input[i * numChannels];
+                    ASSERT_NEAR((frame[0] + frame[1]) * 0.5 * blend, downmix[i], 1E-6)
+                        << numChannels << " channels, frame " << i;
+                    for (auto channel = 0u; channel < numChannels; channel++)
+                    {
+                        ASSERT_NEAR(frame[channel] * (1.0 - blend), passthrough[i * numChannels + channel], 1E-6)
+                            << numChannels << " channels, frame " << i;
+                    }
+                }
+
+                VectorMath::Arithmetic::DownmixCrossfade_32f(
+                    downmix.data(), input.data(), input.data(), numChannels, startBlend, blendStep, length);
+                for (auto i = 0u; i < input.size(); i++)
+                {
+                    ASSERT_EQ(passthrough[i], input[i]);
+                }
+            }
+        }
+    }
+
+#if defined(ARCH_X86) || defined(ARCH_X64)
+    // Kernels the runtime dispatcher can select in place of SSE2
+    struct DispatchedKernels
+    {
+        void (*Add_32f)(float*, float const*, float const*, size_t);
+        void (*Sub_32f)(float*, float const*, float const*, size_t);
+        void (*Mul_32f)(float*, float const*, float const*, size_t);
+        void (*Mul_32fc)(VectorMath::floatFC*, VectorMath::floatFC const*, VectorMath::floatFC const*, size_t);
+        void (*MulC_32f)(float*, float const*, float, size_t);
+        void (*AddProduct_32f)(float*, float const*, float const*, size_t);
+        void (*AddProduct_32fc)(VectorMath::floatFC*, VectorMath::floatFC const*, VectorMath::floatFC const*, size_t);
+        void (*AddProductC_32f)(float*, float const*, float, size_t);
+        void (*DotProd_32f)(float*, float const*, float const*, size_t);
+    };
+
+    // Compares the kernels against the generic implementation for odd lengths and unaligned buffers
+    static void ExpectKernelsMatchGeneric(const DispatchedKernels& kernels)
+    {
+        using namespace VectorMath;
+        std::mt19937 generator(11);
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+        constexpr size_t maxLength = 1031;
+        constexpr size_t maxOffset = 3;
+
+        AlignedStore::aligned_vector<float> src1(2 * (maxLength + maxOffset));
+        AlignedStore::aligned_vector<float> src2(2 * (maxLength + maxOffset));
+        AlignedStore::aligned_vector<float> dst(2 * (maxLength + maxOffset));
+        for (auto i = 0u; i < src1.size(); i++)
+        {
+            src1[i] = distribution(generator);
+            src2[i] = distribution(generator);
+            dst[i] = distribution(generator);
+        }
+        AlignedStore::aligned_vector<float> expected(dst.size());
+        AlignedStore::aligned_vector<float> actual(dst.size());
+
+        for (size_t length : {1u, 3u, 7u, 8u, 15u, 16u, 17u, 31u, 33u, 64u, 100u, 1031u})
+        {
+            for (size_t offset = 0; offset <= maxOffset; offset++)
+            {
+                auto a = src1.data() + offset;
+                auto b = src2.data() + offset;
+                auto ac = reinterpret_cast<const floatFC*>(a);
+                auto bc = reinterpret_cast<const floatFC*>(b);
+                auto check = [&](const char* name, size_t count) {
+                    for (auto i = 0u; i < count; i++)
+                    {
+                        ASSERT_NEAR(expected[offset + i], actual[offset + i], 1E-5f)
+                            << name << " length " << length << " offset " << offset << " index " << i;
+                    }
+                };
+                auto run = [&](auto generic, auto optimized) {
+                    expected = dst;
+                    actual = dst;
+                    generic(expected.data() + offset);
+                    optimized(actual.data() + offset);
+                };
+
+                run([&](float* out) { Arithmetic_Generic::Add_32f(out, a, b, length); },
+                    [&](float* out) { kernels.Add_32f(out, a, b, length); });
+                check("Add_32f", length);
+                run([&](float* out) { Arithmetic_Generic::Sub_32f(out, a, b, length); },
+                    [&](float* out) { kernels.Sub_32f(out, a, b, length); });
+                check("Sub_32f", length);
+                run([&](float* out) { Arithmetic_Generic::Mul_32f(out, a, b, length); },
+                    [&](float* out) { kernels.Mul_32f(out, a, b, length); });
+                check("Mul_32f", length);
+                run([&](float* out) { Arithmetic_Generic::MulC_32f(out, a, 0.7f, length); },
+                    [&](float* out) { kernels.MulC_32f(out, a, 0.7f, length); });
+                check("MulC_32f", length);
+                run([&](float* out) { Arithmetic_Generic::AddProduct_32f(out, a, b, length); },
+                    [&](float* out) { kernels.AddProduct_32f(out, a, b, length); });
+                check("AddProduct_32f", length);
+                run([&](float* out) { Arithmetic_Generic::AddProductC_32f(out, a, -0.3f, length); },
+                    [&](float* out) { kernels.AddProductC_32f(out, a, -0.3f, length); });
+                check("AddProductC_32f", length);
+                run([&](float* out) { Arithmetic_Generic::Mul_32fc(reinterpret_cast<floatFC*>(out), ac, bc, length); },
+                    [&](float* out) { kernels.Mul_32fc(reinterpret_cast<floatFC*>(out), ac, bc, length); });
+                check("Mul_32fc", 2 * length);
+                run([&](float* out) {
+                        Arithmetic_Generic::AddProduct_32fc(reinterpret_cast<floatFC*>(out), ac, bc, length);
+                    },
+                    [&](float* out) { kernels.AddProduct_32fc(reinterpret_cast<floatFC*>(out), ac, bc, length); });
+                check("AddProduct_32fc", 2 * length);
+
+                float expectedDot = 0;
+                float actualDot = 0;
+                Arithmetic_Generic::DotProd_32f(&expectedDot, a, b, length);
+                kernels.DotProd_32f(&actualDot, a, b, length);
+                ASSERT_NEAR(expectedDot, actualDot, 1E-6f * length) << "DotProd_32f length " << length;
+            }
+        }
+    }
+
+    TEST(CVectorMathDispatchTests, Avx2KernelsMatchGeneric)
+    {
+        auto isa = VectorMath::GetArithmeticIsa();
+        if (isa != VectorMath::ArithmeticIsa::Avx2 && isa != VectorMath::ArithmeticIsa::Avx512)
+        {
+            GTEST_SKIP() << "CPU does not support AVX2 and FMA";
+        }
+
+        using namespace VectorMath::Arithmetic_Avx2;
+        ExpectKernelsMatchGeneric(
+            {Add_32f, Sub_32f, Mul_32f, Mul_32fc, MulC_32f, AddProduct_32f, AddProduct_32fc, AddProductC_32f,
+             DotProd_32f});
+    }
+
+    TEST(CVectorMathDispatchTests, Avx512KernelsMatchGeneric)
+    {
+        if (VectorMath::GetArithmeticIsa() != VectorMath::ArithmeticIsa::Avx512)
+        {
+            GTEST_SKIP() << "CPU does not support AVX-512";
+        }
+
+        using namespace VectorMath::Arithmetic_Avx512;
+        ExpectKernelsMatchGeneric(
+            {Add_32f, Sub_32f, Mul_32f, Mul_32fc, MulC_32f, AddProduct_32f, AddProduct_32fc, AddProductC_32f,
+             DotProd_32f});
+    }
+#endif
 }; // namespace AudioUnitTests
@@ -0,0 +1,186 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#include "cputype.h"
+#if defined(ARCH_X86) || defined(ARCH_X64)
+#include "vectormath_avx2.h"
+#include <immintrin.h>
+
+// This file is compiled with AVX2 and FMA enabled. Keep it free of inline functions shared with other
+// translation units, the linker could otherwise pick an AVX2 copy for callers on older CPUs.
+namespace VectorMath
+{
+    namespace Arithmetic_Avx2
+    {
+        static inline float HorizontalSum(__m256 value)
+        {
+            auto sum = _mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1));
+            sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+            sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+            return _mm_cvtss_f32(sum);
+        }
+
+        // Four interleaved complex products (re, im, re, im, ...)
+        static inline __m256 ComplexMultiply(__m256 a, __m256 b)
+        {
+            auto bRe = _mm256_moveldup_ps(b);
+            auto bIm = _mm256_movehdup_ps(b);
+            auto aSwapped = _mm256_permute_ps(a, 0xB1);
+            return _mm256_fmaddsub_ps(a, bRe, _mm256_mul_ps(aSwapped, bIm));
+        }
+
+        void Add_32f(float* pDst, const float* pSrc1, const float* pSrc2, size_t const length)
+        {
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8)
+            {
+                _mm256_storeu_ps(pDst + i, _mm256_add_ps(_mm256_loadu_ps(pSrc1 + i), _mm256_loadu_ps(pSrc2 + i)));
+            }
+            for (; i < length; i += 1)
+            {
+                pDst[i] = pSrc1[i] + pSrc2[i];
+            }
+        }
+
+        void Add_32f_I(float* pSrcDst, const float* pSrc, size_t const length)
+        {
+            Add_32f(pSrcDst, pSrcDst, pSrc, length);
+        }
+
+        void Sub_32f(float* pDst, const float* pSrc1, const float* pSrc2, size_t const length)
+        {
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8)
+            {
+                _mm256_storeu_ps(pDst + i, _mm256_sub_ps(_mm256_loadu_ps(pSrc1 + i), _mm256_loadu_ps(pSrc2 + i)));
+            }
+            for (; i < length; i += 1)
+            {
+                pDst[i] = pSrc1[i] - pSrc2[i];
+            }
+        }
+
+        void Mul_32f(float* pDst, const float* pSrc1, const float* pSrc2, size_t const length)
+        {
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8)
+            {
+                _mm256_storeu_ps(pDst + i, _mm256_mul_ps(_mm256_loadu_ps(pSrc1 + i), _mm256_loadu_ps(pSrc2 + i)));
+            }
+            for (; i < length; i += 1)
+            {
+                pDst[i] = pSrc1[i] * pSrc2[i];
+            }
+        }
+
+        void Mul_32fc(floatFC* pDst, const floatFC* pSrc1, const floatFC* pSrc2, size_t const length)
+        {
+            auto dst = reinterpret_cast<float*>(pDst);
+            auto src1 = reinterpret_cast<const float*>(pSrc1);
+            auto src2 = reinterpret_cast<const float*>(pSrc2);
+            size_t i = 0;
+            for (; i + 4 <= length; i += 4)
+            {
+                auto product = ComplexMultiply(_mm256_loadu_ps(src1 + 2 * i), _mm256_loadu_ps(src2 + 2 * i));
+                _mm256_storeu_ps(dst + 2 * i, product);
+            }
+            for (; i < length; i += 1)
+            {
+                auto re = pSrc1[i].re * pSrc2[i].re - pSrc1[i].im * pSrc2[i].im;
+                auto im = pSrc1[i].re * pSrc2[i].im + pSrc1[i].im * pSrc2[i].re;
+                pDst[i].re = re;
+                pDst[i].im = im;
+            }
+        }
+
+        void MulC_32f(float* pDst, const float* pSrc, float const value, size_t const length)
+        {
+            auto scale = _mm256_set1_ps(value);
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8)
+            {
+                _mm256_storeu_ps(pDst + i, _mm256_mul_ps(_mm256_loadu_ps(pSrc + i), scale));
+            }
+            for (; i < length; i += 1)
+            {
+                pDst[i] = pSrc[i] * value;
+            }
+        }
+
+        void AddProduct_32f(float* pSrcDst, const float* pSrc1, const float* pSrc2, size_t const length)
+        {
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8)
+            {
+                auto sum = _mm256_fmadd_ps(
+                    _mm256_loadu_ps(pSrc1 + i), _mm256_loadu_ps(pSrc2 + i), _mm256_loadu_ps(pSrcDst + i));
+                _mm256_storeu_ps(pSrcDst + i, sum);
+            }
+            for (; i < length; i += 1)
+            {
+                pSrcDst[i] += pSrc1[i] * pSrc2[i];
+            }
+        }
+
+        void AddProduct_32fc(floatFC* pSrcDst, const floatFC* pSrc1, const floatFC* pSrc2, size_t const length)
+        {
+            auto dst = reinterpret_cast<float*>(pSrcDst);
+            auto src1 = reinterpret_cast<const float*>(pSrc1);
+            auto src2 = reinterpret_cast<const float*>(pSrc2);
+            size_t i = 0;
+            for (; i + 4 <= length; i += 4)
+            {
+                auto product = ComplexMultiply(_mm256_loadu_ps(src1 + 2 * i), _mm256_loadu_ps(src2 + 2 * i));
+                _mm256_storeu_ps(dst + 2 * i, _mm256_add_ps(_mm256_loadu_ps(dst + 2 * i), product));
+            }
+            for (; i < length; i += 1)
+            {
+                pSrcDst[i].re += pSrc1[i].re * pSrc2[i].re - pSrc1[i].im * pSrc2[i].im;
+                pSrcDst[i].im += pSrc1[i].re * pSrc2[i].im + pSrc1[i].im * pSrc2[i].re;
+            }
+        }
+
+        void AddProductC_32f(float* pSrcDst, const float* pSrc, float scale, size_t length)
+        {
+            auto scaleVector = _mm256_set1_ps(scale);
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8)
+            {
+                auto sum = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i), scaleVector, _mm256_loadu_ps(pSrcDst + i));
+                _mm256_storeu_ps(pSrcDst + i, sum);
+            }
+            for (; i < length; i += 1)
+            {
+                pSrcDst[i] += pSrc[i] * scale;
+            }
+        }
+
+        void DotProd_32f(float* pDst, const float* pSrc1, const float* pSrc2, size_t const length)
+        {
+            // Independent accumulators hide the FMA latency
+            auto sum0 = _mm256_setzero_ps();
+            auto sum1 = _mm256_setzero_ps();
+            auto sum2 = _mm256_setzero_ps();
+            auto sum3 = _mm256_setzero_ps();
+            size_t i = 0;
+            for (; i + 32 <= length; i += 32)
+            {
+                sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc1 + i), _mm256_loadu_ps(pSrc2 + i), sum0);
+                sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc1 + i + 8), _mm256_loadu_ps(pSrc2 + i + 8), sum1);
+                sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc1 + i + 16), _mm256_loadu_ps(pSrc2 + i + 16), sum2);
+                sum3 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc1 + i + 24), _mm256_loadu_ps(pSrc2 + i + 24), sum3);
+            }
+            for (; i + 8 <= length; i += 8)
+            {
+                sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc1 + i), _mm256_loadu_ps(pSrc2 + i), sum0);
+            }
+
+            auto result = HorizontalSum(_mm256_add_ps(_mm256_add_ps(sum0, sum1), _mm256_add_ps(sum2, sum3)));
+            for (; i < length; i += 1)
+            {
+                result += pSrc1[i] * pSrc2[i];
+            }
+            *pDst = result;
+        }
+    } // namespace Arithmetic_Avx2
+} // namespace VectorMath
+#endif // defined(ARCH_X86) || defined(ARCH_X64)
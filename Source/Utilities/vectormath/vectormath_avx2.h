@@ -0,0 +1,36 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+#include "cputype.h"
+#if defined(ARCH_X86) || defined(ARCH_X64)
+#include "vectormath_floatfc.h"
+#include <cstddef>
+
+namespace VectorMath
+{
+    // AVX2/FMA kernels, only called by the dispatcher when the CPU and OS support them.
+    // Unaligned buffers are accepted, so the SSE2 alignment peeling is not needed.
+    namespace Arithmetic_Avx2
+    {
+        void Add_32f(float* pDst, float const* pSrc1, float const* pSrc2, size_t const length);
+
+        void Add_32f_I(float* pSrcDst, float const* pSrc, size_t const length);
+
+        void Sub_32f(float* pDst, float const* pSrc1, float const* pSrc2, size_t const length);
+
+        void Mul_32f(float* pDst, float const* pSrc1, float const* pSrc2, size_t const length);
+
+        void Mul_32fc(floatFC* pDst, floatFC const* pSrc1, floatFC const* pSrc2, size_t const length);
+
+        void MulC_32f(float* pDst, float const* pSrc, float const value, size_t const length);
+
+        void AddProduct_32f(float* pSrcDst, float const* pSrc1, float const* pSrc2, size_t const length);
+
+        void AddProduct_32fc(floatFC* pSrcDst, floatFC const* pSrc1, floatFC const* pSrc2, size_t const length);
+
+        void AddProductC_32f(float* pSrcDst, const float* pSrc, float scale, size_t length);
+
+        void DotProd_32f(float* pDst, float const* pSrc1, float const* pSrc2, size_t const length);
+    } // namespace Arithmetic_Avx2
+} // namespace VectorMath
+#endif // defined(ARCH_X86) || defined(ARCH_X64)
@@ -0,0 +1,218 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#include "cputype.h"
+#if defined(ARCH_X86) || defined(ARCH_X64)
+#include "vectormath_avx512.h"
+#include <immintrin.h>
+
+// This file is compiled with AVX-512F enabled. Keep it free of inline functions shared with other
+// translation units, the linker could otherwise pick an AVX-512 copy for callers on older CPUs.
+namespace VectorMath
+{
+    namespace Arithmetic_Avx512
+    {
+        // Selects the first count lanes of a 16 float vector
+        static inline __mmask16 TailMask(size_t count)
+        {
+            return static_cast<__mmask16>((1u << count) - 1);
+        }
+
+        // Several AVX-512F intrinsics, such as _mm512_moveldup_ps, _mm512_permute_ps and every extraction of the
+        // lower half, trip -Wuninitialized in the GCC 12 headers. This file sticks to shuffles that don't.
+
+        // Eight interleaved complex products (re, im, re, im, ...)
+        static inline __m512 ComplexMultiply(__m512 a, __m512 b)
+        {
+            auto bRe = _mm512_shuffle_ps(b, b, 0xA0);
+            auto bIm = _mm512_shuffle_ps(b, b, 0xF5);
+            auto aSwapped = _mm512_shuffle_ps(a, a, 0xB1);
+            return _mm512_fmaddsub_ps(a, bRe, _mm512_mul_ps(aSwapped, bIm));
+        }
+
+        // Sum of the 16 lanes. The upper halves are folded onto the lower ones, so lane 0 ends up with the total.
+        static inline float ReduceAdd(__m512 value)
+        {
+            auto sum = _mm512_add_ps(value, _mm512_maskz_shuffle_f32x4(0xFFFF, value, value, 0xEE));
+            sum = _mm512_add_ps(sum, _mm512_maskz_shuffle_f32x4(0xFFFF, sum, sum, 0x55));
+            sum = _mm512_add_ps(sum, _mm512_shuffle_ps(sum, sum, 0x4E));
+            sum = _mm512_add_ps(sum, _mm512_shuffle_ps(sum, sum, 0xB1));
+            return _mm512_cvtss_f32(sum);
+        }
+
+        void Add_32f(float* pDst, const float* pSrc1, const float* pSrc2, size_t const length)
+        {
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16)
+            {
+                _mm512_storeu_ps(pDst + i, _mm512_add_ps(_mm512_loadu_ps(pSrc1 + i), _mm512_loadu_ps(pSrc2 + i)));
+            }
+            if (i < length)
+            {
+                auto mask = TailMask(length - i);
+                auto sum =
+                    _mm512_add_ps(_mm512_maskz_loadu_ps(mask, pSrc1 + i), _mm512_maskz_loadu_ps(mask, pSrc2 + i));
+                _mm512_mask_storeu_ps(pDst + i, mask, sum);
+            }
+        }
+
+        void Add_32f_I(float* pSrcDst, const float* pSrc, size_t const length)
+        {
+            Add_32f(pSrcDst, pSrcDst, pSrc, length);
+        }
+
+        void Sub_32f(float* pDst, const float* pSrc1, const float* pSrc2, size_t const length)
+        {
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16)
+            {
+                _mm512_storeu_ps(pDst + i, _mm512_sub_ps(_mm512_loadu_ps(pSrc1 + i), _mm512_loadu_ps(pSrc2 + i)));
+            }
+            if (i < length)
+            {
+                auto mask = TailMask(length - i);
+                auto diff =
+                    _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, pSrc1 + i), _mm512_maskz_loadu_ps(mask, pSrc2 + i));
+                _mm512_mask_storeu_ps(pDst + i, mask, diff);
+            }
+        }
+
+        void Mul_32f(float* pDst, const float* pSrc1, const float* pSrc2, size_t const length)
+        {
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16)
+            {
+                _mm512_storeu_ps(pDst + i, _mm512_mul_ps(_mm512_loadu_ps(pSrc1 + i), _mm512_loadu_ps(pSrc2 + i)));
+            }
+            if (i < length)
+            {
+                auto mask = TailMask(length - i);
+                auto prod =
+                    _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, pSrc1 + i), _mm512_maskz_loadu_ps(mask, pSrc2 + i));
+                _mm512_mask_storeu_ps(pDst + i, mask, prod);
+            }
+        }
+
+        void Mul_32fc(floatFC* pDst, const floatFC* pSrc1, const floatFC* pSrc2, size_t const length)
+        {
+            auto dst = reinterpret_cast<float*>(pDst);
+            auto src1 = reinterpret_cast<const float*>(pSrc1);
+            auto src2 = reinterpret_cast<const float*>(pSrc2);
+            const auto floats = 2 * length;
+            size_t i = 0;
+            for (; i + 16 <= floats; i += 16)
+            {
+                _mm512_storeu_ps(dst + i, ComplexMultiply(_mm512_loadu_ps(src1 + i), _mm512_loadu_ps(src2 + i)));
+            }
+            if (i < floats)
+            {
+                auto mask = TailMask(floats - i);
+                auto product =
+                    ComplexMultiply(_mm512_maskz_loadu_ps(mask, src1 + i), _mm512_maskz_loadu_ps(mask, src2 + i));
+                _mm512_mask_storeu_ps(dst + i, mask, product);
+            }
+        }
+
+        void MulC_32f(float* pDst, const float* pSrc, float const value, size_t const length)
+        {
+            auto scale = _mm512_set1_ps(value);
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16)
+            {
+                _mm512_storeu_ps(pDst + i, _mm512_mul_ps(_mm512_loadu_ps(pSrc + i), scale));
+            }
+            if (i < length)
+            {
+                auto mask = TailMask(length - i);
+                _mm512_mask_storeu_ps(pDst + i, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, pSrc + i), scale));
+            }
+        }
+
+        void AddProduct_32f(float* pSrcDst, const float* pSrc1, const float* pSrc2, size_t const length)
+        {
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16)
+            {
+                auto sum = _mm512_fmadd_ps(
+                    _mm512_loadu_ps(pSrc1 + i), _mm512_loadu_ps(pSrc2 + i), _mm512_loadu_ps(pSrcDst + i));
+                _mm512_storeu_ps(pSrcDst + i, sum);
+            }
+            if (i < length)
+            {
+                auto mask = TailMask(length - i);
+                auto sum = _mm512_fmadd_ps(
+                    _mm512_maskz_loadu_ps(mask, pSrc1 + i), _mm512_maskz_loadu_ps(mask, pSrc2 + i),
+                    _mm512_maskz_loadu_ps(mask, pSrcDst + i));
+                _mm512_mask_storeu_ps(pSrcDst + i, mask, sum);
+            }
+        }
+
+        void AddProduct_32fc(floatFC* pSrcDst, const floatFC* pSrc1, const floatFC* pSrc2, size_t const length)
+        {
+            auto dst = reinterpret_cast<float*>(pSrcDst);
+            auto src1 = reinterpret_cast<const float*>(pSrc1);
+            auto src2 = reinterpret_cast<const float*>(pSrc2);
+            const auto floats = 2 * length;
+            size_t i = 0;
+            for (; i + 16 <= floats; i += 16)
+            {
+                auto product = ComplexMultiply(_mm512_loadu_ps(src1 + i), _mm512_loadu_ps(src2 + i));
+                _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(dst + i), product));
+            }
+            if (i < floats)
+            {
+                auto mask = TailMask(floats - i);
+                auto product =
+                    ComplexMultiply(_mm512_maskz_loadu_ps(mask, src1 + i), _mm512_maskz_loadu_ps(mask, src2 + i));
+                _mm512_mask_storeu_ps(dst + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, dst + i), product));
+            }
+        }
+
+        void AddProductC_32f(float* pSrcDst, const float* pSrc, float scale, size_t length)
+        {
+            auto scaleVector = _mm512_set1_ps(scale);
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16)
+            {
+                auto sum = _mm512_fmadd_ps(_mm512_loadu_ps(pSrc + i), scaleVector, _mm512_loadu_ps(pSrcDst + i));
+                _mm512_storeu_ps(pSrcDst + i, sum);
+            }
+            if (i < length)
+            {
+                auto mask = TailMask(length - i);
+                auto sum = _mm512_fmadd_ps(
+                    _mm512_maskz_loadu_ps(mask, pSrc + i), scaleVector, _mm512_maskz_loadu_ps(mask, pSrcDst + i));
+                _mm512_mask_storeu_ps(pSrcDst + i, mask, sum);
+            }
+        }
+
+        void DotProd_32f(float* pDst, const float* pSrc1, const float* pSrc2, size_t const length)
+        {
+            // Independent accumulators hide the FMA latency
+            auto sum0 = _mm512_setzero_ps();
+            auto sum1 = _mm512_setzero_ps();
+            auto sum2 = _mm512_setzero_ps();
+            auto sum3 = _mm512_setzero_ps();
+            size_t i = 0;
+            for (; i + 64 <= length; i += 64)
+            {
+                sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(pSrc1 + i), _mm512_loadu_ps(pSrc2 + i), sum0);
+                sum1 = _mm512_fmadd_ps(_mm512_loadu_ps(pSrc1 + i + 16), _mm512_loadu_ps(pSrc2 + i + 16), sum1);
+                sum2 = _mm512_fmadd_ps(_mm512_loadu_ps(pSrc1 + i + 32), _mm512_loadu_ps(pSrc2 + i + 32), sum2);
+                sum3 = _mm512_fmadd_ps(_mm512_loadu_ps(pSrc1 + i + 48), _mm512_loadu_ps(pSrc2 + i + 48), sum3);
+            }
+            for (; i + 16 <= length; i += 16)
+            {
+                sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(pSrc1 + i), _mm512_loadu_ps(pSrc2 + i), sum0);
+            }
+            if (i < length)
+            {
+                auto mask = TailMask(length - i);
+                sum1 = _mm512_fmadd_ps(
+                    _mm512_maskz_loadu_ps(mask, pSrc1 + i), _mm512_maskz_loadu_ps(mask, pSrc2 + i), sum1);
+            }
+
+            *pDst = ReduceAdd(_mm512_add_ps(_mm512_add_ps(sum0, sum1), _mm512_add_ps(sum2, sum3)));
+        }
+    } // namespace Arithmetic_Avx512
+} // namespace VectorMath
+#endif // defined(ARCH_X86) || defined(ARCH_X64)
@@ -5,6 +5,14 @@
 #include "vectormath_generic.h"
 #include "vectormath_sse2.h"
 #include "vectormath_neon.h"
+#include "vectormath_avx2.h"
+#include "vectormath_avx512.h"
+
+#if defined(_MSC_VER) && (defined(ARCH_X86) || defined(ARCH_X64))
+#include <intrin.h>
+#elif defined(ARCH_X86) || defined(ARCH_X64)
+#include <cpuid.h>
+#endif
 
 #ifdef VECTORMATH_FFTW
 class FftwCleanupHandler final
@@ -22,24 +30,185 @@ static FftwCleanupHandler g_FftwCleanupHandler;
 namespace VectorMath
 {
 
-    std::unique_ptr<IRealFft> CreateRealFft(unsigned int order)
+    static IRealFft* NewRealFft(unsigned int order)
     {
 #if defined(VECTORMATH_FFTW)
-        return std::unique_ptr<IRealFft>(new FftwWrapper(order));
+        return new FftwWrapper(order);
+#elif defined(ARCH_X86) || defined(ARCH_X64)
+        if (RealFftPlan::IsSupportedOrder(order))
+        {
+            return new RealFft_Sse2(order);
+        }
+        return new RealFft_generic(order);
+#elif defined(ARCH_ARM) || defined(ARCH_ARM64)
+        if (RealFftPlan::IsSupportedOrder(order))
+        {
+            return new RealFft_Neon(order);
+        }
+        return new RealFft_generic(order);
 #else
-        return std::unique_ptr<IRealFft>(new RealFft_generic(order));
+        return new RealFft_generic(order);
 #endif
     }
 
+    std::unique_ptr<IRealFft> CreateRealFft(unsigned int order)
+    {
+        return std::unique_ptr<IRealFft>(NewRealFft(order));
+    }
+
     std::shared_ptr<IRealFft> CreateSharedRealFft(unsigned int order)
     {
-#if defined(VECTORMATH_FFTW)
-        return std::shared_ptr<IRealFft>(new FftwWrapper(order));
+        return std::shared_ptr<IRealFft>(NewRealFft(order));
+    }
+
+#if defined(ARCH_X86) || defined(ARCH_X64)
+    // Arithmetic kernels that have AVX2/FMA and AVX-512 versions. The table is constant-initialized to SSE2, so
+    // callers from other static initializers are safe, and is upgraded once by s_ArithmeticIsa below.
+    struct ArithmeticDispatch
+    {
+        void (*Add_32f)(float*, float const*, float const*, size_t);
+        void (*Add_32f_I)(float*, float const*, size_t);
+        void (*Sub_32f)(float*, float const*, float const*, size_t);
+        void (*Mul_32f)(float*, float const*, float const*, size_t);
+        void (*Mul_32fc)(floatFC*, floatFC const*, floatFC const*, size_t);
+        void (*MulC_32f)(float*, float const*, float, size_t);
+        void (*AddProduct_32f)(float*, float const*, float const*, size_t);
+        void (*AddProduct_32fc)(floatFC*, floatFC const*, floatFC const*, size_t);
+        void (*AddProductC_32f)(float*, float const*, float, size_t);
+        void (*DotProd_32f)(float*, float const*, float const*, size_t);
+    };
+
+    static ArithmeticDispatch s_Arithmetic = {
+        Arithmetic_Sse2::Add_32f,
+        Arithmetic_Sse2::Add_32f_I,
+        Arithmetic_Sse2::Sub_32f,
+        Arithmetic_Sse2::Mul_32f,
+        Arithmetic_Sse2::Mul_32fc,
+        Arithmetic_Sse2::MulC_32f,
+        Arithmetic_Sse2::AddProduct_32f,
+        Arithmetic_Sse2::AddProduct_32fc,
+        Arithmetic_Sse2::AddProductC_32f,
+        Arithmetic_Sse2::DotProd_32f};
+
+    static void CpuId(uint32_t leaf, uint32_t subleaf, uint32_t (&registers)[4])
+    {
+#if defined(_MSC_VER)
+        int values[4];
+        __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+        for (auto i = 0; i < 4; ++i)
+        {
+            registers[i] = static_cast<uint32_t>(values[i]);
+        }
+#else
+        if (!__get_cpuid_count(leaf, subleaf, &registers[0], &registers[1], &registers[2], &registers[3]))
+        {
+            registers[0] = registers[1] = registers[2] = registers[3] = 0;
+        }
+#endif
+    }
+
+    // Register state the OS saves on context switches (XCR0)
+    static uint64_t GetEnabledXState()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
 #else
-        return std::shared_ptr<IRealFft>(new RealFft_generic(order));
+        uint32_t low, high;
+        __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        return (static_cast<uint64_t>(high) << 32) | low;
 #endif
     }
 
+    static ArithmeticIsa DetectArithmeticIsa()
+    {
+        uint32_t registers[4];
+        CpuId(0, 0, registers);
+        const auto maxLeaf = registers[0];
+        if (maxLeaf < 7)
+        {
+            return ArithmeticIsa::Sse2;
+        }
+
+        // AVX state must be enabled by the OS as well as supported by the CPU
+        CpuId(1, 0, registers);
+        const auto osxsave = (registers[2] & (1u << 27)) != 0;
+        const auto avx = (registers[2] & (1u << 28)) != 0;
+        const auto fma = (registers[2] & (1u << 12)) != 0;
+        if (!osxsave || !avx || !fma)
+        {
+            return ArithmeticIsa::Sse2;
+        }
+        const auto xstate = GetEnabledXState();
+
+        CpuId(7, 0, registers);
+        const auto avx2 = (registers[1] & (1u << 5)) != 0;
+        const auto avx512f = (registers[1] & (1u << 16)) != 0;
+
+        // XMM, YMM and the opmask, ZMM_Hi256 and Hi16_ZMM states
+        if (avx512f && avx2 && (xstate & 0xE6) == 0xE6)
+        {
+            return ArithmeticIsa::Avx512;
+        }
+        if (avx2 && (xstate & 0x6) == 0x6)
+        {
+            return ArithmeticIsa::Avx2;
+        }
+        return ArithmeticIsa::Sse2;
+    }
+
+    static ArithmeticIsa InitializeArithmeticDispatch()
+    {
+        const auto isa = DetectArithmeticIsa();
+        if (isa == ArithmeticIsa::Avx512)
+        {
+            s_Arithmetic = {
+                Arithmetic_Avx512::Add_32f,
+                Arithmetic_Avx512::Add_32f_I,
+                Arithmetic_Avx512::Sub_32f,
+                Arithmetic_Avx512::Mul_32f,
+                Arithmetic_Avx512::Mul_32fc,
+                Arithmetic_Avx512::MulC_32f,
+                Arithmetic_Avx512::AddProduct_32f,
+                Arithmetic_Avx512::AddProduct_32fc,
+                Arithmetic_Avx512::AddProductC_32f,
+                Arithmetic_Avx512::DotProd_32f};
+        }
+        else if (isa == ArithmeticIsa::Avx2)
+        {
+            s_Arithmetic = {
+                Arithmetic_Avx2::Add_32f,
+                Arithmetic_Avx2::Add_32f_I,
+                Arithmetic_Avx2::Sub_32f,
+                Arithmetic_Avx2::Mul_32f,
+                Arithmetic_Avx2::Mul_32fc,
+                Arithmetic_Avx2::MulC_32f,
+                Arithmetic_Avx2::AddProduct_32f,
+                Arithmetic_Avx2::AddProduct_32fc,
+                Arithmetic_Avx2::AddProductC_32f,
+                Arithmetic_Avx2::DotProd_32f};
+        }
+        return isa;
+    }
+
+    // Resolved once while the library is loaded, before any audio thread can call into it
+    static const ArithmeticIsa s_ArithmeticIsa = InitializeArithmeticDispatch();
+
+    ArithmeticIsa GetArithmeticIsa() noexcept
+    {
+        return s_ArithmeticIsa;
+    }
+#elif defined(ARCH_ARM) || defined(ARCH_ARM64)
+    ArithmeticIsa GetArithmeticIsa() noexcept
+    {
+        return ArithmeticIsa::Neon;
+    }
+#else
+    ArithmeticIsa GetArithmeticIsa() noexcept
+    {
+        return ArithmeticIsa::Generic;
+    }
+#endif
+
     namespace Arithmetic
     {
         // Platform abstraction for stateless math functions
@@ -47,7 +216,7 @@ namespace VectorMath
         void Add_32f(float* pDst, float const* pSrc1, float const* pSrc2, size_t const length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::Add_32f(pDst, pSrc1, pSrc2, length);
+            s_Arithmetic.Add_32f(pDst, pSrc1, pSrc2, length);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::Add_32f(pDst, pSrc1, pSrc2, length);
 #else
@@ -70,7 +239,7 @@ namespace VectorMath
         void Add_32f_I(float* pSrcDst, float const* pSrc, size_t const length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::Add_32f_I(pSrcDst, pSrc, length);
+            s_Arithmetic.Add_32f_I(pSrcDst, pSrc, length);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::Add_32f_I(pSrcDst, pSrc, length);
 #else
@@ -83,7 +252,9 @@ namespace VectorMath
         void Add_32fc(floatFC* pDst, floatFC const* pSrc1, floatFC const* pSrc2, size_t const length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::Add_32fc(pDst, pSrc1, pSrc2, length);
+            s_Arithmetic.Add_32f(
+                reinterpret_cast<float*>(pDst), reinterpret_cast<const float*>(pSrc1),
+                reinterpret_cast<const float*>(pSrc2), length * 2);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::Add_32fc(pDst, pSrc1, pSrc2, length);
 #else
@@ -95,7 +266,7 @@ namespace VectorMath
         void Add_32fc_I(floatFC* pSrcDst, floatFC const* pSrc, size_t const length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::Add_32f_I(
+            s_Arithmetic.Add_32f_I(
                 reinterpret_cast<float*>(pSrcDst), reinterpret_cast<const float*>(pSrc), length * 2);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::Add_32f_I(
@@ -109,7 +280,7 @@ namespace VectorMath
         void Sub_32f(float* pDst, float const* pSrc1, float const* pSrc2, size_t const length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::Sub_32f(pDst, pSrc1, pSrc2, length);
+            s_Arithmetic.Sub_32f(pDst, pSrc1, pSrc2, length);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::Sub_32f(pDst, pSrc1, pSrc2, length);
 #else
@@ -120,7 +291,9 @@ namespace VectorMath
         void Sub_32fc(floatFC* pDst, floatFC const* pSrc1, floatFC const* pSrc2, size_t const length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::Sub_32fc(pDst, pSrc1, pSrc2, length);
+            s_Arithmetic.Sub_32f(
+                reinterpret_cast<float*>(pDst), reinterpret_cast<const float*>(pSrc1),
+                reinterpret_cast<const float*>(pSrc2), length * 2);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::Sub_32fc(pDst, pSrc1, pSrc2, length);
 #else
@@ -135,7 +308,7 @@ namespace VectorMath
             _In_reads_(length) floatFC const* pSrc2, _In_ size_t const length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::Mul_32fc(pDst, pSrc1, pSrc2, length);
+            s_Arithmetic.Mul_32fc(pDst, pSrc1, pSrc2, length);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::Mul_32fc(pDst, pSrc1, pSrc2, length);
 #else
@@ -150,7 +323,7 @@ namespace VectorMath
             _In_reads_(length) float const* pSrc2, _In_ size_t const length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::Mul_32f(pDst, pSrc1, pSrc2, length);
+            s_Arithmetic.Mul_32f(pDst, pSrc1, pSrc2, length);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::Mul_32f(pDst, pSrc1, pSrc2, length);
 #else
@@ -165,7 +338,7 @@ namespace VectorMath
             _In_ size_t const length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::MulC_32f(pDst, pSrc, value, length);
+            s_Arithmetic.MulC_32f(pDst, pSrc, value, length);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::MulC_32f(pDst, pSrc, value, length);
 #else
@@ -180,7 +353,7 @@ namespace VectorMath
             _In_ size_t const length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::MulC_32f(
+            s_Arithmetic.MulC_32f(
                 reinterpret_cast<float*>(pDst), reinterpret_cast<const float*>(pSrc), value, length * 2);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::MulC_32f(
@@ -198,7 +371,7 @@ namespace VectorMath
             _In_reads_(length) float const* pSrc2, _In_ size_t const length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::AddProduct_32f(pSrcDst, pSrc1, pSrc2, length);
+            s_Arithmetic.AddProduct_32f(pSrcDst, pSrc1, pSrc2, length);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::AddProduct_32f(pSrcDst, pSrc1, pSrc2, length);
 #else
@@ -213,7 +386,7 @@ namespace VectorMath
             _In_reads_(length) floatFC const* pSrc2, _In_ size_t const length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::AddProduct_32fc(pSrcDst, pSrc1, pSrc2, length);
+            s_Arithmetic.AddProduct_32fc(pSrcDst, pSrc1, pSrc2, length);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::AddProduct_32fc(pSrcDst, pSrc1, pSrc2, length);
 #else
@@ -227,7 +400,7 @@ namespace VectorMath
             _In_ size_t length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::AddProductC_32f(pSrcDst, pSrc, scale, length);
+            s_Arithmetic.AddProductC_32f(pSrcDst, pSrc, scale, length);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::AddProductC_32f(pSrcDst, pSrc, scale, length);
 #else
@@ -241,7 +414,7 @@ namespace VectorMath
             _In_ size_t const length)
         {
 #if defined(ARCH_X86) || defined(ARCH_X64)
-            Arithmetic_Sse2::DotProd_32f(pDst, pSrc1, pSrc2, length);
+            s_Arithmetic.DotProd_32f(pDst, pSrc1, pSrc2, length);
 #elif defined(ARCH_ARM) || defined(ARCH_ARM64)
             Arithmetic_Neon::DotProd_32f(pDst, pSrc1, pSrc2, length);
 #else
@@ -275,5 +448,86 @@ namespace VectorMath
 #endif
         }
 
+        /* Apply a 3x4 affine transform to points stored as separate x, y and z arrays */
+        _Use_decl_annotations_ void TransformPoints_32f(
+            float* pDstX, float* pDstY, float* pDstZ, float const* pSrcX, float const* pSrcY, float const* pSrcZ,
+            float const* pMatrix, size_t length)
+        {
+#if defined(ARCH_X86) || defined(ARCH_X64)
+            Arithmetic_Sse2::TransformPoints_32f(pDstX, pDstY, pDstZ, pSrcX, pSrcY, pSrcZ, pMatrix, length);
+#elif defined(ARCH_ARM) || defined(ARCH_ARM64)
+            Arithmetic_Neon::TransformPoints_32f(pDstX, pDstY, pDstZ, pSrcX, pSrcY, pSrcZ, pMatrix, length);
+#else
+            Arithmetic_Generic::TransformPoints_32f(pDstX, pDstY, pDstZ, pSrcX, pSrcY, pSrcZ, pMatrix, length);
+#endif
+        }
+
+        /* Convert amplitudes to dB */
+        _Use_decl_annotations_ void AmplitudeToDb_32f(float* pDst, float const* pSrc, size_t length)
+        {
+#if defined(ARCH_X86) || defined(ARCH_X64)
+            Arithmetic_Sse2::AmplitudeToDb_32f(pDst, pSrc, length);
+#elif defined(ARCH_ARM) || defined(ARCH_ARM64)
+            Arithmetic_Neon::AmplitudeToDb_32f(pDst, pSrc, length);
+#else
+            Arithmetic_Generic::AmplitudeToDb_32f(pDst, pSrc, length);
+#endif
+        }
+
+        /* Convert dB to amplitudes */
+        _Use_decl_annotations_ void DbToAmplitude_32f(float* pDst, float const* pSrc, size_t length)
+        {
+#if defined(ARCH_X86) || defined(ARCH_X64)
+            Arithmetic_Sse2::DbToAmplitude_32f(pDst, pSrc, length);
+#elif defined(ARCH_ARM) || defined(ARCH_ARM64)
+            Arithmetic_Neon::DbToAmplitude_32f(pDst, pSrc, length);
+#else
+            Arithmetic_Generic::DbToAmplitude_32f(pDst, pSrc, length);
+#endif
+        }
+
+        /* Convert direction vectors to azimuth and elevation in degrees */
+        _Use_decl_annotations_ void VectorToSpherical_32f(
+            float* pAzimuth, float* pElevation, float const* pX, float const* pY, float const* pZ, size_t length)
+        {
+#if defined(ARCH_X86) || defined(ARCH_X64)
+            Arithmetic_Sse2::VectorToSpherical_32f(pAzimuth, pElevation, pX, pY, pZ, length);
+#elif defined(ARCH_ARM) || defined(ARCH_ARM64)
+            Arithmetic_Neon::VectorToSpherical_32f(pAzimuth, pElevation, pX, pY, pZ, length);
+#else
+            Arithmetic_Generic::VectorToSpherical_32f(pAzimuth, pElevation, pX, pY, pZ, length);
+#endif
+        }
+
+        /* Sum the first two channels of interleaved frames and scale the result */
+        _Use_decl_annotations_ void
+        DownmixStereo_32f(float* pDst, float const* pSrc, size_t numChannels, float scale, size_t length)
+        {
+#if defined(ARCH_X86) || defined(ARCH_X64)
+            Arithmetic_Sse2::DownmixStereo_32f(pDst, pSrc, numChannels, scale, length);
+#elif defined(ARCH_ARM) || defined(ARCH_ARM64)
+            Arithmetic_Neon::DownmixStereo_32f(pDst, pSrc, numChannels, scale, length);
+#else
+            Arithmetic_Generic::DownmixStereo_32f(pDst, pSrc, numChannels, scale, length);
+#endif
+        }
+
+        /* Mono downmix and passthrough copy of interleaved frames, crossfaded by a linear blend ramp */
+        _Use_decl_annotations_ void DownmixCrossfade_32f(
+            float* pDownmix, float* pPassthrough, float const* pSrc, size_t numChannels, float startBlend,
+            float blendStep, size_t length)
+        {
+#if defined(ARCH_X86) || defined(ARCH_X64)
+            Arithmetic_Sse2::DownmixCrossfade_32f(
+                pDownmix, pPassthrough, pSrc, numChannels, startBlend, blendStep, length);
+#elif defined(ARCH_ARM) || defined(ARCH_ARM64)
+            Arithmetic_Neon::DownmixCrossfade_32f(
+                pDownmix, pPassthrough, pSrc, numChannels, startBlend, blendStep, length);
+#else
+            Arithmetic_Generic::DownmixCrossfade_32f(
+                pDownmix, pPassthrough, pSrc, numChannels, startBlend, blendStep, length);
+#endif
+        }
+
     } // namespace Arithmetic
 } // namespace VectorMath
@@ -3,6 +3,7 @@
 
 #include "vectormath.h"
 #include "vectormath_generic.h"
+#include <algorithm>
 #include <cstring>
 #include <cmath>
 #include <stdexcept>
@@ -432,5 +433,83 @@ namespace VectorMath
                 pDst[i] = pSrcA[i] + (remainder * (pSrcB[i] - pSrcA[i]));
             }
         }
+
+        _Use_decl_annotations_ void TransformPoints_32f(
+            float* pDstX, float* pDstY, float* pDstZ, float const* pSrcX, float const* pSrcY, float const* pSrcZ,
+            float const* pMatrix, size_t length)
+        {
+            for (size_t i = 0; i < length; i++)
+            {
+                // Read the whole point first, the destinations may alias the sources
+                const auto x = pSrcX[i];
+                const auto y = pSrcY[i];
+                const auto z = pSrcZ[i];
+                pDstX[i] = pMatrix[0] * x + pMatrix[1] * y + pMatrix[2] * z + pMatrix[3];
+                pDstY[i] = pMatrix[4] * x + pMatrix[5] * y + pMatrix[6] * z + pMatrix[7];
+                pDstZ[i] = pMatrix[8] * x + pMatrix[9] * y + pMatrix[10] * z + pMatrix[11];
+            }
+        }
+
+        _Use_decl_annotations_ void AmplitudeToDb_32f(float* pDst, float const* pSrc, size_t length)
+        {
+            for (size_t i = 0; i < length; i++)
+            {
+                pDst[i] = 20.0f * std::log10(std::max(pSrc[i], c_MinAmplitude));
+            }
+        }
+
+        _Use_decl_annotations_ void DbToAmplitude_32f(float* pDst, float const* pSrc, size_t length)
+        {
+            for (size_t i = 0; i < length; i++)
+            {
+                const auto dB = std::min(std::max(pSrc[i], c_MinAmplitudeDb), c_MaxAmplitudeDb);
+                pDst[i] = std::pow(10.0f, dB / 20.0f);
+            }
+        }
+
+        _Use_decl_annotations_ void VectorToSpherical_32f(
+            float* pAzimuth, float* pElevation, float const* pX, float const* pY, float const* pZ, size_t length)
+        {
+            constexpr float eps = 1e-4f;
+            constexpr float radianToDeg = 57.29577951308232f;
+            for (size_t i = 0; i < length; i++)
+            {
+                const auto x = pX[i];
+                const auto y = pY[i];
+                const auto z = pZ[i];
+                const auto horizontalLength = std::sqrt(x * x + z * z);
+                const auto azimuthRadians = horizontalLength > eps ? std::atan2(-x, -z) : 0.0f;
+                const auto elevationRadians =
+                    (horizontalLength + std::fabs(y)) > eps ? std::atan2(y, horizontalLength) : 0.0f;
+
+                pAzimuth[i] = std::fmod(std::fmod(azimuthRadians * radianToDeg, 360.0f) + 360.0f, 360.0f);
+                pElevation[i] = std::min(std::max(elevationRadians * radianToDeg, -90.0f), 90.0f);
+            }
+        }
+
+        _Use_decl_annotations_ void
+        DownmixStereo_32f(float* pDst, float const* pSrc, size_t numChannels, float scale, size_t length)
+        {
+            for (size_t i = 0; i < length; i++)
+            {
+                pDst[i] = (pSrc[i * numChannels] + pSrc[i * numChannels + 1]) * scale;
+            }
+        }
+
+        _Use_decl_annotations_ void DownmixCrossfade_32f(
+            float* pDownmix, float* pPassthrough, float const* pSrc, size_t numChannels, float startBlend,
+            float blendStep, size_t length)
+        {
+            for (size_t i = 0; i < length; i++)
+            {
+                const auto blend = startBlend + blendStep * static_cast<float>(i + 1);
+                const auto frame = pSrc + i * numChannels;
+                pDownmix[i] = (frame[0] + frame[1]) * 0.5f * blend;
+                for (size_t channel = 0; channel < numChannels; channel++)
+                {
+                    pPassthrough[i * numChannels + channel] = frame[channel] * (1.0f - blend);
+                }
+            }
+        }
     } // namespace Arithmetic_Generic
 } // namespace VectorMath
@@ -36,6 +36,11 @@ namespace VectorMath
     // Standard C++ implementation of the vector math operations
     namespace Arithmetic_Generic
     {
+        // Limits of the dB conversions, shared by all implementations: FLT_MIN, its dB value, and the dB value of 2^127
+        constexpr float c_MinAmplitude = 1.17549435e-38f;
+        constexpr float c_MinAmplitudeDb = -758.5956f;
+        constexpr float c_MaxAmplitudeDb = 764.6162f;
+
         void Add_32f(float* pDst, float const* pSrc1, float const* pSrc2, size_t const length);
 
         void Add_32f(float* pDst, float const* pSrc1, float const* pSrc2, float const* pSrc3, size_t const length);
@@ -90,6 +95,31 @@ namespace VectorMath
         void InterpolateC_32f(
             _Inout_updates_(length) float* pDst, _In_reads_(length) const float* pSrcA,
             _In_reads_(length) float const* pSrcB, _In_ const float remainder, size_t length);
+
+        void TransformPoints_32f(
+            _Out_writes_(length) float* pDstX, _Out_writes_(length) float* pDstY, _Out_writes_(length) float* pDstZ,
+            _In_reads_(length) float const* pSrcX, _In_reads_(length) float const* pSrcY,
+            _In_reads_(length) float const* pSrcZ, _In_reads_(12) float const* pMatrix, _In_ size_t length);
+
+        void AmplitudeToDb_32f(
+            _Out_writes_(length) float* pDst, _In_reads_(length) float const* pSrc, _In_ size_t length);
+
+        void DbToAmplitude_32f(
+            _Out_writes_(length) float* pDst, _In_reads_(length) float const* pSrc, _In_ size_t length);
+
+        void VectorToSpherical_32f(
+            _Out_writes_(length) float* pAzimuth, _Out_writes_(length) float* pElevation,
+            _In_reads_(length) float const* pX, _In_reads_(length) float const* pY,
+            _In_reads_(length) float const* pZ, _In_ size_t length);
+
+        void DownmixStereo_32f(
+            _Out_writes_(length) float* pDst, _In_reads_(length * numChannels) float const* pSrc,
+            _In_ size_t numChannels, _In_ float scale, _In_ size_t length);
+
+        void DownmixCrossfade_32f(
+            _Out_writes_(length) float* pDownmix, _Out_writes_(length * numChannels) float* pPassthrough,
+            _In_reads_(length * numChannels) float const* pSrc, _In_ size_t numChannels, _In_ float startBlend,
+            _In_ float blendStep, _In_ size_t length);
     } // namespace Arithmetic_Generic
 
 } // namespace VectorMath
@@ -6,6 +6,7 @@
 
 #include "vectormath.h"
 #include "vectormath_neon.h"
+#include "vectormath_realfft_kernels.h"
 // For the unaligned portions, some functions fall back to the generic impl
 #include "vectormath_generic.h"
 #if defined(ARCH_ARM64) && !defined(__clang__)
@@ -18,6 +19,72 @@ namespace VectorMath
 {
     namespace Arithmetic_Neon
     {
+        // 4-lane vector operations for the shared real FFT kernels
+        struct FftOps
+        {
+            using Vector = float32x4_t;
+
+            static Vector Load(const float* p)
+            {
+                return vld1q_f32(p);
+            }
+            static Vector LoadU(const float* p)
+            {
+                return vld1q_f32(p);
+            }
+            static void Store(float* p, Vector v)
+            {
+                vst1q_f32(p, v);
+            }
+            static void StoreU(float* p, Vector v)
+            {
+                vst1q_f32(p, v);
+            }
+            static Vector Add(Vector a, Vector b)
+            {
+                return vaddq_f32(a, b);
+            }
+            static Vector Sub(Vector a, Vector b)
+            {
+                return vsubq_f32(a, b);
+            }
+            static Vector Mul(Vector a, Vector b)
+            {
+                return vmulq_f32(a, b);
+            }
+            static Vector Set(float value)
+            {
+                return vdupq_n_f32(value);
+            }
+            static Vector Reverse(Vector v)
+            {
+                auto pairs = vrev64q_f32(v);
+                return vcombine_f32(vget_high_f32(pairs), vget_low_f32(pairs));
+            }
+            static void Transpose(Vector& a, Vector& b, Vector& c, Vector& d)
+            {
+                auto ab = vtrnq_f32(a, b);
+                auto cd = vtrnq_f32(c, d);
+                a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+                b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+                c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+                d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+            }
+            static void LoadDeinterleave(const float* p, Vector& even, Vector& odd)
+            {
+                auto pairs = vld2q_f32(p);
+                even = pairs.val[0];
+                odd = pairs.val[1];
+            }
+            static void StoreInterleave(float* p, Vector even, Vector odd)
+            {
+                float32x4x2_t pairs;
+                pairs.val[0] = even;
+                pairs.val[1] = odd;
+                vst2q_f32(p, pairs);
+            }
+        };
+
         // helper functions
         inline float32x4x2_t NeonComplexAdd(float32x4x2_t src1, float32x4x2_t src2)
         {
@@ -391,7 +458,307 @@ namespace VectorMath
 
             return maxIndex;
         }
+
+        void TransformPoints_32f(
+            float* pDstX, float* pDstY, float* pDstZ, const float* pSrcX, const float* pSrcY, const float* pSrcZ,
+            const float* pMatrix, size_t length)
+        {
+            size_t i = 0;
+            for (; i + 4 <= length; i += 4)
+            {
+                const auto x = vld1q_f32(pSrcX + i);
+                const auto y = vld1q_f32(pSrcY + i);
+                const auto z = vld1q_f32(pSrcZ + i);
+                auto outX = vmlaq_n_f32(vdupq_n_f32(pMatrix[3]), x, pMatrix[0]);
+                auto outY = vmlaq_n_f32(vdupq_n_f32(pMatrix[7]), x, pMatrix[4]);
+                auto outZ = vmlaq_n_f32(vdupq_n_f32(pMatrix[11]), x, pMatrix[8]);
+                outX = vmlaq_n_f32(outX, y, pMatrix[1]);
+                outY = vmlaq_n_f32(outY, y, pMatrix[5]);
+                outZ = vmlaq_n_f32(outZ, y, pMatrix[9]);
+                outX = vmlaq_n_f32(outX, z, pMatrix[2]);
+                outY = vmlaq_n_f32(outY, z, pMatrix[6]);
+                outZ = vmlaq_n_f32(outZ, z, pMatrix[10]);
+                vst1q_f32(pDstX + i, outX);
+                vst1q_f32(pDstY + i, outY);
+                vst1q_f32(pDstZ + i, outZ);
+            }
+
+            if (i < length)
+            {
+                Arithmetic_Generic::TransformPoints_32f(
+                    pDstX + i, pDstY + i, pDstZ + i, pSrcX + i, pSrcY + i, pSrcZ + i, pMatrix, length - i);
+            }
+        }
+
+        // Division and square root from the reciprocal estimates and two Newton-Raphson steps, which ARMv7 lacks
+        // instructions for. Good to a few ulp.
+        static inline float32x4_t Divide(float32x4_t numerator, float32x4_t denominator)
+        {
+            auto reciprocal = vrecpeq_f32(denominator);
+            reciprocal = vmulq_f32(reciprocal, vrecpsq_f32(denominator, reciprocal));
+            reciprocal = vmulq_f32(reciprocal, vrecpsq_f32(denominator, reciprocal));
+            return vmulq_f32(numerator, reciprocal);
+        }
+
+        static inline float32x4_t Sqrt(float32x4_t x)
+        {
+            // Keeps the estimate finite at 0
+            const auto safe = vmaxq_f32(x, vdupq_n_f32(Arithmetic_Generic::c_MinAmplitude));
+            auto reciprocal = vrsqrteq_f32(safe);
+            reciprocal = vmulq_f32(reciprocal, vrsqrtsq_f32(vmulq_f32(safe, reciprocal), reciprocal));
+            reciprocal = vmulq_f32(reciprocal, vrsqrtsq_f32(vmulq_f32(safe, reciprocal), reciprocal));
+            return vmulq_f32(x, reciprocal);
+        }
+
+        // Same approximations as the SSE2 versions, see there
+        static inline float32x4_t Log2(float32x4_t x)
+        {
+            const auto bits = vreinterpretq_u32_f32(x);
+            auto exponent = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127));
+            auto mantissa = vreinterpretq_f32_u32(
+                vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007FFFFF)), vdupq_n_u32(0x3F800000)));
+
+            const auto high = vcgtq_f32(mantissa, vdupq_n_f32(1.41421356f));
+            mantissa = vbslq_f32(high, vmulq_n_f32(mantissa, 0.5f), mantissa);
+            exponent = vsubq_s32(exponent, vreinterpretq_s32_u32(high));
+
+            const auto one = vdupq_n_f32(1.0f);
+            const auto t = Divide(vsubq_f32(mantissa, one), vaddq_f32(mantissa, one));
+            const auto t2 = vmulq_f32(t, t);
+            auto poly = vmlaq_n_f32(vdupq_n_f32(0.57707802f), t2, 0.41219858f);
+            poly = vmlaq_f32(vdupq_n_f32(0.96179669f), poly, t2);
+            poly = vmlaq_f32(vdupq_n_f32(2.88539008f), poly, t2);
+            return vmlaq_f32(vcvtq_f32_s32(exponent), poly, t);
+        }
+
+        static inline float32x4_t Exp2(float32x4_t x)
+        {
+            // Round to nearest. The conversion truncates, which rounds negative values up, so step back to the floor.
+            const auto shifted = vaddq_f32(x, vdupq_n_f32(0.5f));
+            auto integer = vcvtq_s32_f32(shifted);
+            integer = vaddq_s32(integer, vreinterpretq_s32_u32(vcgtq_f32(vcvtq_f32_s32(integer), shifted)));
+
+            const auto f = vsubq_f32(x, vcvtq_f32_s32(integer));
+            auto poly = vmlaq_n_f32(vdupq_n_f32(1.5403530e-4f), f, 1.5252734e-5f);
+            poly = vmlaq_f32(vdupq_n_f32(1.3333558e-3f), poly, f);
+            poly = vmlaq_f32(vdupq_n_f32(9.6181291e-3f), poly, f);
+            poly = vmlaq_f32(vdupq_n_f32(5.5504109e-2f), poly, f);
+            poly = vmlaq_f32(vdupq_n_f32(0.24022651f), poly, f);
+            poly = vmlaq_f32(vdupq_n_f32(0.69314718f), poly, f);
+            poly = vmlaq_f32(vdupq_n_f32(1.0f), poly, f);
+            const auto scale = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(integer, vdupq_n_s32(127)), 23));
+            return vmulq_f32(poly, scale);
+        }
+
+        static inline float32x4_t Atan2(float32x4_t y, float32x4_t x)
+        {
+            const auto absY = vabsq_f32(y);
+            const auto absX = vabsq_f32(x);
+            const auto steep = vcgtq_f32(absY, absX);
+            const auto denominator =
+                vmaxq_f32(vmaxq_f32(absY, absX), vdupq_n_f32(Arithmetic_Generic::c_MinAmplitude));
+            auto a = Divide(vminq_f32(absY, absX), denominator);
+
+            const auto one = vdupq_n_f32(1.0f);
+            const auto reduce = vcgtq_f32(a, vdupq_n_f32(0.41421356f));
+            a = vbslq_f32(reduce, Divide(vsubq_f32(a, one), vaddq_f32(a, one)), a);
+            const auto offset = vbslq_f32(reduce, vdupq_n_f32(0.78539816f), vdupq_n_f32(0.0f));
+
+            const auto z = vmulq_f32(a, a);
+            auto poly = vmlaq_n_f32(vdupq_n_f32(-1.38776856032e-1f), z, 8.05374449538e-2f);
+            poly = vmlaq_f32(vdupq_n_f32(1.99777106478e-1f), poly, z);
+            poly = vmlaq_f32(vdupq_n_f32(-3.33329491539e-1f), poly, z);
+            auto angle = vaddq_f32(vmlaq_f32(a, vmulq_f32(poly, z), a), offset);
+
+            // Back to the octant of (x, y)
+            angle = vbslq_f32(steep, vsubq_f32(vdupq_n_f32(1.57079633f), angle), angle);
+            angle = vbslq_f32(vcltq_f32(x, vdupq_n_f32(0.0f)), vsubq_f32(vdupq_n_f32(3.14159265f), angle), angle);
+            const auto sign = vandq_u32(vreinterpretq_u32_f32(y), vdupq_n_u32(0x80000000));
+            return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(angle), sign));
+        }
+
+        void AmplitudeToDb_32f(float* pDst, const float* pSrc, size_t length)
+        {
+            const auto minAmplitude = vdupq_n_f32(Arithmetic_Generic::c_MinAmplitude);
+
+            size_t i = 0;
+            for (; i + 4 <= length; i += 4)
+            {
+                const auto amplitude = vmaxq_f32(vld1q_f32(pSrc + i), minAmplitude);
+                vst1q_f32(pDst + i, vmulq_n_f32(Log2(amplitude), 6.02059991f));
+            }
+
+            if (i < length)
+            {
+                Arithmetic_Generic::AmplitudeToDb_32f(pDst + i, pSrc + i, length - i);
+            }
+        }
+
+        void DbToAmplitude_32f(float* pDst, const float* pSrc, size_t length)
+        {
+            const auto minDb = vdupq_n_f32(Arithmetic_Generic::c_MinAmplitudeDb);
+            const auto maxDb = vdupq_n_f32(Arithmetic_Generic::c_MaxAmplitudeDb);
+
+            size_t i = 0;
+            for (; i + 4 <= length; i += 4)
+            {
+                const auto dB = vminq_f32(vmaxq_f32(vld1q_f32(pSrc + i), minDb), maxDb);
+                vst1q_f32(pDst + i, Exp2(vmulq_n_f32(dB, 0.166096405f)));
+            }
+
+            if (i < length)
+            {
+                Arithmetic_Generic::DbToAmplitude_32f(pDst + i, pSrc + i, length - i);
+            }
+        }
+
+        void VectorToSpherical_32f(
+            float* pAzimuth, float* pElevation, const float* pX, const float* pY, const float* pZ, size_t length)
+        {
+            const auto eps = vdupq_n_f32(1e-4f);
+            const auto fullCircle = vdupq_n_f32(360.0f);
+            const auto zero = vdupq_n_f32(0.0f);
+
+            size_t i = 0;
+            for (; i + 4 <= length; i += 4)
+            {
+                const auto x = vld1q_f32(pX + i);
+                const auto y = vld1q_f32(pY + i);
+                const auto z = vld1q_f32(pZ + i);
+                const auto horizontalLength = Sqrt(vmlaq_f32(vmulq_f32(x, x), z, z));
+
+                // 0-360 degrees, where rounding may turn a tiny negative angle into 360
+                auto azimuth = vmulq_n_f32(Atan2(vnegq_f32(x), vnegq_f32(z)), 57.2957795f);
+                azimuth = vaddq_f32(azimuth, vbslq_f32(vcltq_f32(azimuth, zero), fullCircle, zero));
+                azimuth = vbslq_f32(vcgeq_f32(azimuth, fullCircle), zero, azimuth);
+                azimuth = vbslq_f32(vcgtq_f32(horizontalLength, eps), azimuth, zero);
+
+                // -90-90 degrees
+                auto elevation = vmulq_n_f32(Atan2(y, horizontalLength), 57.2957795f);
+                elevation = vminq_f32(vmaxq_f32(elevation, vdupq_n_f32(-90.0f)), vdupq_n_f32(90.0f));
+                const auto lengthBound = vaddq_f32(horizontalLength, vabsq_f32(y));
+                elevation = vbslq_f32(vcgtq_f32(lengthBound, eps), elevation, zero);
+
+                vst1q_f32(pAzimuth + i, azimuth);
+                vst1q_f32(pElevation + i, elevation);
+            }
+
+            if (i < length)
+            {
+                Arithmetic_Generic::VectorToSpherical_32f(
+                    pAzimuth + i, pElevation + i, pX + i, pY + i, pZ + i, length - i);
+            }
+        }
+
+        void DownmixStereo_32f(float* pDst, const float* pSrc, size_t numChannels, float scale, size_t length)
+        {
+            size_t i = 0;
+            if (numChannels == 2)
+            {
+                for (; i + 4 <= length; i += 4)
+                {
+                    const auto frames = vld2q_f32(pSrc + 2 * i);
+                    vst1q_f32(pDst + i, vmulq_n_f32(vaddq_f32(frames.val[0], frames.val[1]), scale));
+                }
+            }
+            else if (numChannels == 4)
+            {
+                for (; i + 4 <= length; i += 4)
+                {
+                    const auto frames = vld4q_f32(pSrc + 4 * i);
+                    vst1q_f32(pDst + i, vmulq_n_f32(vaddq_f32(frames.val[0], frames.val[1]), scale));
+                }
+            }
+            else
+            {
+                // Wider frames, 6 and 8 channels included, only load the two channels that are summed
+                for (; i + 4 <= length; i += 4)
+                {
+                    const auto frame = pSrc + i * numChannels;
+                    const auto a = vcombine_f32(vld1_f32(frame), vld1_f32(frame + numChannels));
+                    const auto b = vcombine_f32(vld1_f32(frame + 2 * numChannels), vld1_f32(frame + 3 * numChannels));
+                    const auto channels = vuzpq_f32(a, b);
+                    vst1q_f32(pDst + i, vmulq_n_f32(vaddq_f32(channels.val[0], channels.val[1]), scale));
+                }
+            }
+
+            if (i < length)
+            {
+                Arithmetic_Generic::DownmixStereo_32f(pDst + i, pSrc + i * numChannels, numChannels, scale, length - i);
+            }
+        }
+
+        void DownmixCrossfade_32f(
+            float* pDownmix, float* pPassthrough, const float* pSrc, size_t numChannels, float startBlend,
+            float blendStep, size_t length)
+        {
+            const auto start = vdupq_n_f32(startBlend);
+            const auto one = vdupq_n_f32(1.0f);
+
+            // Frame numbers, counted from 1 so the last frame of the block lands on the end of the ramp
+            const float firstFrames[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+            auto frameNumbers = vld1q_f32(firstFrames);
+
+            size_t i = 0;
+            if (numChannels == 2)
+            {
+                for (; i + 4 <= length; i += 4)
+                {
+                    auto frames = vld2q_f32(pSrc + 2 * i);
+                    const auto blend = vmlaq_n_f32(start, frameNumbers, blendStep);
+                    const auto dryGain = vsubq_f32(one, blend);
+                    const auto sum = vaddq_f32(frames.val[0], frames.val[1]);
+                    vst1q_f32(pDownmix + i, vmulq_f32(vmulq_n_f32(sum, 0.5f), blend));
+                    frames.val[0] = vmulq_f32(frames.val[0], dryGain);
+                    frames.val[1] = vmulq_f32(frames.val[1], dryGain);
+                    vst2q_f32(pPassthrough + 2 * i, frames);
+                    frameNumbers = vaddq_f32(frameNumbers, vdupq_n_f32(4.0f));
+                }
+            }
+            else if (numChannels == 4)
+            {
+                for (; i + 4 <= length; i += 4)
+                {
+                    auto frames = vld4q_f32(pSrc + 4 * i);
+                    const auto blend = vmlaq_n_f32(start, frameNumbers, blendStep);
+                    const auto dryGain = vsubq_f32(one, blend);
+                    const auto sum = vaddq_f32(frames.val[0], frames.val[1]);
+                    vst1q_f32(pDownmix + i, vmulq_f32(vmulq_n_f32(sum, 0.5f), blend));
+                    for (auto channel = 0; channel < 4; channel++)
+                    {
+                        frames.val[channel] = vmulq_f32(frames.val[channel], dryGain);
+                    }
+                    vst4q_f32(pPassthrough + 4 * i, frames);
+                    frameNumbers = vaddq_f32(frameNumbers, vdupq_n_f32(4.0f));
+                }
+            }
+
+            if (i < length)
+            {
+                Arithmetic_Generic::DownmixCrossfade_32f(
+                    pDownmix + i, pPassthrough + i * numChannels, pSrc + i * numChannels, numChannels,
+                    startBlend + blendStep * static_cast<float>(i), blendStep, length - i);
+            }
+        }
     } // namespace Arithmetic_Neon
+
+    RealFft_Neon::RealFft_Neon(unsigned int order) : RealFft_Simd(order)
+    {
+    }
+
+    void RealFft_Neon::ForwardFft(
+        const float* timeDomainBuffer, size_t timeDomainLen, floatFC* freqDomainBuffer, size_t freqDomainLen) const
+    {
+        ValidateLengths(timeDomainLen, freqDomainLen);
+        RealFftKernels::ForwardFft<Arithmetic_Neon::FftOps>(m_Plan, timeDomainBuffer, freqDomainBuffer);
+    }
+
+    void RealFft_Neon::InverseFft(
+        const floatFC* freqDomainBuffer, size_t freqDomainLen, float* timeDomainBuffer, size_t timeDomainLen) const
+    {
+        ValidateLengths(timeDomainLen, freqDomainLen);
+        RealFftKernels::InverseFft<Arithmetic_Neon::FftOps>(m_Plan, freqDomainBuffer, timeDomainBuffer);
+    }
 } // namespace VectorMath
 
 #endif // defined(ARCH_ARM)
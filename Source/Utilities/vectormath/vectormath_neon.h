@@ -5,9 +5,25 @@
 
 #include "cputype.h"
 #if defined(ARCH_ARM) || defined(ARCH_ARM64)
+#include "vectormath_realfft.h"
 
 namespace VectorMath
 {
+    // Real FFT built from NEON split-radix kernels, see RealFftPlan. Requires RealFftPlan::IsSupportedOrder(order).
+    class RealFft_Neon final : public RealFft_Simd
+    {
+    public:
+        explicit RealFft_Neon(unsigned int order);
+
+        virtual void ForwardFft(
+            const float* timeDomainBuffer, size_t timeDomainLen, floatFC* freqDomainBuffer,
+            size_t freqDomainLen) const override;
+
+        virtual void InverseFft(
+            const floatFC* freqDomainBuffer, size_t freqDomainLen, float* timeDomainBuffer,
+            size_t timeDomainLen) const override;
+    };
+
     namespace Arithmetic_Neon
     {
         /* Sum two float vectors and store the result vector into the destination vector */
@@ -82,6 +98,37 @@ namespace VectorMath
 
         /* Find index of max element in vector */
         uint32_t FindMaxIndex_32f(_In_ float* pVec, _In_ size_t const length);
+
+        /* Apply a 3x4 affine transform to points stored as separate x, y and z arrays */
+        void TransformPoints_32f(
+            _Out_writes_(length) float* pDstX, _Out_writes_(length) float* pDstY, _Out_writes_(length) float* pDstZ,
+            _In_reads_(length) float const* pSrcX, _In_reads_(length) float const* pSrcY,
+            _In_reads_(length) float const* pSrcZ, _In_reads_(12) float const* pMatrix, _In_ size_t length);
+
+        /* Convert amplitudes to dB */
+        void AmplitudeToDb_32f(
+            _Out_writes_(length) float* pDst, _In_reads_(length) float const* pSrc, _In_ size_t length);
+
+        /* Convert dB to amplitudes */
+        void DbToAmplitude_32f(
+            _Out_writes_(length) float* pDst, _In_reads_(length) float const* pSrc, _In_ size_t length);
+
+        /* Convert direction vectors to azimuth and elevation in degrees */
+        void VectorToSpherical_32f(
+            _Out_writes_(length) float* pAzimuth, _Out_writes_(length) float* pElevation,
+            _In_reads_(length) float const* pX, _In_reads_(length) float const* pY,
+            _In_reads_(length) float const* pZ, _In_ size_t length);
+
+        /* Sum the first two channels of interleaved frames and scale the result */
+        void DownmixStereo_32f(
+            _Out_writes_(length) float* pDst, _In_reads_(length * numChannels) float const* pSrc,
+            _In_ size_t numChannels, _In_ float scale, _In_ size_t length);
+
+        /* Mono downmix and passthrough copy of interleaved frames, crossfaded by a linear blend ramp */
+        void DownmixCrossfade_32f(
+            _Out_writes_(length) float* pDownmix, _Out_writes_(length * numChannels) float* pPassthrough,
+            _In_reads_(length * numChannels) float const* pSrc, _In_ size_t numChannels, _In_ float startBlend,
+            _In_ float blendStep, _In_ size_t length);
     } // namespace Arithmetic_Neon
 } // namespace VectorMath
 
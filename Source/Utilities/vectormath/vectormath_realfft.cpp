@@ -0,0 +1,110 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "vectormath_realfft.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace VectorMath
+{
+    // Twiddles are computed in double precision so that large orders stay accurate
+    constexpr double c_TwoPiDouble = 6.283185307179586476925;
+
+    static uint32_t ReverseBits(uint32_t value, uint32_t numBits)
+    {
+        auto reversed = 0u;
+        for (auto i = 0u; i < numBits; ++i)
+        {
+            reversed = (reversed << 1) | ((value >> i) & 1u);
+        }
+        return reversed;
+    }
+
+    // Appends W_span^(multiple * j) for j < count as a run of real parts followed by a run of imaginary parts
+    static void AppendTwiddles(
+        AlignedStore::aligned_vector<float>& table, uint32_t span, uint32_t multiple, uint32_t count)
+    {
+        const auto start = table.size();
+        table.resize(start + 2 * count);
+        for (auto j = 0u; j < count; ++j)
+        {
+            const auto angle = c_TwoPiDouble * multiple * j / span;
+            table[start + j] = static_cast<float>(std::cos(angle));
+            table[start + count + j] = static_cast<float>(-std::sin(angle));
+        }
+    }
+
+    bool RealFftPlan::IsSupportedOrder(unsigned int order) noexcept
+    {
+        return order >= 32 && (order & (order - 1)) == 0;
+    }
+
+    RealFftPlan::RealFftPlan(unsigned int order) : Order(order), Length(order / 2), LengthLog(0)
+    {
+        if (!IsSupportedOrder(order))
+        {
+            throw std::invalid_argument("order");
+        }
+        while ((1u << LengthLog) < Length)
+        {
+            ++LengthLog;
+        }
+
+        // Same pass sequence as the kernels: an optional radix-2 pass, then radix-4 passes down to span 16
+        auto span = Length;
+        if (LengthLog % 2 != 0)
+        {
+            AppendTwiddles(PassTwiddles, span, 1, span / 2);
+            span /= 2;
+        }
+        for (; span > 4; span /= 4)
+        {
+            for (auto multiple = 1u; multiple <= 3; ++multiple)
+            {
+                AppendTwiddles(PassTwiddles, span, multiple, span / 4);
+            }
+        }
+
+        PostTwiddlesRe.resize(Length / 2);
+        PostTwiddlesIm.resize(Length / 2);
+        for (auto k = 0u; k < Length / 2; ++k)
+        {
+            const auto angle = c_TwoPiDouble * k / Order;
+            PostTwiddlesRe[k] = static_cast<float>(std::cos(angle));
+            PostTwiddlesIm[k] = static_cast<float>(-std::sin(angle));
+        }
+
+        GroupReverse.resize(Length / 16);
+        for (auto p = 0u; p < Length / 16; ++p)
+        {
+            GroupReverse[p] = ReverseBits(4 * p, LengthLog - 2);
+        }
+
+        WorkRe.resize(Length + 4);
+        WorkIm.resize(Length + 4);
+        OrderedRe.resize(Length + 4);
+        OrderedIm.resize(Length + 4);
+    }
+
+    RealFft_Simd::RealFft_Simd(unsigned int order) : m_Plan(order)
+    {
+    }
+
+    unsigned int RealFft_Simd::GetFreqDomainBufferLength() const noexcept
+    {
+        return m_Plan.Order / 2 + 1;
+    }
+
+    uint32_t RealFft_Simd::GetTimeDomainBufferLength() const noexcept
+    {
+        return m_Plan.Order;
+    }
+
+    void RealFft_Simd::ValidateLengths(size_t timeDomainLen, size_t freqDomainLen) const
+    {
+        if (freqDomainLen != (m_Plan.Order / 2 + 1) || timeDomainLen != m_Plan.Order)
+        {
+            throw std::invalid_argument(nullptr);
+        }
+    }
+} // namespace VectorMath
@@ -0,0 +1,58 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include "vectormath.h"
+#include "AlignedAllocator.h"
+
+namespace VectorMath
+{
+    // Precomputed tables and work areas of the SIMD real FFTs.
+    // A real FFT of order N is computed as a complex FFT of N/2 points, with the even samples as real parts and the
+    // odd samples as imaginary parts, followed by a post-twiddle pass that separates the two interleaved spectra.
+    // The complex FFT runs radix-2^2 decimation-in-frequency butterflies (the multiply count of radix-4) on split
+    // real/imaginary arrays, with one radix-2 pass first when log2(N/2) is odd. The last radix-4 pass is fused with
+    // the bit reversal permutation.
+    struct RealFftPlan final
+    {
+        explicit RealFftPlan(unsigned int order);
+
+        // The SIMD passes need at least four 4-point groups. Other orders are left to RealFft_generic.
+        static bool IsSupportedOrder(unsigned int order) noexcept;
+
+        uint32_t Order;
+        uint32_t Length;
+        uint32_t LengthLog;
+
+        // Twiddles of all butterfly passes in execution order, as runs of real and imaginary parts
+        AlignedStore::aligned_vector<float> PassTwiddles;
+
+        // W_N^k for k < N/4, used to separate the even and odd spectra
+        AlignedStore::aligned_vector<float> PostTwiddlesRe;
+        AlignedStore::aligned_vector<float> PostTwiddlesIm;
+
+        // Bit reversed index of every fourth 4-point group, read by the fused final pass
+        std::vector<uint32_t> GroupReverse;
+
+        // Split complex work areas. The ordered spectrum holds one extra wrapped element.
+        AlignedStore::aligned_vector<float> WorkRe;
+        AlignedStore::aligned_vector<float> WorkIm;
+        AlignedStore::aligned_vector<float> OrderedRe;
+        AlignedStore::aligned_vector<float> OrderedIm;
+    };
+
+    // Shared base of the architecture-specific real FFTs
+    class RealFft_Simd : public IRealFft
+    {
+    public:
+        explicit RealFft_Simd(unsigned int order);
+
+        virtual unsigned int GetFreqDomainBufferLength() const noexcept override;
+        virtual uint32_t GetTimeDomainBufferLength() const noexcept override;
+
+    protected:
+        void ValidateLengths(size_t timeDomainLen, size_t freqDomainLen) const;
+
+        mutable RealFftPlan m_Plan;
+    };
+} // namespace VectorMath
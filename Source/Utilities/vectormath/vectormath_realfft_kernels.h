@@ -0,0 +1,283 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+#pragma once
+
+#include "vectormath_realfft.h"
+
+// Real FFT passes written once against a 4-lane float vector abstraction.
+// Included by the architecture-specific sources, which provide the Ops type:
+//   Vector, Load, LoadU, Store, StoreU, Add, Sub, Mul, Set, Reverse, Transpose,
+//   LoadDeinterleave (8 floats into even and odd lanes) and StoreInterleave (the inverse).
+// All split complex buffers are 16-byte aligned, the caller's interleaved buffers need not be.
+namespace VectorMath
+{
+    namespace RealFftKernels
+    {
+        template <class Ops>
+        inline void ComplexMultiply(
+            typename Ops::Vector& re, typename Ops::Vector& im, typename Ops::Vector wr, typename Ops::Vector wi)
+        {
+            auto real = Ops::Sub(Ops::Mul(re, wr), Ops::Mul(im, wi));
+            im = Ops::Add(Ops::Mul(re, wi), Ops::Mul(im, wr));
+            re = real;
+        }
+
+        // Radix-2 pass over the whole sequence, only used when log2 of the length is odd
+        template <class Ops>
+        const float* Radix2Pass(float* re, float* im, uint32_t length, const float* twiddles)
+        {
+            const auto half = length / 2;
+            for (auto j = 0u; j < half; j += 4)
+            {
+                auto ar = Ops::Load(re + j);
+                auto ai = Ops::Load(im + j);
+                auto br = Ops::Load(re + j + half);
+                auto bi = Ops::Load(im + j + half);
+
+                Ops::Store(re + j, Ops::Add(ar, br));
+                Ops::Store(im + j, Ops::Add(ai, bi));
+
+                auto dr = Ops::Sub(ar, br);
+                auto di = Ops::Sub(ai, bi);
+                ComplexMultiply<Ops>(dr, di, Ops::Load(twiddles + j), Ops::Load(twiddles + half + j));
+                Ops::Store(re + j + half, dr);
+                Ops::Store(im + j + half, di);
+            }
+            return twiddles + length;
+        }
+
+        // Radix-2^2 pass: two radix-2 stages of span and span/2 merged into one butterfly on four quarters,
+        // so that only three of the four outputs need a twiddle. Outputs stay in bit reversed order.
+        template <class Ops>
+        const float* Radix4Pass(float* re, float* im, uint32_t length, uint32_t span, const float* twiddles)
+        {
+            const auto quarter = span / 4;
+            const auto w1r = twiddles;
+            const auto w1i = w1r + quarter;
+            const auto w2r = w1i + quarter;
+            const auto w2i = w2r + quarter;
+            const auto w3r = w2i + quarter;
+            const auto w3i = w3r + quarter;
+
+            for (auto group = 0u; group < length; group += span)
+            {
+                for (auto j = 0u; j < quarter; j += 4)
+                {
+                    const auto i0 = group + j;
+                    const auto i1 = i0 + quarter;
+                    const auto i2 = i1 + quarter;
+                    const auto i3 = i2 + quarter;
+
+                    auto x0r = Ops::Load(re + i0);
+                    auto x0i = Ops::Load(im + i0);
+                    auto x1r = Ops::Load(re + i1);
+                    auto x1i = Ops::Load(im + i1);
+                    auto x2r = Ops::Load(re + i2);
+                    auto x2i = Ops::Load(im + i2);
+                    auto x3r = Ops::Load(re + i3);
+                    auto x3i = Ops::Load(im + i3);
+
+                    auto s02r = Ops::Add(x0r, x2r);
+                    auto s02i = Ops::Add(x0i, x2i);
+                    auto d02r = Ops::Sub(x0r, x2r);
+                    auto d02i = Ops::Sub(x0i, x2i);
+                    auto s13r = Ops::Add(x1r, x3r);
+                    auto s13i = Ops::Add(x1i, x3i);
+                    auto d13r = Ops::Sub(x1r, x3r);
+                    auto d13i = Ops::Sub(x1i, x3i);
+
+                    Ops::Store(re + i0, Ops::Add(s02r, s13r));
+                    Ops::Store(im + i0, Ops::Add(s02i, s13i));
+
+                    auto y1r = Ops::Sub(s02r, s13r);
+                    auto y1i = Ops::Sub(s02i, s13i);
+                    ComplexMultiply<Ops>(y1r, y1i, Ops::Load(w2r + j), Ops::Load(w2i + j));
+                    Ops::Store(re + i1, y1r);
+                    Ops::Store(im + i1, y1i);
+
+                    // d02 +/- (-i * d13)
+                    auto y2r = Ops::Add(d02r, d13i);
+                    auto y2i = Ops::Sub(d02i, d13r);
+                    ComplexMultiply<Ops>(y2r, y2i, Ops::Load(w1r + j), Ops::Load(w1i + j));
+                    Ops::Store(re + i2, y2r);
+                    Ops::Store(im + i2, y2i);
+
+                    auto y3r = Ops::Sub(d02r, d13i);
+                    auto y3i = Ops::Add(d02i, d13r);
+                    ComplexMultiply<Ops>(y3r, y3i, Ops::Load(w3r + j), Ops::Load(w3i + j));
+                    Ops::Store(re + i3, y3r);
+                    Ops::Store(im + i3, y3i);
+                }
+            }
+            return twiddles + 6 * quarter;
+        }
+
+        // Last radix-4 pass, on 4-point groups, fused with the bit reversal permutation.
+        // Index 4h + l lands at rev2(l) * length / 4 + rev(h). Loading the four groups h whose reversed indices are
+        // consecutive and transposing them puts each output vector at a contiguous, aligned destination.
+        template <class Ops>
+        void FinalPassBitReverse(
+            const RealFftPlan& plan, const float* re, const float* im, float* orderedRe, float* orderedIm)
+        {
+            const auto length = plan.Length;
+            const auto quarter = length / 4;
+            const auto reverse1 = 1u << (plan.LengthLog - 3);
+            const auto reverse2 = 1u << (plan.LengthLog - 4);
+
+            for (auto p = 0u; p < length / 16; ++p)
+            {
+                const auto h0 = 4 * plan.GroupReverse[p];
+                const auto h1 = h0 + 4 * reverse1;
+                const auto h2 = h0 + 4 * reverse2;
+                const auto h3 = h1 + 4 * reverse2;
+
+                auto x0r = Ops::Load(re + h0);
+                auto x1r = Ops::Load(re + h1);
+                auto x2r = Ops::Load(re + h2);
+                auto x3r = Ops::Load(re + h3);
+                auto x0i = Ops::Load(im + h0);
+                auto x1i = Ops::Load(im + h1);
+                auto x2i = Ops::Load(im + h2);
+                auto x3i = Ops::Load(im + h3);
+                Ops::Transpose(x0r, x1r, x2r, x3r);
+                Ops::Transpose(x0i, x1i, x2i, x3i);
+
+                auto s02r = Ops::Add(x0r, x2r);
+                auto s02i = Ops::Add(x0i, x2i);
+                auto d02r = Ops::Sub(x0r, x2r);
+                auto d02i = Ops::Sub(x0i, x2i);
+                auto s13r = Ops::Add(x1r, x3r);
+                auto s13i = Ops::Add(x1i, x3i);
+                auto d13r = Ops::Sub(x1r, x3r);
+                auto d13i = Ops::Sub(x1i, x3i);
+
+                const auto offset = 4 * p;
+                Ops::Store(orderedRe + offset, Ops::Add(s02r, s13r));
+                Ops::Store(orderedIm + offset, Ops::Add(s02i, s13i));
+                Ops::Store(orderedRe + 2 * quarter + offset, Ops::Sub(s02r, s13r));
+                Ops::Store(orderedIm + 2 * quarter + offset, Ops::Sub(s02i, s13i));
+                Ops::Store(orderedRe + quarter + offset, Ops::Add(d02r, d13i));
+                Ops::Store(orderedIm + quarter + offset, Ops::Sub(d02i, d13r));
+                Ops::Store(orderedRe + 3 * quarter + offset, Ops::Sub(d02r, d13i));
+                Ops::Store(orderedIm + 3 * quarter + offset, Ops::Add(d02i, d13r));
+            }
+        }
+
+        // Forward complex FFT of plan.Length points. Destroys re and im, writes natural order to ordered.
+        template <class Ops>
+        void ComplexFft(const RealFftPlan& plan, float* re, float* im, float* orderedRe, float* orderedIm)
+        {
+            auto twiddles = plan.PassTwiddles.data();
+            auto span = plan.Length;
+            if (plan.LengthLog % 2 != 0)
+            {
+                twiddles = Radix2Pass<Ops>(re, im, span, twiddles);
+                span /= 2;
+            }
+            for (; span > 4; span /= 4)
+            {
+                twiddles = Radix4Pass<Ops>(re, im, plan.Length, span, twiddles);
+            }
+            FinalPassBitReverse<Ops>(plan, re, im, orderedRe, orderedIm);
+        }
+
+        template <class Ops>
+        void ForwardFft(RealFftPlan& plan, const float* timeDomain, floatFC* freqDomain)
+        {
+            const auto length = plan.Length;
+            auto re = plan.WorkRe.data();
+            auto im = plan.WorkIm.data();
+            for (auto n = 0u; n < length; n += 4)
+            {
+                typename Ops::Vector even, odd;
+                Ops::LoadDeinterleave(timeDomain + 2 * n, even, odd);
+                Ops::Store(re + n, even);
+                Ops::Store(im + n, odd);
+            }
+
+            auto zr = plan.OrderedRe.data();
+            auto zi = plan.OrderedIm.data();
+            ComplexFft<Ops>(plan, re, im, zr, zi);
+            zr[length] = zr[0];
+            zi[length] = zi[0];
+
+            // With A = Z[k] and B = conj(Z[N/2 - k]), the even spectrum is (A + B) / 2 and the odd spectrum
+            // (A - B) / 2i. X[k] = E + W^k O and X[N/2 - k] = conj(E - W^k O).
+            auto output = reinterpret_cast<float*>(freqDomain);
+            const auto half = Ops::Set(0.5f);
+            for (auto k = 0u; k < length / 2; k += 4)
+            {
+                auto ar = Ops::Load(zr + k);
+                auto ai = Ops::Load(zi + k);
+                auto br = Ops::Reverse(Ops::LoadU(zr + length - k - 3));
+                auto bi = Ops::Reverse(Ops::LoadU(zi + length - k - 3));
+
+                auto er = Ops::Mul(Ops::Add(ar, br), half);
+                auto ei = Ops::Mul(Ops::Sub(ai, bi), half);
+                auto tr = Ops::Mul(Ops::Add(ai, bi), half);
+                auto ti = Ops::Mul(Ops::Sub(br, ar), half);
+                auto wr = Ops::Load(plan.PostTwiddlesRe.data() + k);
+                auto wi = Ops::Load(plan.PostTwiddlesIm.data() + k);
+                ComplexMultiply<Ops>(tr, ti, wr, wi);
+
+                Ops::StoreInterleave(output + 2 * k, Ops::Add(er, tr), Ops::Add(ei, ti));
+                Ops::StoreInterleave(
+                    output + 2 * (length - k - 3), Ops::Reverse(Ops::Sub(er, tr)), Ops::Reverse(Ops::Sub(ti, ei)));
+            }
+
+            // W^(N/4) = -i, which leaves X[N/4] = conj(Z[N/4])
+            output[length] = zr[length / 2];
+            output[length + 1] = -zi[length / 2];
+        }
+
+        template <class Ops>
+        void InverseFft(RealFftPlan& plan, const floatFC* freqDomain, float* timeDomain)
+        {
+            const auto length = plan.Length;
+            auto input = reinterpret_cast<const float*>(freqDomain);
+            auto re = plan.WorkRe.data();
+            auto im = plan.WorkIm.data();
+
+            // Rebuild 2 * Z[k] = E + iO from X[k] and X[N/2 - k], then conjugate so that the forward transform
+            // computes the inverse. The 1 / N scale is folded in here.
+            const auto scale = Ops::Set(1.0f / plan.Order);
+            const auto negativeScale = Ops::Set(-1.0f / plan.Order);
+            for (auto k = 0u; k < length / 2; k += 4)
+            {
+                typename Ops::Vector ar, ai, br, bi;
+                Ops::LoadDeinterleave(input + 2 * k, ar, ai);
+                Ops::LoadDeinterleave(input + 2 * (length - k - 3), br, bi);
+                br = Ops::Reverse(br);
+                bi = Ops::Reverse(bi);
+
+                auto evenRe = Ops::Add(ar, br);
+                auto evenIm = Ops::Sub(ai, bi);
+                auto oddRe = Ops::Sub(ar, br);
+                auto oddIm = Ops::Add(ai, bi);
+
+                // O = conj(W^k) * (A - conj(B))
+                auto wr = Ops::Load(plan.PostTwiddlesRe.data() + k);
+                auto wi = Ops::Sub(Ops::Set(0.0f), Ops::Load(plan.PostTwiddlesIm.data() + k));
+                ComplexMultiply<Ops>(oddRe, oddIm, wr, wi);
+
+                Ops::Store(re + k, Ops::Mul(Ops::Sub(evenRe, oddIm), scale));
+                Ops::Store(im + k, Ops::Mul(Ops::Add(evenIm, oddRe), negativeScale));
+                Ops::StoreU(re + length - k - 3, Ops::Reverse(Ops::Mul(Ops::Add(evenRe, oddIm), scale)));
+                Ops::StoreU(im + length - k - 3, Ops::Reverse(Ops::Mul(Ops::Sub(evenIm, oddRe), scale)));
+            }
+            re[length / 2] = 2.0f * input[length] / plan.Order;
+            im[length / 2] = 2.0f * input[length + 1] / plan.Order;
+
+            auto zr = plan.OrderedRe.data();
+            auto zi = plan.OrderedIm.data();
+            ComplexFft<Ops>(plan, re, im, zr, zi);
+
+            // Undo the conjugation: even samples are the real parts, odd samples the negated imaginary parts
+            const auto zero = Ops::Set(0.0f);
+            for (auto n = 0u; n < length; n += 4)
+            {
+                Ops::StoreInterleave(timeDomain + 2 * n, Ops::Load(zr + n), Ops::Sub(zero, Ops::Load(zi + n)));
+            }
+        }
+    } // namespace RealFftKernels
+} // namespace VectorMath
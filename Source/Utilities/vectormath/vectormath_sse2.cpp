@@ -3,7 +3,9 @@
 #include "cputype.h"
 #if defined(ARCH_X86) || defined(ARCH_X64)
 #include "vectormath.h"
+#include "vectormath_generic.h"
 #include "vectormath_sse2.h"
+#include "vectormath_realfft_kernels.h"
 #include <cstring>
 #include <cmath>
 // SSE2 header
@@ -16,6 +18,65 @@ namespace VectorMath
 {
     namespace Arithmetic_Sse2
     {
+        // 4-lane vector operations for the shared real FFT kernels
+        struct FftOps
+        {
+            using Vector = __m128;
+
+            static Vector Load(const float* p)
+            {
+                return _mm_load_ps(p);
+            }
+            static Vector LoadU(const float* p)
+            {
+                return _mm_loadu_ps(p);
+            }
+            static void Store(float* p, Vector v)
+            {
+                _mm_store_ps(p, v);
+            }
+            static void StoreU(float* p, Vector v)
+            {
+                _mm_storeu_ps(p, v);
+            }
+            static Vector Add(Vector a, Vector b)
+            {
+                return _mm_add_ps(a, b);
+            }
+            static Vector Sub(Vector a, Vector b)
+            {
+                return _mm_sub_ps(a, b);
+            }
+            static Vector Mul(Vector a, Vector b)
+            {
+                return _mm_mul_ps(a, b);
+            }
+            static Vector Set(float value)
+            {
+                return _mm_set1_ps(value);
+            }
+            static Vector Reverse(Vector v)
+            {
+                return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+            }
+            static void Transpose(Vector& a, Vector& b, Vector& c, Vector& d)
+            {
+                _MM_TRANSPOSE4_PS(a, b, c, d);
+            }
+            static void LoadDeinterleave(const float* p, Vector& even, Vector& odd)
+            {
+                auto low = _mm_loadu_ps(p);
+                auto high = _mm_loadu_ps(p + 4);
+                even = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+                odd = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+            }
+            static void StoreInterleave(float* p, Vector even, Vector odd)
+            {
+                _mm_storeu_ps(p, _mm_unpacklo_ps(even, odd));
+                _mm_storeu_ps(p + 4, _mm_unpackhi_ps(even, odd));
+            }
+        };
+
         inline void addps(__m128& dst, __m128& src)
         {
             dst = _mm_add_ps(dst, src);
@@ -1205,6 +1266,328 @@ namespace VectorMath
 
             return finalResult;
         }
+
+        _Use_decl_annotations_ void TransformPoints_32f(
+            float* pDstX, float* pDstY, float* pDstZ, float const* pSrcX, float const* pSrcY, float const* pSrcZ,
+            float const* pMatrix, size_t length)
+        {
+            __m128 m[12];
+            for (auto j = 0; j < 12; ++j)
+            {
+                m[j] = _mm_set1_ps(pMatrix[j]);
+            }
+
+            size_t i = 0;
+            for (; i + 4 <= length; i += 4)
+            {
+                const auto x = _mm_loadu_ps(pSrcX + i);
+                const auto y = _mm_loadu_ps(pSrcY + i);
+                const auto z = _mm_loadu_ps(pSrcZ + i);
+                const auto outX = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(m[0], x), _mm_mul_ps(m[1], y)), _mm_add_ps(_mm_mul_ps(m[2], z), m[3]));
+                const auto outY = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(m[4], x), _mm_mul_ps(m[5], y)), _mm_add_ps(_mm_mul_ps(m[6], z), m[7]));
+                const auto outZ = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(m[8], x), _mm_mul_ps(m[9], y)), _mm_add_ps(_mm_mul_ps(m[10], z), m[11]));
+                _mm_storeu_ps(pDstX + i, outX);
+                _mm_storeu_ps(pDstY + i, outY);
+                _mm_storeu_ps(pDstZ + i, outZ);
+            }
+
+            if (i < length)
+            {
+                Arithmetic_Generic::TransformPoints_32f(
+                    pDstX + i, pDstY + i, pDstZ + i, pSrcX + i, pSrcY + i, pSrcZ + i, pMatrix, length - i);
+            }
+        }
+
+        // log2 of positive normal floats. The exponent is taken from the bits, and the mantissa, moved to
+        // [sqrt(0.5), sqrt(2)), goes through the atanh series 2 / ln(2) * (t + t^3 / 3 + ...) with
+        // t = (m - 1) / (m + 1). The series is cut after t^7, which leaves an error below 1e-7.
+        static inline __m128 Log2(__m128 x)
+        {
+            const auto bits = _mm_castps_si128(x);
+            auto exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+            auto mantissa = _mm_castsi128_ps(
+                _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+
+            const auto high = _mm_cmpgt_ps(mantissa, _mm_set1_ps(1.41421356f));
+            mantissa = _mm_or_ps(
+                _mm_and_ps(high, _mm_mul_ps(mantissa, _mm_set1_ps(0.5f))), _mm_andnot_ps(high, mantissa));
+            exponent = _mm_sub_epi32(exponent, _mm_castps_si128(high));
+
+            const auto one = _mm_set1_ps(1.0f);
+            const auto t = _mm_div_ps(_mm_sub_ps(mantissa, one), _mm_add_ps(mantissa, one));
+            const auto t2 = _mm_mul_ps(t, t);
+            auto poly = _mm_add_ps(_mm_mul_ps(t2, _mm_set1_ps(0.41219858f)), _mm_set1_ps(0.57707802f));
+            poly = _mm_add_ps(_mm_mul_ps(poly, t2), _mm_set1_ps(0.96179669f));
+            poly = _mm_add_ps(_mm_mul_ps(poly, t2), _mm_set1_ps(2.88539008f));
+            return _mm_add_ps(_mm_cvtepi32_ps(exponent), _mm_mul_ps(poly, t));
+        }
+
+        // 2^x for x in [-126, 127]. The integer part goes to the exponent bits, 2^f for the fraction in [-0.5, 0.5]
+        // is the Taylor series of e^(f * ln(2)) up to f^7, with an error below 1e-8.
+        static inline __m128 Exp2(__m128 x)
+        {
+            const auto integer = _mm_cvtps_epi32(x);
+            const auto f = _mm_sub_ps(x, _mm_cvtepi32_ps(integer));
+            auto poly = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(1.5252734e-5f)), _mm_set1_ps(1.5403530e-4f));
+            poly = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(1.3333558e-3f));
+            poly = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(9.6181291e-3f));
+            poly = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(5.5504109e-2f));
+            poly = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(0.24022651f));
+            poly = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(0.69314718f));
+            poly = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(1.0f));
+            const auto scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(integer, _mm_set1_epi32(127)), 23));
+            return _mm_mul_ps(poly, scale);
+        }
+
+        // atan2 in radians. The ratio of the smaller to the larger magnitude is reduced to [0, tan(pi / 8)] and goes
+        // through the Cephes atanf polynomial, then the octant is restored. Accurate to about 1e-7 radians.
+        static inline __m128 Atan2(__m128 y, __m128 x)
+        {
+            const auto signMask = _mm_set1_ps(-0.0f);
+            const auto absY = _mm_andnot_ps(signMask, y);
+            const auto absX = _mm_andnot_ps(signMask, x);
+            const auto steep = _mm_cmpgt_ps(absY, absX);
+            const auto numerator = _mm_min_ps(absY, absX);
+            const auto denominator =
+                _mm_max_ps(_mm_max_ps(absY, absX), _mm_set1_ps(Arithmetic_Generic::c_MinAmplitude));
+            auto a = _mm_div_ps(numerator, denominator);
+
+            const auto one = _mm_set1_ps(1.0f);
+            const auto reduce = _mm_cmpgt_ps(a, _mm_set1_ps(0.41421356f));
+            a = _mm_or_ps(
+                _mm_and_ps(reduce, _mm_div_ps(_mm_sub_ps(a, one), _mm_add_ps(a, one))), _mm_andnot_ps(reduce, a));
+            const auto offset = _mm_and_ps(reduce, _mm_set1_ps(0.78539816f));
+
+            const auto z = _mm_mul_ps(a, a);
+            auto poly = _mm_sub_ps(_mm_mul_ps(z, _mm_set1_ps(8.05374449538e-2f)), _mm_set1_ps(1.38776856032e-1f));
+            poly = _mm_add_ps(_mm_mul_ps(poly, z), _mm_set1_ps(1.99777106478e-1f));
+            poly = _mm_sub_ps(_mm_mul_ps(poly, z), _mm_set1_ps(3.33329491539e-1f));
+            auto angle = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(poly, z), a), a), offset);
+
+            // Back to the octant of (x, y)
+            const auto halfPi = _mm_set1_ps(1.57079633f);
+            angle = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(halfPi, angle)), _mm_andnot_ps(steep, angle));
+            const auto negativeX = _mm_cmplt_ps(x, _mm_setzero_ps());
+            const auto pi = _mm_set1_ps(3.14159265f);
+            angle = _mm_or_ps(_mm_and_ps(negativeX, _mm_sub_ps(pi, angle)), _mm_andnot_ps(negativeX, angle));
+            return _mm_or_ps(angle, _mm_and_ps(signMask, y));
+        }
+
+        _Use_decl_annotations_ void AmplitudeToDb_32f(float* pDst, float const* pSrc, size_t length)
+        {
+            const auto minAmplitude = _mm_set1_ps(Arithmetic_Generic::c_MinAmplitude);
+            const auto dbPerOctave = _mm_set1_ps(6.02059991f);
+
+            size_t i = 0;
+            for (; i + 4 <= length; i += 4)
+            {
+                const auto amplitude = _mm_max_ps(_mm_loadu_ps(pSrc + i), minAmplitude);
+                _mm_storeu_ps(pDst + i, _mm_mul_ps(Log2(amplitude), dbPerOctave));
+            }
+
+            if (i < length)
+            {
+                Arithmetic_Generic::AmplitudeToDb_32f(pDst + i, pSrc + i, length - i);
+            }
+        }
+
+        _Use_decl_annotations_ void DbToAmplitude_32f(float* pDst, float const* pSrc, size_t length)
+        {
+            const auto minDb = _mm_set1_ps(Arithmetic_Generic::c_MinAmplitudeDb);
+            const auto maxDb = _mm_set1_ps(Arithmetic_Generic::c_MaxAmplitudeDb);
+            const auto octavesPerDb = _mm_set1_ps(0.166096405f);
+
+            size_t i = 0;
+            for (; i + 4 <= length; i += 4)
+            {
+                const auto dB = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pSrc + i), minDb), maxDb);
+                _mm_storeu_ps(pDst + i, Exp2(_mm_mul_ps(dB, octavesPerDb)));
+            }
+
+            if (i < length)
+            {
+                Arithmetic_Generic::DbToAmplitude_32f(pDst + i, pSrc + i, length - i);
+            }
+        }
+
+        _Use_decl_annotations_ void VectorToSpherical_32f(
+            float* pAzimuth, float* pElevation, float const* pX, float const* pY, float const* pZ, size_t length)
+        {
+            const auto eps = _mm_set1_ps(1e-4f);
+            const auto radianToDeg = _mm_set1_ps(57.2957795f);
+            const auto fullCircle = _mm_set1_ps(360.0f);
+            const auto quarterCircle = _mm_set1_ps(90.0f);
+            const auto zero = _mm_setzero_ps();
+            const auto signMask = _mm_set1_ps(-0.0f);
+
+            size_t i = 0;
+            for (; i + 4 <= length; i += 4)
+            {
+                const auto x = _mm_loadu_ps(pX + i);
+                const auto y = _mm_loadu_ps(pY + i);
+                const auto z = _mm_loadu_ps(pZ + i);
+                const auto horizontalLength = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(z, z)));
+
+                // 0-360 degrees, where rounding may turn a tiny negative angle into 360
+                auto azimuth = _mm_mul_ps(Atan2(_mm_xor_ps(x, signMask), _mm_xor_ps(z, signMask)), radianToDeg);
+                azimuth = _mm_add_ps(azimuth, _mm_and_ps(_mm_cmplt_ps(azimuth, zero), fullCircle));
+                azimuth = _mm_andnot_ps(_mm_cmpge_ps(azimuth, fullCircle), azimuth);
+                azimuth = _mm_and_ps(_mm_cmpgt_ps(horizontalLength, eps), azimuth);
+
+                // -90-90 degrees
+                auto elevation = _mm_mul_ps(Atan2(y, horizontalLength), radianToDeg);
+                elevation = _mm_min_ps(_mm_max_ps(elevation, _mm_sub_ps(zero, quarterCircle)), quarterCircle);
+                const auto lengthBound = _mm_add_ps(horizontalLength, _mm_andnot_ps(signMask, y));
+                elevation = _mm_and_ps(_mm_cmpgt_ps(lengthBound, eps), elevation);
+
+                _mm_storeu_ps(pAzimuth + i, azimuth);
+                _mm_storeu_ps(pElevation + i, elevation);
+            }
+
+            if (i < length)
+            {
+                Arithmetic_Generic::VectorToSpherical_32f(
+                    pAzimuth + i, pElevation + i, pX + i, pY + i, pZ + i, length - i);
+            }
+        }
+
+        _Use_decl_annotations_ void
+        DownmixStereo_32f(float* pDst, float const* pSrc, size_t numChannels, float scale, size_t length)
+        {
+            const auto scaleVec = _mm_set1_ps(scale);
+
+            size_t i = 0;
+            if (numChannels == 2)
+            {
+                for (; i + 4 <= length; i += 4)
+                {
+                    const auto a = _mm_loadu_ps(pSrc + 2 * i);
+                    const auto b = _mm_loadu_ps(pSrc + 2 * i + 4);
+                    const auto left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                    const auto right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+                    _mm_storeu_ps(pDst + i, _mm_mul_ps(_mm_add_ps(left, right), scaleVec));
+                }
+            }
+            else if (numChannels == 4)
+            {
+                for (; i + 4 <= length; i += 4)
+                {
+                    // Half a 4x4 transpose, channels 2 and 3 are dropped
+                    const auto frames01 = _mm_unpacklo_ps(_mm_loadu_ps(pSrc + 4 * i), _mm_loadu_ps(pSrc + 4 * i + 4));
+                    const auto frames23 =
+                        _mm_unpacklo_ps(_mm_loadu_ps(pSrc + 4 * i + 8), _mm_loadu_ps(pSrc + 4 * i + 12));
+                    const auto left = _mm_movelh_ps(frames01, frames23);
+                    const auto right = _mm_movehl_ps(frames23, frames01);
+                    _mm_storeu_ps(pDst + i, _mm_mul_ps(_mm_add_ps(left, right), scaleVec));
+                }
+            }
+            else
+            {
+                // Wider frames, 6 and 8 channels included, only load the two channels that are summed
+                for (; i + 4 <= length; i += 4)
+                {
+                    const auto frame = pSrc + i * numChannels;
+                    auto a = _mm_setzero_ps();
+                    auto b = _mm_setzero_ps();
+                    a = _mm_loadl_pi(a, reinterpret_cast<const __m64*>(frame));
+                    a = _mm_loadh_pi(a, reinterpret_cast<const __m64*>(frame + numChannels));
+                    b = _mm_loadl_pi(b, reinterpret_cast<const __m64*>(frame + 2 * numChannels));
+                    b = _mm_loadh_pi(b, reinterpret_cast<const __m64*>(frame + 3 * numChannels));
+                    const auto left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                    const auto right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+                    _mm_storeu_ps(pDst + i, _mm_mul_ps(_mm_add_ps(left, right), scaleVec));
+                }
+            }
+
+            if (i < length)
+            {
+                Arithmetic_Generic::DownmixStereo_32f(pDst + i, pSrc + i * numChannels, numChannels, scale, length - i);
+            }
+        }
+
+        _Use_decl_annotations_ void DownmixCrossfade_32f(
+            float* pDownmix, float* pPassthrough, float const* pSrc, size_t numChannels, float startBlend,
+            float blendStep, size_t length)
+        {
+            const auto start = _mm_set1_ps(startBlend);
+            const auto step = _mm_set1_ps(blendStep);
+            const auto half = _mm_set1_ps(0.5f);
+            const auto one = _mm_set1_ps(1.0f);
+
+            // Frame numbers, counted from 1 so the last frame of the block lands on the end of the ramp. Exact as
+            // floats for any realistic block.
+            auto frameNumbers = _mm_set_ps(4.0f, 3.0f, 2.0f, 1.0f);
+            const auto four = _mm_set1_ps(4.0f);
+
+            size_t i = 0;
+            if (numChannels == 2)
+            {
+                for (; i + 4 <= length; i += 4)
+                {
+                    const auto a = _mm_loadu_ps(pSrc + 2 * i);
+                    const auto b = _mm_loadu_ps(pSrc + 2 * i + 4);
+                    const auto blend = _mm_add_ps(start, _mm_mul_ps(step, frameNumbers));
+                    const auto dryGain = _mm_sub_ps(one, blend);
+                    const auto sum = _mm_add_ps(
+                        _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+                    _mm_storeu_ps(pDownmix + i, _mm_mul_ps(_mm_mul_ps(sum, half), blend));
+                    _mm_storeu_ps(pPassthrough + 2 * i, _mm_mul_ps(a, _mm_unpacklo_ps(dryGain, dryGain)));
+                    _mm_storeu_ps(pPassthrough + 2 * i + 4, _mm_mul_ps(b, _mm_unpackhi_ps(dryGain, dryGain)));
+                    frameNumbers = _mm_add_ps(frameNumbers, four);
+                }
+            }
+            else if (numChannels == 4)
+            {
+                for (; i + 4 <= length; i += 4)
+                {
+                    const auto f0 = _mm_loadu_ps(pSrc + 4 * i);
+                    const auto f1 = _mm_loadu_ps(pSrc + 4 * i + 4);
+                    const auto f2 = _mm_loadu_ps(pSrc + 4 * i + 8);
+                    const auto f3 = _mm_loadu_ps(pSrc + 4 * i + 12);
+                    const auto blend = _mm_add_ps(start, _mm_mul_ps(step, frameNumbers));
+                    const auto dryGain = _mm_sub_ps(one, blend);
+
+                    const auto frames01 = _mm_unpacklo_ps(f0, f1);
+                    const auto frames23 = _mm_unpacklo_ps(f2, f3);
+                    const auto sum = _mm_add_ps(_mm_movelh_ps(frames01, frames23), _mm_movehl_ps(frames23, frames01));
+                    _mm_storeu_ps(pDownmix + i, _mm_mul_ps(_mm_mul_ps(sum, half), blend));
+
+                    _mm_storeu_ps(pPassthrough + 4 * i, _mm_mul_ps(f0, _mm_shuffle_ps(dryGain, dryGain, 0x00)));
+                    _mm_storeu_ps(pPassthrough + 4 * i + 4, _mm_mul_ps(f1, _mm_shuffle_ps(dryGain, dryGain, 0x55)));
+                    _mm_storeu_ps(pPassthrough + 4 * i + 8, _mm_mul_ps(f2, _mm_shuffle_ps(dryGain, dryGain, 0xAA)));
+                    _mm_storeu_ps(pPassthrough + 4 * i + 12, _mm_mul_ps(f3, _mm_shuffle_ps(dryGain, dryGain, 0xFF)));
+                    frameNumbers = _mm_add_ps(frameNumbers, four);
+                }
+            }
+
+            if (i < length)
+            {
+                Arithmetic_Generic::DownmixCrossfade_32f(
+                    pDownmix + i, pPassthrough + i * numChannels, pSrc + i * numChannels, numChannels,
+                    startBlend + blendStep * static_cast<float>(i), blendStep, length - i);
+            }
+        }
     } // namespace Arithmetic_Sse2
+
+    RealFft_Sse2::RealFft_Sse2(unsigned int order) : RealFft_Simd(order)
+    {
+    }
+
+    void RealFft_Sse2::ForwardFft(
+        const float* timeDomainBuffer, size_t timeDomainLen, floatFC* freqDomainBuffer, size_t freqDomainLen) const
+    {
+        ValidateLengths(timeDomainLen, freqDomainLen);
+        RealFftKernels::ForwardFft<Arithmetic_Sse2::FftOps>(m_Plan, timeDomainBuffer, freqDomainBuffer);
+    }
+
+    void RealFft_Sse2::InverseFft(
+        const floatFC* freqDomainBuffer, size_t freqDomainLen, float* timeDomainBuffer, size_t timeDomainLen) const
+    {
+        ValidateLengths(timeDomainLen, freqDomainLen);
+        RealFftKernels::InverseFft<Arithmetic_Sse2::FftOps>(m_Plan, freqDomainBuffer, timeDomainBuffer);
+    }
 } // namespace VectorMath
 #endif // defined(ARCH_X86) || defined(ARCH_X64)
\ No newline at end of file
@@ -18,6 +18,18 @@ namespace VectorMath
         return 16;
     }
 
+    // Instruction set used by the Arithmetic functions. On x86/x64 it is selected from the CPU features at load time.
+    enum class ArithmeticIsa
+    {
+        Generic,
+        Neon,
+        Sse2,
+        Avx2,
+        Avx512
+    };
+
+    ArithmeticIsa GetArithmeticIsa() noexcept;
+
     // Factory function returns platform-specific implementation
     std::unique_ptr<IRealFft> CreateRealFft(unsigned int order);
 
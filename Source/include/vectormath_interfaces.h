@@ -116,6 +116,47 @@ namespace VectorMath
         /* Find index of max element in vector */
         uint32_t FindMaxIndex_32f(_In_ float* pVec, _In_ size_t const length);
 
+        /* Apply a 3x4 affine transform to points stored as separate x, y and z arrays. pMatrix holds the rows of
+        the transform, so that x' = m[0] * x + m[1] * y + m[2] * z + m[3]. Destinations may alias the sources. */
+        void TransformPoints_32f(
+            _Out_writes_(length) float* pDstX, _Out_writes_(length) float* pDstY, _Out_writes_(length) float* pDstZ,
+            _In_reads_(length) float const* pSrcX, _In_reads_(length) float const* pSrcY,
+            _In_reads_(length) float const* pSrcZ, _In_reads_(12) float const* pMatrix, _In_ size_t length);
+
+        /* Convert amplitudes to dB, 20 * log10(amplitude). Amplitudes below FLT_MIN, including zero and negative
+        values, give the dB of FLT_MIN instead of -inf or NaN. SIMD versions are within 1e-4 dB of libm. */
+        void AmplitudeToDb_32f(
+            _Out_writes_(length) float* pDst, _In_reads_(length) float const* pSrc, _In_ size_t length);
+
+        /* Convert dB to amplitudes, 10 ^ (dB / 20). dB values are clamped to the range of normal floats, about
+        -758 to 764 dB. SIMD versions are within a relative 5e-6 of libm. */
+        void DbToAmplitude_32f(
+            _Out_writes_(length) float* pDst, _In_reads_(length) float const* pSrc, _In_ size_t length);
+
+        /* Convert direction vectors to spherical coordinates in degrees, like VectorToSpherical in mathutility.h.
+        Azimuth is in [0, 360), elevation in [-90, 90], and vectors shorter than 1e-4 map to 0. SIMD versions are
+        within 1e-4 degrees of libm. */
+        void VectorToSpherical_32f(
+            _Out_writes_(length) float* pAzimuth, _Out_writes_(length) float* pElevation,
+            _In_reads_(length) float const* pX, _In_reads_(length) float const* pY,
+            _In_reads_(length) float const* pZ, _In_ size_t length);
+
+        /* Sum the first two channels of interleaved frames and scale the result, for a mono downmix of stereo
+        content in a wider buffer: dst[i] = (src[i * numChannels] + src[i * numChannels + 1]) * scale.
+        numChannels must be at least 2. */
+        void DownmixStereo_32f(
+            _Out_writes_(length) float* pDst, _In_reads_(length * numChannels) float const* pSrc,
+            _In_ size_t numChannels, _In_ float scale, _In_ size_t length);
+
+        /* Split interleaved frames into a mono downmix and a passthrough copy, crossfaded by a linear blend ramp.
+        With blend = startBlend + blendStep * (i + 1), frame i gives
+        downmix[i] = (src[i * numChannels] + src[i * numChannels + 1]) * 0.5 * blend and the passthrough copy of
+        every channel scaled by 1 - blend. numChannels must be at least 2. pPassthrough may alias pSrc. */
+        void DownmixCrossfade_32f(
+            _Out_writes_(length) float* pDownmix, _Out_writes_(length * numChannels) float* pPassthrough,
+            _In_reads_(length * numChannels) float const* pSrc, _In_ size_t numChannels, _In_ float startBlend,
+            _In_ float blendStep, _In_ size_t length);
+
         /* Solve the modified interpolation equation: a + (remainder * (b - a)) */
         void Interpolate_32f(
             _Inout_updates_(length) float* pDst, _In_reads_(length) const float* pSrcA,